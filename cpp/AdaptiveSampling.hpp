@@ -0,0 +1,310 @@
+#ifndef ADAPTIVE_SAMPLING_HPP
+#define ADAPTIVE_SAMPLING_HPP
+
+// Sequential sampling with convergence-based stopping.
+// A pattern is measured in chunks. After each chunk, confidence intervals
+// on the mean and on the peak-bin share (the quickAnalyze() statistics) are
+// compared with the target half-widths. The pattern stops as soon as both
+// are reached, within [min, max] iterations.
+//
+// Consecutive samples are correlated (host drift, the dynamic schedules),
+// so s / sqrt(n) would overstate the precision. The stream is cut into
+// batches of ADAPTIVE_BATCH samples, and the variance of the batch means
+// gives the design effect: deff = var(batch mean) x batch / var(sample),
+// at least 1. Both intervals use n / deff effective samples. The peak-bin
+// share is a binomial proportion of the same stream and takes the same
+// factor.
+//
+// In the full benchmark, AdaptiveScheduler hands out the chunks. The
+// fixed iteration count x patterns becomes a shared budget. Every pattern
+// first gets its minimum. Iterations that converged patterns do not use
+// then go to the unresolved ones, least sampled first.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+constexpr int ADAPTIVE_BATCH = 1000;        // Samples per batch mean
+constexpr uint64_t ADAPTIVE_MIN_BATCHES = 16; // Before deff is trusted
+constexpr int ADAPTIVE_MIN_CHUNK = 8000;
+constexpr double ADAPTIVE_CHUNK_MARGIN = 1.1; // Over the predicted need
+
+struct AdaptiveOptions {
+  bool enabled = false;
+  double meanCi = 0.5; // Target CI half-width of the mean, in ops
+  double peakCi = 0.5; // Target CI half-width of the peak-bin share, points
+  double z = 2.576;    // 99% two-sided
+  int minIterations = 0; // Per pattern; 0 = derived from the fixed count
+  int maxIterations = 0; // Per pattern; 0 = derived from the fixed count
+};
+
+// Per-pattern bounds around a mode's fixed iteration count. The minimum
+// defaults to a tenth of it (at least enough batches for deff), the
+// maximum to `maxFactor` times it.
+inline void adaptiveBounds(const AdaptiveOptions &options, int iterations,
+                           int maxFactor, uint64_t &lo, uint64_t &hi) {
+  uint64_t floor = ADAPTIVE_MIN_BATCHES * ADAPTIVE_BATCH;
+  lo = options.minIterations > 0
+           ? static_cast<uint64_t>(options.minIterations)
+           : std::max<uint64_t>(floor, iterations / 10);
+  hi = options.maxIterations > 0
+           ? static_cast<uint64_t>(options.maxIterations)
+           : static_cast<uint64_t>(iterations) * maxFactor;
+  hi = std::max<uint64_t>(hi, 1);
+  lo = std::min(lo, hi);
+}
+
+// Welford over the means of consecutive fixed-size batches
+class BatchMeans {
+  int size_;
+  int fill_ = 0;
+  double sum_ = 0.0;
+  uint64_t count_ = 0;
+  double mean_ = 0.0;
+  double m2_ = 0.0;
+
+public:
+  explicit BatchMeans(int size = ADAPTIVE_BATCH) : size_(size) {}
+
+  void add(int value) {
+    sum_ += value;
+    if (++fill_ < size_)
+      return;
+    double x = sum_ / size_;
+    count_++;
+    double delta = x - mean_;
+    mean_ += delta / count_;
+    m2_ += delta * (x - mean_);
+    sum_ = 0.0;
+    fill_ = 0;
+  }
+
+  int size() const { return size_; }
+  uint64_t count() const { return count_; }
+  double variance() const { return count_ > 1 ? m2_ / (count_ - 1) : 0.0; }
+
+  // Checkpoint state (Checkpoint.hpp)
+  template <typename Writer> void saveState(Writer &w) const {
+    w.put(size_);
+    w.put(fill_);
+    w.put(sum_);
+    w.put(count_);
+    w.put(mean_);
+    w.put(m2_);
+  }
+
+  template <typename Reader> bool loadState(Reader &r) {
+    size_ = r.template get<int>();
+    fill_ = r.template get<int>();
+    sum_ = r.template get<double>();
+    count_ = r.template get<uint64_t>();
+    mean_ = r.template get<double>();
+    m2_ = r.template get<double>();
+    return r.ok() && size_ > 0 && fill_ >= 0 && fill_ < size_;
+  }
+};
+
+struct PrecisionEstimate {
+  bool valid = false;         // Enough batches for the design effect
+  double designEffect = 1.0;
+  double meanHalfWidth = 0.0; // ops
+  double peakHalfWidth = 0.0; // percentage points
+};
+
+// n samples with the given variance and peak-bin share (percent)
+inline PrecisionEstimate estimatePrecision(uint64_t n, double variance,
+                                           double peakPercent,
+                                           const BatchMeans &batches,
+                                           double z) {
+  PrecisionEstimate e;
+  if (n == 0)
+    return e;
+  e.valid = batches.count() >= ADAPTIVE_MIN_BATCHES;
+  if (e.valid && variance > 0.0)
+    e.designEffect =
+        std::max(1.0, batches.variance() * batches.size() / variance);
+  double effective = n / e.designEffect;
+  double p = std::min(std::max(peakPercent / 100.0, 0.0), 1.0);
+  e.meanHalfWidth = z * std::sqrt(variance / effective);
+  e.peakHalfWidth = 100.0 * z * std::sqrt(p * (1.0 - p) / effective);
+  return e;
+}
+
+inline bool precisionReached(const PrecisionEstimate &e,
+                             const AdaptiveOptions &options) {
+  return e.valid && e.meanHalfWidth <= options.meanCi &&
+         e.peakHalfWidth <= options.peakCi;
+}
+
+// Size of the next chunk of a pattern with `done` samples, or 0 to stop.
+// The half-widths shrink as 1/sqrt(n), which predicts the total needed.
+// A chunk at most doubles the samples, so the prediction is revisited.
+inline uint64_t nextAdaptiveChunk(const PrecisionEstimate &e, uint64_t done,
+                                  uint64_t maxIterations,
+                                  const AdaptiveOptions &options) {
+  if (done >= maxIterations || precisionReached(e, options))
+    return 0;
+  double need = static_cast<double>(ADAPTIVE_MIN_BATCHES * ADAPTIVE_BATCH);
+  if (e.valid) {
+    double ratio = std::max(std::pow(e.meanHalfWidth / options.meanCi, 2.0),
+                            std::pow(e.peakHalfWidth / options.peakCi, 2.0));
+    need = ADAPTIVE_CHUNK_MARGIN * ratio * done;
+  }
+  uint64_t chunk = need > done ? static_cast<uint64_t>(need - done) : 0;
+  chunk = std::max<uint64_t>(chunk, ADAPTIVE_MIN_CHUNK);
+  chunk = std::min(chunk, std::max<uint64_t>(done, ADAPTIVE_MIN_CHUNK));
+  // Whole batches, so the chunks print as round counts
+  chunk = (chunk + ADAPTIVE_BATCH - 1) / ADAPTIVE_BATCH * ADAPTIVE_BATCH;
+  return std::min(chunk, maxIterations - done);
+}
+
+enum class AdaptiveStatus {
+  Pending,   // Not started
+  Running,   // Below the target precision, more chunks to come
+  Converged, // Target precision reached
+  AtMaximum, // Stopped at the per-pattern maximum
+  Budget,    // Stopped because the shared budget ran out
+  Fixed      // Adaptive sampling off: the fixed count was measured
+};
+
+inline const char *adaptiveStatusName(AdaptiveStatus status) {
+  switch (status) {
+  case AdaptiveStatus::Pending:
+    return "pending";
+  case AdaptiveStatus::Running:
+    return "running";
+  case AdaptiveStatus::Converged:
+    return "converged";
+  case AdaptiveStatus::AtMaximum:
+    return "at maximum";
+  case AdaptiveStatus::Budget:
+    return "budget spent";
+  case AdaptiveStatus::Fixed:
+    return "fixed";
+  }
+  return "?";
+}
+
+struct AdaptiveJobState {
+  AdaptiveStatus status = AdaptiveStatus::Pending;
+  uint64_t done = 0;
+  bool busy = false; // A chunk is being measured
+  PrecisionEstimate estimate;
+};
+
+// Chunk dispenser for a list of patterns. Not thread-safe; parallel
+// workers call it under one lock and wait while next() says Wait.
+// With adaptive sampling off, every pattern gets the fixed count, in one
+// chunk (the plain benchmark) or in chunks of `fixedChunk` (checkpoints);
+// a started pattern is finished before the next one starts.
+class AdaptiveScheduler {
+  AdaptiveOptions options_;
+  int fixed_;
+  int fixedChunk_;
+  uint64_t min_ = 0, max_ = 0;
+  uint64_t budget_ = 0, assigned_ = 0;
+  std::vector<AdaptiveJobState> jobs_;
+
+  static bool finished(AdaptiveStatus s) {
+    return s != AdaptiveStatus::Pending && s != AdaptiveStatus::Running;
+  }
+
+public:
+  enum class Step { Chunk, Wait, Done };
+
+  AdaptiveScheduler(size_t jobCount, int iterations,
+                    const AdaptiveOptions &options, int fixedChunk = 0)
+      : options_(options), fixed_(iterations), fixedChunk_(fixedChunk),
+        jobs_(jobCount) {
+    budget_ = static_cast<uint64_t>(iterations) * jobCount;
+    adaptiveBounds(options, iterations, 4, min_, max_);
+  }
+
+  Step next(size_t &job, int &iterations) {
+    const size_t none = jobs_.size();
+    bool anyBusy = false;
+    size_t pending = none, best = none;
+    for (size_t j = 0; j < jobs_.size(); j++) {
+      const AdaptiveJobState &s = jobs_[j];
+      anyBusy = anyBusy || s.busy;
+      if (s.status == AdaptiveStatus::Pending && pending == none)
+        pending = j;
+      // Adaptive: least sampled first; fixed: lowest index first
+      if (!s.busy && s.status == AdaptiveStatus::Running &&
+          (best == none || (options_.enabled && s.done < jobs_[best].done)))
+        best = j;
+    }
+
+    uint64_t n = 0;
+    if (!options_.enabled) {
+      job = best != none ? best : pending;
+      if (job == none)
+        return anyBusy ? Step::Wait : Step::Done;
+      n = fixed_ - std::min<uint64_t>(jobs_[job].done, fixed_);
+      if (fixedChunk_ > 0)
+        n = std::min<uint64_t>(n, fixedChunk_);
+    } else if (pending != none) {
+      // Every pattern gets its first chunk before any gets a second
+      job = pending;
+      n = min_;
+    } else if (best != none) {
+      AdaptiveJobState &s = jobs_[best];
+      job = best;
+      n = nextAdaptiveChunk(s.estimate, s.done, max_, options_);
+      n = std::min(n, budget_ - std::min(assigned_, budget_));
+      if (n == 0) {
+        s.status = AdaptiveStatus::Budget;
+        return next(job, iterations);
+      }
+    } else {
+      return anyBusy ? Step::Wait : Step::Done;
+    }
+    if (n == 0) { // Fixed count already measured (resumed run)
+      jobs_[job].status = AdaptiveStatus::Fixed;
+      return next(job, iterations);
+    }
+
+    AdaptiveJobState &s = jobs_[job];
+    s.status = AdaptiveStatus::Running;
+    s.busy = true;
+    assigned_ += n;
+    iterations = static_cast<int>(n);
+    return Step::Chunk;
+  }
+
+  // A chunk of `job` was measured; the statistics cover all its samples
+  void complete(size_t job, uint64_t total, double variance,
+                double peakPercent, const BatchMeans &batches) {
+    AdaptiveJobState &s = jobs_[job];
+    s.busy = false;
+    s.done = total;
+    if (!options_.enabled) {
+      if (total >= static_cast<uint64_t>(fixed_))
+        s.status = AdaptiveStatus::Fixed;
+      return;
+    }
+    s.estimate =
+        estimatePrecision(total, variance, peakPercent, batches, options_.z);
+    if (precisionReached(s.estimate, options_))
+      s.status = AdaptiveStatus::Converged;
+    else if (total >= max_)
+      s.status = AdaptiveStatus::AtMaximum;
+  }
+
+  // State of a pattern restored from a checkpoint
+  void restore(size_t job, const AdaptiveJobState &state) {
+    jobs_[job] = state;
+    jobs_[job].busy = false;
+    assigned_ += state.done;
+  }
+
+  const AdaptiveJobState &job(size_t j) const { return jobs_[j]; }
+  uint64_t minIterations() const { return min_; }
+  uint64_t maxIterations() const { return max_; }
+  uint64_t budget() const { return budget_; }
+  uint64_t assigned() const { return assigned_; }
+  bool enabled() const { return options_.enabled; }
+};
+
+#endif // ADAPTIVE_SAMPLING_HPP
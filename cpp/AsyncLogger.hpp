@@ -0,0 +1,232 @@
+#ifndef ASYNC_LOGGER_HPP
+#define ASYNC_LOGGER_HPP
+
+// Asynchronous logger for the measuring thread.
+// The producer formats a line into a slot of a single-producer/single-
+// consumer ring and publishes it with one release store: no locks, no
+// allocation, no syscalls. A writer thread at normal priority (pinned to
+// a housekeeping core, or kept off the measuring core) drains the ring in
+// batches into one long-lived file handle and stdout, and fsyncs the file
+// at a configurable interval.
+// Timestamps are captured by the producer as raw clock values and only
+// turned into local time on the writer thread.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "QuantumLib.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+enum class LogChannel : uint8_t { Console, File };
+
+// Prefix the writer thread renders from the record's timestamp
+enum class LogStamp : uint8_t {
+  None,
+  CsvTime,     // "YYYY-MM-DD HH:MM:SS,hour,minute,"
+  MinuteSecond // "  [MM:SS] "
+};
+
+struct AsyncLoggerOptions {
+  std::string path;         // File channel target (opened in append mode)
+  int writerCore = -1;      // Pin the writer thread here; -1 = not pinned
+  int avoidCore = -1;       // Measuring core, left alone when not pinned
+  int fsyncIntervalMs = 0;  // 0 = never fsync, otherwise at most this often
+  int pollIntervalUs = 1000; // Writer sleep when the ring is empty
+  size_t capacity = 4096;    // Ring slots, rounded up to a power of two
+};
+
+class AsyncLogger {
+  struct Record {
+    int64_t unixNanos;
+    uint16_t length;
+    LogChannel channel;
+    LogStamp stamp;
+    char text[244];
+  };
+
+  std::vector<Record> ring_;
+  size_t mask_ = 0;
+  alignas(64) std::atomic<size_t> head_{0}; // Next slot the writer reads
+  alignas(64) std::atomic<size_t> tail_{0}; // Next slot the producer fills
+  alignas(64) std::atomic<uint64_t> dropped_{0};
+  std::atomic<bool> running_{false};
+
+  AsyncLoggerOptions options_;
+  FILE *file_ = nullptr;
+  std::thread writer_;
+
+  static void renderStamp(const Record &r, std::string &out) {
+    if (r.stamp == LogStamp::None)
+      return;
+    std::time_t t = static_cast<std::time_t>(r.unixNanos / 1000000000LL);
+    std::tm tm;
+#ifdef _WIN32
+    localtime_s(&tm, &t);
+#else
+    localtime_r(&t, &tm);
+#endif
+    char buf[48];
+    if (r.stamp == LogStamp::CsvTime) {
+      std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d %02d:%02d:%02d,%d,%d,",
+                    tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                    tm.tm_min, tm.tm_sec, tm.tm_hour, tm.tm_min);
+    } else {
+      std::snprintf(buf, sizeof(buf), "  [%02d:%02d] ", tm.tm_min, tm.tm_sec);
+    }
+    out += buf;
+  }
+
+  void syncFile() {
+    std::fflush(file_);
+#ifdef _WIN32
+    _commit(_fileno(file_));
+#else
+    fsync(fileno(file_));
+#endif
+  }
+
+  void writerLoop() {
+    makeHousekeepingThread(options_.writerCore, options_.avoidCore);
+
+    std::string fileBatch, consoleBatch;
+    auto lastSync = std::chrono::steady_clock::now();
+    bool unsynced = false;
+
+    for (;;) {
+      bool stopping = !running_.load(std::memory_order_acquire);
+      size_t head = head_.load(std::memory_order_relaxed);
+      size_t tail = tail_.load(std::memory_order_acquire);
+
+      for (; head != tail; head++) {
+        const Record &r = ring_[head & mask_];
+        std::string &batch =
+            r.channel == LogChannel::File ? fileBatch : consoleBatch;
+        renderStamp(r, batch);
+        batch.append(r.text, r.length);
+      }
+      head_.store(head, std::memory_order_release);
+
+      if (!fileBatch.empty() && file_) {
+        std::fwrite(fileBatch.data(), 1, fileBatch.size(), file_);
+        std::fflush(file_);
+        unsynced = true;
+      }
+      if (!consoleBatch.empty()) {
+        std::fwrite(consoleBatch.data(), 1, consoleBatch.size(), stdout);
+        std::fflush(stdout);
+      }
+      fileBatch.clear();
+      consoleBatch.clear();
+
+      auto now = std::chrono::steady_clock::now();
+      if (file_ && unsynced && options_.fsyncIntervalMs > 0 &&
+          now - lastSync >=
+              std::chrono::milliseconds(options_.fsyncIntervalMs)) {
+        syncFile();
+        lastSync = now;
+        unsynced = false;
+      }
+
+      if (stopping && head_.load() == tail_.load(std::memory_order_acquire))
+        break;
+      if (head == tail_.load(std::memory_order_acquire))
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(options_.pollIntervalUs));
+    }
+
+    if (file_ && unsynced && options_.fsyncIntervalMs > 0)
+      syncFile();
+  }
+
+public:
+  AsyncLogger() = default;
+  AsyncLogger(const AsyncLogger &) = delete;
+  AsyncLogger &operator=(const AsyncLogger &) = delete;
+  ~AsyncLogger() { stop(); }
+
+  // Opens the file once, writes `fileHeader` if it is empty, and starts the
+  // writer thread. Returns false if the file cannot be opened.
+  bool start(const AsyncLoggerOptions &options,
+             const std::string &fileHeader = "") {
+    options_ = options;
+    size_t capacity = 1;
+    while (capacity < options.capacity)
+      capacity <<= 1;
+    ring_.assign(capacity, Record());
+    mask_ = capacity - 1;
+
+    if (!options.path.empty()) {
+      file_ = std::fopen(options.path.c_str(), "ab");
+      if (!file_)
+        return false;
+      std::fseek(file_, 0, SEEK_END);
+      if (std::ftell(file_) == 0 && !fileHeader.empty()) {
+        std::fwrite(fileHeader.data(), 1, fileHeader.size(), file_);
+        std::fflush(file_);
+      }
+    }
+
+    running_.store(true, std::memory_order_release);
+    writer_ = std::thread(&AsyncLogger::writerLoop, this);
+    return true;
+  }
+
+  // Formats one line into the ring. Never blocks: if the ring is full the
+  // line is dropped and counted. Lines longer than a slot are truncated.
+#if defined(__GNUC__) || defined(__clang__)
+  __attribute__((format(printf, 5, 6)))
+#endif
+  bool
+  logf(LogChannel channel, LogStamp stamp,
+       std::chrono::system_clock::time_point when, const char *fmt, ...) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    Record &r = ring_[tail & mask_];
+    r.unixNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      when.time_since_epoch())
+                      .count();
+    r.channel = channel;
+    r.stamp = stamp;
+    va_list args;
+    va_start(args, fmt);
+    int n = std::vsnprintf(r.text, sizeof(r.text), fmt, args);
+    va_end(args);
+    if (n < 0)
+      n = 0;
+    r.length = static_cast<uint16_t>(
+        std::min(static_cast<size_t>(n), sizeof(r.text) - 1));
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Drains everything still queued, then joins the writer and closes the file
+  void stop() {
+    if (writer_.joinable()) {
+      running_.store(false, std::memory_order_release);
+      writer_.join();
+    }
+    if (file_) {
+      std::fclose(file_);
+      file_ = nullptr;
+    }
+  }
+
+  uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+};
+
+#endif // ASYNC_LOGGER_HPP
@@ -0,0 +1,365 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+// Checkpoint file of a full-benchmark run, for --resume.
+//
+// Layout (native byte order; a checkpoint is resumed on the host that
+// wrote it):
+//   magic, version
+//   calibration: counter rate, the three tick values, run context
+//   plan hash, options key    must match for the run to be resumed
+//   load count, then name, FFT size and repeats of each load
+//                             (as tuned; a resumed run measures with
+//                             these instead of tuning again)
+//   raw file size             bytes of --raw-out covered by the state
+//   pattern count, then one length-prefixed snapshot per pattern
+//                             (empty = not started)
+//
+// The snapshots are opaque here; the benchmark writes and reads them
+// with CheckpointWriter / CheckpointReader. Accumulator histograms are
+// stored sparsely, so a pattern takes a few KB. The file is replaced
+// atomically (temporary file, synced to disk, renamed over the old one),
+// so a kill or power loss while saving leaves the previous checkpoint
+// intact.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "QuantumLib.hpp"
+#include "SampleStats.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+constexpr char CHECKPOINT_MAGIC[8] = {'C', 'R', 'C', 'K', 'P', 'T', '0', '1'};
+constexpr uint32_t CHECKPOINT_VERSION = 3;
+// Counter rates further apart than this are different calibrations
+constexpr double CHECKPOINT_FREQ_TOLERANCE = 0.01;
+
+// ========== Serialization ==========
+
+class CheckpointWriter {
+  std::string bytes_;
+
+public:
+  template <typename T> void put(const T &value) {
+    static_assert(std::is_trivially_copyable<T>::value, "plain data only");
+    bytes_.append(reinterpret_cast<const char *>(&value), sizeof(T));
+  }
+
+  void putString(const std::string &s) {
+    put(static_cast<uint64_t>(s.size()));
+    bytes_.append(s);
+  }
+
+  template <typename T> void putVector(const std::vector<T> &v) {
+    static_assert(std::is_trivially_copyable<T>::value, "plain data only");
+    put(static_cast<uint64_t>(v.size()));
+    bytes_.append(reinterpret_cast<const char *>(v.data()),
+                  v.size() * sizeof(T));
+  }
+
+  const std::string &bytes() const { return bytes_; }
+};
+
+// Reads what CheckpointWriter wrote. Reading past the end or a length
+// that does not fit sets a sticky failure; values read then are zero.
+class CheckpointReader {
+  const std::string &bytes_;
+  size_t pos_ = 0;
+  bool ok_ = true;
+
+  bool take(void *out, size_t n) {
+    if (!ok_ || n > bytes_.size() - pos_) {
+      ok_ = false;
+      std::memset(out, 0, n);
+      return false;
+    }
+    std::memcpy(out, bytes_.data() + pos_, n);
+    pos_ += n;
+    return true;
+  }
+
+public:
+  explicit CheckpointReader(const std::string &bytes) : bytes_(bytes) {}
+
+  template <typename T> T get() {
+    static_assert(std::is_trivially_copyable<T>::value, "plain data only");
+    T value;
+    take(&value, sizeof(T));
+    return value;
+  }
+
+  std::string getString() {
+    uint64_t n = get<uint64_t>();
+    if (!ok_ || n > bytes_.size() - pos_) {
+      ok_ = false;
+      return std::string();
+    }
+    std::string s = bytes_.substr(pos_, n);
+    pos_ += n;
+    return s;
+  }
+
+  template <typename T> std::vector<T> getVector() {
+    uint64_t n = get<uint64_t>();
+    if (!ok_ || n > (bytes_.size() - pos_) / sizeof(T)) {
+      ok_ = false;
+      return std::vector<T>();
+    }
+    std::vector<T> v(n);
+    take(v.data(), n * sizeof(T));
+    return v;
+  }
+
+  bool ok() const { return ok_; }
+  bool atEnd() const { return pos_ == bytes_.size(); }
+};
+
+// Moments and the non-empty histogram bins
+inline void saveAccumulator(CheckpointWriter &w, const SampleAccumulator &a) {
+  w.put(a.count);
+  w.put(a.mean);
+  w.put(a.m2);
+  w.put(a.minVal);
+  w.put(a.maxVal);
+  w.put(a.underflow);
+  w.put(a.overflow);
+  std::vector<uint32_t> index;
+  std::vector<uint64_t> count;
+  for (int i = 0; i < HISTOGRAM_BINS; i++) {
+    if (a.bins[i]) {
+      index.push_back(static_cast<uint32_t>(i));
+      count.push_back(a.bins[i]);
+    }
+  }
+  w.putVector(index);
+  w.putVector(count);
+}
+
+inline bool loadAccumulator(CheckpointReader &r, SampleAccumulator &a) {
+  a = SampleAccumulator();
+  a.count = r.get<uint64_t>();
+  a.mean = r.get<double>();
+  a.m2 = r.get<double>();
+  a.minVal = r.get<int>();
+  a.maxVal = r.get<int>();
+  a.underflow = r.get<uint64_t>();
+  a.overflow = r.get<uint64_t>();
+  std::vector<uint32_t> index = r.getVector<uint32_t>();
+  std::vector<uint64_t> count = r.getVector<uint64_t>();
+  if (!r.ok() || index.size() != count.size())
+    return false;
+  for (size_t i = 0; i < index.size(); i++) {
+    if (index[i] >= static_cast<uint32_t>(HISTOGRAM_BINS))
+      return false;
+    a.bins[index[i]] = count[i];
+  }
+  return true;
+}
+
+// 64-bit FNV-1a, for the plan hash
+inline uint64_t checkpointHash(const void *data, size_t n,
+                               uint64_t h = 1469598103934665603ULL) {
+  const unsigned char *p = static_cast<const unsigned char *>(data);
+  for (size_t i = 0; i < n; i++) {
+    h ^= p[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+// ========== Checkpoint File ==========
+
+struct CheckpointCalibration {
+  uint64_t cpuFreqHz = 0;
+  uint64_t tickCenter = 0;
+  uint64_t tickMinus1 = 0;
+  uint64_t tickPlus1 = 0;
+  std::string context; // Kernel level and quantum load of the run
+};
+
+struct CheckpointFile {
+  CheckpointCalibration calibration;
+  uint64_t planHash = 0;
+  std::string options;
+  std::vector<LoadSpec> loads; // Name, FFT size and repeats
+  uint64_t rawBytes = 0;
+  std::vector<std::string> patterns; // Snapshots; empty = not started
+
+  bool save(const std::string &path) const {
+    CheckpointWriter w;
+    w.put(CHECKPOINT_MAGIC);
+    w.put(CHECKPOINT_VERSION);
+    w.put(calibration.cpuFreqHz);
+    w.put(calibration.tickCenter);
+    w.put(calibration.tickMinus1);
+    w.put(calibration.tickPlus1);
+    w.putString(calibration.context);
+    w.put(planHash);
+    w.putString(options);
+    w.put(static_cast<uint64_t>(loads.size()));
+    for (const LoadSpec &load : loads) {
+      w.putString(load.name);
+      w.put(load.fftSize);
+      w.put(load.repeats);
+    }
+    w.put(rawBytes);
+    w.put(static_cast<uint64_t>(patterns.size()));
+    for (const auto &p : patterns)
+      w.putString(p);
+
+    // The data must be on disk before the rename makes it the checkpoint
+    std::string tmp = path + ".tmp";
+    std::FILE *out = std::fopen(tmp.c_str(), "wb");
+    if (!out)
+      return false;
+    bool written = std::fwrite(w.bytes().data(), 1, w.bytes().size(), out) ==
+                       w.bytes().size() &&
+                   std::fflush(out) == 0;
+#ifdef _WIN32
+    written = written && _commit(_fileno(out)) == 0;
+#else
+    written = written && fsync(fileno(out)) == 0;
+#endif
+    written = std::fclose(out) == 0 && written;
+    if (!written) {
+      std::remove(tmp.c_str());
+      return false;
+    }
+#ifdef _WIN32
+    return MoveFileExA(tmp.c_str(), path.c_str(),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+  }
+
+  bool load(const std::string &path, std::string &error) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+      error = "cannot open " + path;
+      return false;
+    }
+    std::string bytes((std::istreambuf_iterator<char>(in)),
+                      std::istreambuf_iterator<char>());
+    CheckpointReader r(bytes);
+    char magic[8];
+    for (char &c : magic)
+      c = r.get<char>();
+    if (std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0) {
+      error = path + " is not a checkpoint file";
+      return false;
+    }
+    uint32_t version = r.get<uint32_t>();
+    if (version != CHECKPOINT_VERSION) {
+      error = "unsupported checkpoint version " + std::to_string(version);
+      return false;
+    }
+    calibration.cpuFreqHz = r.get<uint64_t>();
+    calibration.tickCenter = r.get<uint64_t>();
+    calibration.tickMinus1 = r.get<uint64_t>();
+    calibration.tickPlus1 = r.get<uint64_t>();
+    calibration.context = r.getString();
+    planHash = r.get<uint64_t>();
+    options = r.getString();
+    uint64_t loadCount = r.get<uint64_t>();
+    loads.clear();
+    for (uint64_t i = 0; i < loadCount && r.ok(); i++) {
+      LoadSpec load;
+      load.name = r.getString();
+      load.fftSize = r.get<int>();
+      load.repeats = r.get<int>();
+      loads.push_back(load);
+    }
+    rawBytes = r.get<uint64_t>();
+    uint64_t count = r.get<uint64_t>();
+    patterns.clear();
+    for (uint64_t i = 0; i < count && r.ok(); i++)
+      patterns.push_back(r.getString());
+    if (!r.ok() || !r.atEnd()) {
+      error = path + " is truncated or corrupt";
+      return false;
+    }
+    return true;
+  }
+};
+
+inline CheckpointCalibration checkpointCalibrationOf(
+    const CalibrationData &cal, const std::string &context) {
+  CheckpointCalibration c;
+  c.cpuFreqHz = cal.cpu_freq_hz;
+  c.tickCenter = cal.tick_center;
+  c.tickMinus1 = cal.tick_minus1;
+  c.tickPlus1 = cal.tick_plus1;
+  c.context = context;
+  return c;
+}
+
+// The checkpoint's FFT sizes and repeat counts for the loads of the same
+// name. Re-tuning on resume could pick other shapes (timing noise, another
+// cache), which would change the plan hash and refuse the checkpoint.
+// False if a load of `loads` is not in the checkpoint.
+inline bool applyCheckpointLoads(const std::vector<LoadSpec> &saved,
+                                 std::vector<LoadSpec> &loads,
+                                 std::string &error) {
+  for (LoadSpec &load : loads) {
+    auto it = std::find_if(saved.begin(), saved.end(),
+                           [&](const LoadSpec &s) {
+                             return s.name == load.name;
+                           });
+    if (it == saved.end()) {
+      error = "load " + load.name + " is not in the checkpoint";
+      return false;
+    }
+    load.fftSize = it->fftSize;
+    load.repeats = it->repeats;
+  }
+  return true;
+}
+
+// A resumed run must measure the same thing: same kernel level and
+// quantum load, and a counter rate within CHECKPOINT_FREQ_TOLERANCE.
+// When compatible, `cal` takes the checkpoint's rate and ticks, so the
+// patterns compile to the same tick arrays as before.
+inline bool adoptCheckpointCalibration(const CheckpointCalibration &saved,
+                                       const std::string &context,
+                                       CalibrationData &cal,
+                                       std::string &error) {
+  if (saved.context != context) {
+    error = "checkpoint ran with " + saved.context + ", this run with " +
+            context;
+    return false;
+  }
+  double deviation =
+      (static_cast<double>(cal.cpu_freq_hz) -
+       static_cast<double>(saved.cpuFreqHz)) /
+      static_cast<double>(saved.cpuFreqHz);
+  if (saved.cpuFreqHz == 0 ||
+      std::fabs(deviation) > CHECKPOINT_FREQ_TOLERANCE) {
+    std::ostringstream ss;
+    ss << "checkpoint calibrated at " << saved.cpuFreqHz
+       << " Hz, this host measures " << cal.cpu_freq_hz << " Hz";
+    error = ss.str();
+    return false;
+  }
+  cal.cpu_freq_hz = saved.cpuFreqHz;
+  cal.tick_center = saved.tickCenter;
+  cal.tick_minus1 = saved.tickMinus1;
+  cal.tick_plus1 = saved.tickPlus1;
+  return true;
+}
+
+#endif // CHECKPOINT_HPP
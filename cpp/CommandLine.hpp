@@ -0,0 +1,57 @@
+#ifndef COMMAND_LINE_HPP
+#define COMMAND_LINE_HPP
+
+// Checked parsing of numeric command-line values.
+// The whole argument must be a number inside the option's range;
+// anything else is reported through `error`, so a typo ends the run with
+// a message instead of an uncaught std::stoi exception.
+
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+// Whole number in [lo, hi]
+inline bool parseIntArg(const std::string &text, long lo, long hi, int &value,
+                        std::string &error) {
+  const char *begin = text.c_str();
+  char *end = nullptr;
+  errno = 0;
+  long v = std::strtol(begin, &end, 10);
+  if (text.empty() || end == begin || *end != '\0' || errno == ERANGE) {
+    error = "'" + text + "' is not a whole number";
+    return false;
+  }
+  if (v < lo || v > hi) {
+    error = text + " is out of range " + std::to_string(lo) + "-" +
+            std::to_string(hi);
+    return false;
+  }
+  value = static_cast<int>(v);
+  return true;
+}
+
+// Finite number in [lo, hi]
+inline bool parseDoubleArg(const std::string &text, double lo, double hi,
+                           double &value, std::string &error) {
+  const char *begin = text.c_str();
+  char *end = nullptr;
+  errno = 0;
+  double v = std::strtod(begin, &end);
+  if (text.empty() || end == begin || *end != '\0' || errno == ERANGE ||
+      !std::isfinite(v)) {
+    error = "'" + text + "' is not a number";
+    return false;
+  }
+  if (v < lo || v > hi) {
+    std::ostringstream ss;
+    ss << text << " is out of range " << lo << "-" << hi;
+    error = ss.str();
+    return false;
+  }
+  value = v;
+  return true;
+}
+
+#endif // COMMAND_LINE_HPP
@@ -0,0 +1,318 @@
+#ifndef LOAD_TUNER_HPP
+#define LOAD_TUNER_HPP
+
+// Cycle-budget auto-tuner for the FFT loads.
+// The built-in (size, repeats) pairs were picked on a ~5 GHz machine. On
+// slower hosts the "90%" load can overrun the whole period, leaving nothing
+// for the loaded spin window to count. For every load with a target
+// percentage, the tuner times the loaded phase of a sample (FFT + quantum
+// load, through the same kernel the measurement uses) and picks the FFT
+// size and repeat count whose median cost lands closest to target x the
+// plan's center tick (the pattern config's `center`). A linear cost model
+// (two timings per size) predicts the repeat count, and measured costs
+// then step it until it crosses the target. The configured FFT size is
+// kept when it can reach the target; otherwise another size is chosen.
+// The choices and the load percentages they achieve are stored in the
+// calibration cache. A target no shape reaches keeps its closest shape,
+// cached as best effort and reused as such instead of being searched again
+// on every run. They are keyed on what they depend on: the counter
+// rate, the center tick, the SIMD level, the load kernel version and the
+// quantum load.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "QuantumLib.hpp"
+#include "TscCalibration.hpp"
+
+// The tuner only picks shapes that have a specialized load kernel
+constexpr int LOAD_TUNE_MAX_REPEATS = LOAD_KERNEL_MAX_REPEATS;
+
+struct LoadTuneOptions {
+  bool enabled = true;
+  double tolerancePercent = 2.0; // Allowed |achieved - target|, in points
+  bool useCache = true;
+  bool retune = false;   // Ignore cached choices
+  std::string cachePath; // Calibration cache (CalibrationReport::cachePath)
+  int runs = 501;        // Timed runs per candidate; the median is used
+};
+
+struct LoadTuneResult {
+  std::string name;
+  double targetPercent = 0.0; // 0 = fixed load, only measured
+  int fftSize = 0;
+  int repeats = 0;
+  double achievedPercent = 0.0; // Loaded-phase cost / center tick
+  bool withinTolerance = true;
+};
+
+struct LoadTuneReport {
+  std::string status; // "tuned", "cached" or "disabled"
+  uint64_t centerTick = 0;    // Period the percentages refer to
+  uint64_t quantumCycles = 0; // Quantum load share of every loaded phase
+  std::vector<LoadTuneResult> loads;
+  std::vector<std::string> warnings;
+};
+
+// Median cost of one loaded phase with the given FFT work, in cycles
+inline uint64_t loadPhaseCycles(int fftSize, int repeats,
+                                const QuantumLoadSpec &quantumLoad,
+                                const CalibrationData &cal, int runs) {
+  LoadSpec load;
+  load.fftSize = fftSize;
+  load.repeats = repeats;
+  LoadKernelFn kernel = findLoadKernel(load, quantumLoad);
+  LoadKernelArgs args = makeLoadKernelArgs(load, quantumLoad);
+  return medianCycles([&] { kernel(args); }, runs, cal.timer.overhead);
+}
+
+// Everything the cached choices depend on
+inline std::string loadTuneContext(const CalibrationData &cal,
+                                   uint64_t centerTick,
+                                   const QuantumLoadSpec &quantumLoad) {
+  std::ostringstream ss;
+  ss << cal.cpu_freq_hz << "," << centerTick << ","
+     << simdLevelName(activeSimdLevel()) << ",kernels-v"
+     << LOAD_KERNEL_VERSION << ","
+     << quantumLoad.qubits << "x" << quantumLoad.layers << ","
+     << (quantumLoad.mode == CircuitMode::Fused ? "fused" : "interpreted");
+  return ss.str();
+}
+
+inline std::string loadTuneKey(double targetPercent) {
+  char buf[48];
+  std::snprintf(buf, sizeof(buf), "load_target_%.2f", targetPercent);
+  return buf;
+}
+
+// Repeat count of `fftSize` that the linear cost model (fixed + pass x
+// repeats, fitted at 1 and 8 repeats) puts closest to the target
+inline int predictRepeats(int fftSize, double target,
+                          const QuantumLoadSpec &quantumLoad,
+                          const CalibrationData &cal, int runs,
+                          double &predictedError) {
+  double one = static_cast<double>(
+      loadPhaseCycles(fftSize, 1, quantumLoad, cal, runs));
+  double eight = static_cast<double>(
+      loadPhaseCycles(fftSize, 8, quantumLoad, cal, runs));
+  double pass = std::max((eight - one) / 7.0, 1.0);
+  double fixed = one - pass;
+  int repeats = static_cast<int>(std::lround((target - fixed) / pass));
+  repeats = std::max(1, std::min(LOAD_TUNE_MAX_REPEATS, repeats));
+  predictedError = std::fabs(fixed + pass * repeats - target);
+  return repeats;
+}
+
+// Starting from the model's answer, step the repeat count towards the
+// target on measured costs until it crosses. Returns the best cost seen.
+inline uint64_t refineRepeats(int fftSize, double target,
+                              const QuantumLoadSpec &quantumLoad,
+                              const CalibrationData &cal, int runs,
+                              int &repeats) {
+  uint64_t bestCost = 0;
+  double bestError = -1.0;
+  int r = repeats, previous = 0;
+  for (int step = 0; step < 8; step++) {
+    uint64_t cost = loadPhaseCycles(fftSize, r, quantumLoad, cal, runs);
+    double error = std::fabs(static_cast<double>(cost) - target);
+    if (bestError < 0.0 || error < bestError) {
+      bestError = error;
+      bestCost = cost;
+      repeats = r;
+    }
+    int next = static_cast<double>(cost) < target ? r + 1 : r - 1;
+    if (next < 1 || next > LOAD_TUNE_MAX_REPEATS || next == previous)
+      break;
+    previous = r;
+    r = next;
+  }
+  return bestCost;
+}
+
+// Pick (size, repeats) for one target, in cycles of the loaded phase.
+// The configured FFT size is kept if some repeat count of it is within
+// `tolerance` cycles. Otherwise the other sizes are refined on measured
+// costs, most promising prediction first, and a size replaces the
+// configured one only if its measured cost is closer to the target.
+// Returns the measured cost of the choice.
+inline uint64_t tuneLoad(double target, double tolerance,
+                         const QuantumLoadSpec &quantumLoad,
+                         const CalibrationData &cal, int runs, int &fftSize,
+                         int &repeats) {
+  double error;
+  int r = predictRepeats(fftSize, target, quantumLoad, cal, runs, error);
+  uint64_t cost = refineRepeats(fftSize, target, quantumLoad, cal, runs, r);
+  double bestError = std::fabs(static_cast<double>(cost) - target);
+  int bestSize = fftSize, bestRepeats = r;
+  uint64_t bestCost = cost;
+
+  struct Candidate {
+    int size, repeats;
+    double predictedError;
+  };
+  std::vector<Candidate> candidates;
+  if (bestError > tolerance) {
+    for (int size : LOAD_KERNEL_SIZES) {
+      if (size == fftSize)
+        continue;
+      int candidate =
+          predictRepeats(size, target, quantumLoad, cal, runs, error);
+      candidates.push_back({size, candidate, error});
+    }
+  }
+  std::sort(candidates.begin(), candidates.end(),
+            [](const Candidate &a, const Candidate &b) {
+              return a.predictedError < b.predictedError;
+            });
+  for (Candidate &c : candidates) {
+    if (bestError <= tolerance || c.predictedError >= bestError)
+      break;
+    cost = refineRepeats(c.size, target, quantumLoad, cal, runs, c.repeats);
+    double measured = std::fabs(static_cast<double>(cost) - target);
+    if (measured < bestError) {
+      bestError = measured;
+      bestSize = c.size;
+      bestRepeats = c.repeats;
+      bestCost = cost;
+    }
+  }
+  fftSize = bestSize;
+  repeats = bestRepeats;
+  return bestCost;
+}
+
+// Re-tune every load that has a target percentage of `centerTick`, in
+// place. Loads without a target keep their (size, repeats) and are only
+// measured.
+inline LoadTuneReport tuneLoads(std::vector<LoadSpec> &loads,
+                                const CalibrationData &cal,
+                                uint64_t centerTick,
+                                const QuantumLoadSpec &quantumLoad,
+                                const LoadTuneOptions &options) {
+  LoadTuneReport report;
+  report.status = options.enabled ? "cached" : "disabled";
+  report.centerTick = centerTick;
+  const double tick = static_cast<double>(centerTick);
+  const std::string context = loadTuneContext(cal, centerTick, quantumLoad);
+
+  CalibrationCache cache;
+  bool haveCache = options.useCache && !options.cachePath.empty() &&
+                   cache.load(options.cachePath) &&
+                   cache.get("load_context") == context;
+  if (!haveCache) // Choices made for another rate, period or kernel
+    cache.eraseWithPrefix("load_target_");
+  bool cacheDirty = false;
+
+  LoadKernelFn quantumKernel = findQuantumKernel(quantumLoad);
+  LoadKernelArgs quantumArgs = makeLoadKernelArgs(LoadSpec(), quantumLoad);
+  report.quantumCycles = medianCycles([&] { quantumKernel(quantumArgs); },
+                                      options.runs, cal.timer.overhead);
+
+  for (LoadSpec &load : loads) {
+    LoadTuneResult result;
+    result.name = load.name;
+    result.targetPercent = load.targetPercent;
+    bool tune = options.enabled && load.targetPercent > 0.0;
+    bool cached = false;
+
+    if (tune && haveCache && !options.retune) {
+      // "size,repeats,achieved[,best-effort]"
+      std::string value = cache.get(loadTuneKey(load.targetPercent));
+      int size = 0, repeats = 0;
+      double achieved = 0.0;
+      const std::string marker = ",best-effort";
+      bool bestEffort =
+          value.size() > marker.size() &&
+          value.compare(value.size() - marker.size(), marker.size(),
+                        marker) == 0;
+      if (std::sscanf(value.c_str(), "%d,%d,%lf", &size, &repeats,
+                      &achieved) == 3 &&
+          size > 0 && repeats > 0 &&
+          (bestEffort || std::fabs(achieved - load.targetPercent) <=
+                             options.tolerancePercent)) {
+        load.fftSize = size;
+        load.repeats = repeats;
+        result.achievedPercent = achieved;
+        cached = true;
+      }
+    }
+
+    uint64_t cost = 0;
+    if (tune && !cached) {
+      cost = tuneLoad(load.targetPercent / 100.0 * tick,
+                      options.tolerancePercent / 100.0 * tick, quantumLoad,
+                      cal, options.runs, load.fftSize, load.repeats);
+      report.status = "tuned";
+    } else if (!cached) {
+      cost = loadPhaseCycles(load.fftSize, load.repeats, quantumLoad, cal,
+                             options.runs);
+    }
+    if (!cached)
+      result.achievedPercent = static_cast<double>(cost) / tick * 100.0;
+    if (tune && !cached) {
+      std::ostringstream value;
+      value << load.fftSize << "," << load.repeats << "," << std::fixed
+            << std::setprecision(2) << result.achievedPercent;
+      if (std::fabs(result.achievedPercent - load.targetPercent) >
+          options.tolerancePercent)
+        value << ",best-effort";
+      cache.set(loadTuneKey(load.targetPercent), value.str());
+      cacheDirty = true;
+    }
+
+    result.fftSize = load.fftSize;
+    result.repeats = load.repeats;
+    result.withinTolerance =
+        load.targetPercent <= 0.0 ||
+        std::fabs(result.achievedPercent - load.targetPercent) <=
+            options.tolerancePercent;
+    std::ostringstream msg;
+    msg << std::fixed << std::setprecision(1);
+    if (result.achievedPercent >= 100.0) {
+      msg << "load " << load.name << " takes " << result.achievedPercent
+          << "% of the period; the loaded window measures nothing";
+      report.warnings.push_back(msg.str());
+    } else if (!result.withinTolerance) {
+      msg << "load " << load.name << " reaches " << result.achievedPercent
+          << "%, outside " << load.targetPercent << " +/- "
+          << options.tolerancePercent << "% (closest shape"
+          << (cached ? ", cached; --recalibrate searches again)" : ")");
+      report.warnings.push_back(msg.str());
+    }
+    report.loads.push_back(result);
+  }
+
+  if (cacheDirty && options.useCache && !options.cachePath.empty()) {
+    cache.set("load_context", context);
+    if (!cache.save(options.cachePath))
+      report.warnings.push_back("cannot write calibration cache " +
+                                options.cachePath);
+  }
+  return report;
+}
+
+inline void printLoadTuneReport(const LoadTuneReport &report) {
+  std::cout << "Load tuning: " << report.status << " (quantum load "
+            << std::fixed << std::setprecision(1)
+            << report.quantumCycles * 100.0 /
+                   std::max<uint64_t>(report.centerTick, 1)
+            << "% of the period)\n";
+  for (const auto &r : report.loads) {
+    std::cout << "  " << r.name << ": FFT " << r.fftSize << " x " << r.repeats
+              << " -> " << std::setprecision(1) << r.achievedPercent << "%";
+    if (r.targetPercent > 0.0)
+      std::cout << " (target " << r.targetPercent << "%)";
+    std::cout << "\n";
+  }
+  for (const auto &w : report.warnings)
+    std::cout << "WARNING: " << w << "\n";
+}
+
+#endif // LOAD_TUNER_HPP
@@ -0,0 +1,108 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+// Read-only memory mapping of a whole file (mmap / MapViewOfFile).
+// Used by SampleFileReader and the offline CSV analyzer, which parse
+// straight from the mapping without copying the file.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "QuantumLib.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+class MappedFile {
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() { close(); }
+
+  // Maps the whole file for sequential reading. Empty files fail.
+  bool open(const std::string &path) {
+    close();
+#ifdef _WIN32
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+      return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) {
+      close();
+      return false;
+    }
+    size_ = static_cast<size_t>(size.QuadPart);
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_) {
+      close();
+      return false;
+    }
+    data_ = static_cast<const uint8_t *>(
+        MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+      return false;
+    struct stat st;
+    if (fstat(fd_, &st) != 0 || st.st_size == 0) {
+      close();
+      return false;
+    }
+    size_ = static_cast<size_t>(st.st_size);
+    void *p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    if (p == MAP_FAILED) {
+      close();
+      return false;
+    }
+    madvise(p, size_, MADV_SEQUENTIAL);
+    data_ = static_cast<const uint8_t *>(p);
+#endif
+    if (!data_) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+#ifdef _WIN32
+    if (data_)
+      UnmapViewOfFile(data_);
+    if (mapping_)
+      CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE)
+      CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+#else
+    if (data_)
+      munmap(const_cast<uint8_t *>(data_), size_);
+    if (fd_ >= 0)
+      ::close(fd_);
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  const uint8_t *data() const { return data_; }
+  size_t size() const { return size_; }
+};
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,422 @@
+#ifndef METRICS_SERVER_HPP
+#define METRICS_SERVER_HPP
+
+// Live metrics of a scheduled-mode run in the Prometheus text format.
+// The measuring thread publishes into a MetricsRegistry with relaxed
+// atomic stores only. It is the single writer, so counters are a load and
+// a store rather than a locked read-modify-write, and publishing never
+// blocks or allocates. A housekeeping thread (normal priority, off the
+// measuring core) runs a minimal HTTP/1.0 listener and renders the
+// registry on every GET /metrics. Values are
+// read one by one, so a scrape may pair a pattern's mean from one
+// measurement with its std dev from the next; each value is always whole.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "QuantumLib.hpp"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#ifdef _MSC_VER
+#pragma comment(lib, "ws2_32.lib")
+#endif
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// ========== Registry ==========
+
+struct PatternMetricLabels {
+  std::string pattern; // Schedule name, as in the CSV
+  std::string type;    // "Static" or "Dynamic"
+  std::string fft;     // Load name
+};
+
+class MetricsRegistry {
+  struct PatternMetrics {
+    PatternMetricLabels labels;
+    std::atomic<uint64_t> measurements{0};
+    std::atomic<uint64_t> samples{0};
+    std::atomic<double> mean{0.0};
+    std::atomic<double> stdDev{0.0};
+    std::atomic<int> peakBin{0};
+    std::atomic<double> peakPercent{0.0};
+    std::atomic<double> iterationSeconds{0.0}; // Last measurement
+    std::atomic<int64_t> lastUnixNanos{0};
+  };
+
+  // Fixed before the server starts
+  std::unique_ptr<PatternMetrics[]> patterns_;
+  size_t patternCount_ = 0;
+  CalibrationData cal_{};
+  std::string context_;
+
+  alignas(64) std::atomic<uint64_t> scans_{0};
+  std::atomic<bool> scanActive_{false};
+  std::atomic<int64_t> scanStartNanos_{0}; // steady_clock
+  std::atomic<int64_t> scanEndNanos_{0};
+  std::atomic<int64_t> scanDurationNanos_{0};
+  std::atomic<uint64_t> scanPatterns_{0};
+  std::atomic<uint64_t> logDropped_{0};
+
+  static void bump(std::atomic<uint64_t> &counter, uint64_t by = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + by,
+                  std::memory_order_relaxed);
+  }
+
+public:
+  static int64_t steadyNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  void setup(const std::vector<PatternMetricLabels> &labels,
+             const CalibrationData &cal, const std::string &context) {
+    patternCount_ = labels.size();
+    patterns_.reset(new PatternMetrics[patternCount_]);
+    for (size_t i = 0; i < patternCount_; i++)
+      patterns_[i].labels = labels[i];
+    cal_ = cal;
+    context_ = context;
+  }
+
+  // ----- Measuring thread: relaxed stores only -----
+
+  void scanStarted(int64_t durationNanos) {
+    bump(scans_);
+    scanPatterns_.store(0, std::memory_order_relaxed);
+    scanDurationNanos_.store(durationNanos, std::memory_order_relaxed);
+    scanStartNanos_.store(steadyNanos(), std::memory_order_relaxed);
+    scanActive_.store(true, std::memory_order_relaxed);
+  }
+
+  void scanEnded(uint64_t logDropped) {
+    scanEndNanos_.store(steadyNanos(), std::memory_order_relaxed);
+    scanActive_.store(false, std::memory_order_relaxed);
+    logDropped_.store(logDropped, std::memory_order_relaxed);
+  }
+
+  void patternMeasured(size_t index, double mean, double stdDev,
+                       int peakBin, double peakPercent, uint64_t samples,
+                       double iterationSeconds, int64_t unixNanos) {
+    PatternMetrics &p = patterns_[index];
+    bump(p.measurements);
+    bump(p.samples, samples);
+    p.mean.store(mean, std::memory_order_relaxed);
+    p.stdDev.store(stdDev, std::memory_order_relaxed);
+    p.peakBin.store(peakBin, std::memory_order_relaxed);
+    p.peakPercent.store(peakPercent, std::memory_order_relaxed);
+    p.iterationSeconds.store(iterationSeconds, std::memory_order_relaxed);
+    p.lastUnixNanos.store(unixNanos, std::memory_order_relaxed);
+    bump(scanPatterns_);
+  }
+
+  // ----- Server thread -----
+
+  std::string render() const {
+    std::string out;
+    char line[512];
+    auto header = [&](const char *name, const char *type, const char *help) {
+      std::snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n", name,
+                    help, name, type);
+      out += line;
+    };
+    auto value = [&](const char *name, const std::string &labels, double v) {
+      std::snprintf(line, sizeof(line), "%s%s%s%s %.9g\n", name,
+                    labels.empty() ? "" : "{", labels.c_str(),
+                    labels.empty() ? "" : "}", v);
+      out += line;
+    };
+
+    header("chronos_info", "gauge", "Run mode and kernel context.");
+    value("chronos_info",
+          "mode=\"scheduled\",context=\"" + escape(context_) + "\"", 1.0);
+    header("chronos_cpu_frequency_hz", "gauge", "Calibrated counter rate.");
+    value("chronos_cpu_frequency_hz", "",
+          static_cast<double>(cal_.cpu_freq_hz));
+    header("chronos_tick_cycles", "gauge", "Calibrated tick lengths.");
+    value("chronos_tick_cycles", "tick=\"minus1\"",
+          static_cast<double>(cal_.tick_minus1));
+    value("chronos_tick_cycles", "tick=\"center\"",
+          static_cast<double>(cal_.tick_center));
+    value("chronos_tick_cycles", "tick=\"plus1\"",
+          static_cast<double>(cal_.tick_plus1));
+
+    // Scan progress; rates cover the running scan, or the last one
+    bool active = scanActive_.load(std::memory_order_relaxed);
+    int64_t start = scanStartNanos_.load(std::memory_order_relaxed);
+    int64_t end = active ? steadyNanos()
+                         : scanEndNanos_.load(std::memory_order_relaxed);
+    int64_t duration = scanDurationNanos_.load(std::memory_order_relaxed);
+    uint64_t scanPatterns = scanPatterns_.load(std::memory_order_relaxed);
+    double elapsed = start > 0 && end > start ? (end - start) * 1e-9 : 0.0;
+    header("chronos_scans_total", "counter", "Boundary scans started.");
+    value("chronos_scans_total", "",
+          static_cast<double>(scans_.load(std::memory_order_relaxed)));
+    header("chronos_scan_active", "gauge", "1 while a scan is running.");
+    value("chronos_scan_active", "", active ? 1.0 : 0.0);
+    header("chronos_scan_progress_ratio", "gauge",
+           "Elapsed share of the current scan.");
+    value("chronos_scan_progress_ratio", "",
+          !active ? (start > 0 ? 1.0 : 0.0)
+          : duration > 0 ? std::min(1.0, elapsed / (duration * 1e-9))
+                         : 0.0);
+    header("chronos_scan_patterns", "gauge",
+           "Patterns measured in the current or last scan.");
+    value("chronos_scan_patterns", "", static_cast<double>(scanPatterns));
+    header("chronos_patterns_per_second", "gauge",
+           "Measurement rate of the current or last scan.");
+    value("chronos_patterns_per_second", "",
+          elapsed > 0.0 ? scanPatterns / elapsed : 0.0);
+    header("chronos_log_dropped_lines_total", "counter",
+           "Log lines lost to a full ring, as of the last scan.");
+    value("chronos_log_dropped_lines_total", "",
+          static_cast<double>(logDropped_.load(std::memory_order_relaxed)));
+
+    struct Series {
+      const char *name, *type, *help;
+      double (*get)(const PatternMetrics &);
+    };
+    static const Series series[] = {
+        {"chronos_pattern_measurements_total", "counter",
+         "Measurements of the pattern.",
+         [](const PatternMetrics &p) {
+           return static_cast<double>(p.measurements.load(relaxed));
+         }},
+        {"chronos_pattern_samples_total", "counter",
+         "Samples measured for the pattern.",
+         [](const PatternMetrics &p) {
+           return static_cast<double>(p.samples.load(relaxed));
+         }},
+        {"chronos_pattern_mean_ops", "gauge", "Mean of the last measurement.",
+         [](const PatternMetrics &p) { return p.mean.load(relaxed); }},
+        {"chronos_pattern_stddev_ops", "gauge",
+         "Std dev of the last measurement.",
+         [](const PatternMetrics &p) { return p.stdDev.load(relaxed); }},
+        {"chronos_pattern_peak_bin_ops", "gauge",
+         "Start of the most frequent histogram bin.",
+         [](const PatternMetrics &p) {
+           return static_cast<double>(p.peakBin.load(relaxed));
+         }},
+        {"chronos_pattern_peak_share_percent", "gauge",
+         "Share of the samples in the peak bin.",
+         [](const PatternMetrics &p) { return p.peakPercent.load(relaxed); }},
+        {"chronos_pattern_iteration_seconds", "gauge",
+         "Wall time per iteration of the last measurement.",
+         [](const PatternMetrics &p) {
+           return p.iterationSeconds.load(relaxed);
+         }},
+        {"chronos_pattern_last_measurement_timestamp_seconds", "gauge",
+         "Unix time of the last measurement.",
+         [](const PatternMetrics &p) {
+           return p.lastUnixNanos.load(relaxed) * 1e-9;
+         }},
+    };
+    for (const Series &s : series) {
+      header(s.name, s.type, s.help);
+      for (size_t i = 0; i < patternCount_; i++) {
+        const PatternMetrics &p = patterns_[i];
+        if (p.measurements.load(relaxed) == 0)
+          continue;
+        value(s.name,
+              "pattern=\"" + escape(p.labels.pattern) + "\",type=\"" +
+                  escape(p.labels.type) + "\",fft=\"" +
+                  escape(p.labels.fft) + "\"",
+              s.get(p));
+      }
+    }
+    return out;
+  }
+
+private:
+  static constexpr std::memory_order relaxed = std::memory_order_relaxed;
+
+  // Label values: backslash, quote and newline are escaped
+  static std::string escape(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+      if (c == '\\' || c == '"')
+        out += '\\';
+      if (c == '\n') {
+        out += "\\n";
+        continue;
+      }
+      out += c;
+    }
+    return out;
+  }
+};
+
+// ========== HTTP Listener ==========
+
+struct MetricsServerOptions {
+  int port = 0;                    // 0 = off
+  std::string bind = "127.0.0.1"; // 0.0.0.0 to let other hosts scrape
+  int core = -1;      // Pin the server thread; -1 = not pinned
+  int avoidCore = -1; // Measuring core, left alone when not pinned
+};
+
+// A scraper that hangs up mid-response must not raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int METRICS_SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int METRICS_SEND_FLAGS = 0; // SO_NOSIGPIPE on the socket instead
+#endif
+
+class MetricsServer {
+#ifdef _WIN32
+  using Socket = SOCKET;
+  static constexpr Socket NO_SOCKET = INVALID_SOCKET;
+  static void closeSocket(Socket s) { closesocket(s); }
+#else
+  using Socket = int;
+  static constexpr Socket NO_SOCKET = -1;
+  static void closeSocket(Socket s) { ::close(s); }
+#endif
+
+  const MetricsRegistry *registry_ = nullptr;
+  MetricsServerOptions options_;
+  Socket listen_ = NO_SOCKET;
+  std::atomic<bool> running_{false};
+  std::thread thread_;
+
+  static void sendAll(Socket s, const std::string &data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+      int n = ::send(s, data.data() + sent,
+                     static_cast<int>(data.size() - sent),
+                     METRICS_SEND_FLAGS);
+      if (n <= 0)
+        return;
+      sent += static_cast<size_t>(n);
+    }
+  }
+
+  // One request per connection; anything but GET /metrics is a 404
+  void handle(Socket client) {
+#ifdef _WIN32
+    DWORD timeout = 1000;
+#else
+    timeval timeout{1, 0};
+#endif
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO,
+               reinterpret_cast<const char *>(&timeout), sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+    int noSigpipe = 1;
+    setsockopt(client, SOL_SOCKET, SO_NOSIGPIPE, &noSigpipe,
+               sizeof(noSigpipe));
+#endif
+    std::string request;
+    char buf[1024];
+    while (request.size() < 8192 &&
+           request.find("\r\n\r\n") == std::string::npos) {
+      int n = ::recv(client, buf, sizeof(buf), 0);
+      if (n <= 0)
+        break;
+      request.append(buf, static_cast<size_t>(n));
+    }
+    bool metrics = request.compare(0, 13, "GET /metrics ") == 0 ||
+                   request.compare(0, 13, "GET /metrics?") == 0;
+    std::string body = metrics ? registry_->render() : "not found\n";
+    std::string head = metrics ? "HTTP/1.0 200 OK\r\n"
+                                 "Content-Type: text/plain; version=0.0.4\r\n"
+                               : "HTTP/1.0 404 Not Found\r\n"
+                                 "Content-Type: text/plain\r\n";
+    head += "Content-Length: " + std::to_string(body.size()) +
+            "\r\nConnection: close\r\n\r\n";
+    sendAll(client, head + body);
+    closeSocket(client);
+  }
+
+  void serve() {
+    makeHousekeepingThread(options_.core, options_.avoidCore);
+    while (running_.load(std::memory_order_acquire)) {
+      // Wake up every 200 ms to notice stop()
+      fd_set ready;
+      FD_ZERO(&ready);
+      FD_SET(listen_, &ready);
+      timeval wait{0, 200000};
+      if (select(static_cast<int>(listen_) + 1, &ready, nullptr, nullptr,
+                 &wait) <= 0)
+        continue;
+      Socket client = ::accept(listen_, nullptr, nullptr);
+      if (client != NO_SOCKET)
+        handle(client);
+    }
+  }
+
+public:
+  MetricsServer() = default;
+  MetricsServer(const MetricsServer &) = delete;
+  MetricsServer &operator=(const MetricsServer &) = delete;
+  ~MetricsServer() { stop(); }
+
+  bool start(const MetricsServerOptions &options,
+             const MetricsRegistry &registry, std::string &error) {
+    options_ = options;
+    registry_ = &registry;
+#ifdef _WIN32
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
+      error = "WSAStartup failed";
+      return false;
+    }
+#endif
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(options.port));
+    if (inet_pton(AF_INET, options.bind.c_str(), &addr.sin_addr) != 1) {
+      error = "bad bind address " + options.bind;
+      return false;
+    }
+    listen_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_ == NO_SOCKET) {
+      error = "cannot create socket";
+      return false;
+    }
+    int yes = 1;
+    setsockopt(listen_, SOL_SOCKET, SO_REUSEADDR,
+               reinterpret_cast<const char *>(&yes), sizeof(yes));
+    if (::bind(listen_, reinterpret_cast<const sockaddr *>(&addr),
+               sizeof(addr)) != 0 ||
+        ::listen(listen_, 16) != 0) {
+      error = "cannot listen on " + options.bind + ":" +
+              std::to_string(options.port);
+      closeSocket(listen_);
+      listen_ = NO_SOCKET;
+      return false;
+    }
+    running_.store(true, std::memory_order_release);
+    thread_ = std::thread(&MetricsServer::serve, this);
+    return true;
+  }
+
+  void stop() {
+    if (!running_.exchange(false))
+      return;
+    if (thread_.joinable())
+      thread_.join();
+    closeSocket(listen_);
+    listen_ = NO_SOCKET;
+#ifdef _WIN32
+    WSACleanup();
+#endif
+  }
+};
+
+#endif // METRICS_SERVER_HPP
@@ -0,0 +1,533 @@
+#ifndef PATTERN_CONFIG_HPP
+#define PATTERN_CONFIG_HPP
+
+// Declarative measurement patterns.
+// A pattern config names the FFT loads and the tick schedules that are
+// measured under each of them: static ticks, explicit sequences, frequency
+// sweeps and generated schedules (random, Markov chain, chirp). Schedules
+// are kept as frequencies. compilePatterns() turns them into one flat tick
+// array per (load, schedule) pair, using the run's calibration, before any
+// measurement starts, so the measuring loop only walks an array.
+//
+// One directive per line, '#' starts a comment:
+//   load NAME FFT_SIZE REPEATS [TARGET_PERCENT]
+//   center KHZ                 reference for relative ticks (default 277.3)
+//   iterations N               samples per pattern in full mode
+//   scheduled_iterations N     samples per pattern in scheduled mode
+//   static PREFIX TICK...      one static pattern per tick (PREFIX + TICK)
+//   sequence NAME TICK...      one dynamic pattern cycling through the ticks
+//   sweep from=KHZ to=KHZ step=KHZ
+//                              one static pattern per frequency step
+//   chirp NAME from=KHZ to=KHZ length=N [shape=linear|log] [return=1]
+//   random NAME length=N (from=KHZ to=KHZ | states=TICK,...) [seed=S]
+//   markov NAME length=N states=TICK,... [stay=P | p=ROW;ROW...] [seed=S]
+// A TICK is an absolute frequency in kHz ("276.3") or, written with a sign
+// or as "0", an offset in kHz from the center ("-1", "0", "+1"). The first
+// load line replaces the built-in loads and the first pattern line replaces
+// the built-in patterns.
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "QuantumLib.hpp"
+
+// Built-in config: the 4 FFT loads x (3 static ticks + 5 sequences)
+inline const char *defaultPatternConfigText() {
+  return "load 75% 64 4 75\n"
+         "load 80% 64 5 80\n"
+         "load 85% 128 3 85\n"
+         "load 90% 128 4 90\n"
+         "center 277.3\n"
+         "static Tick -1 0 +1\n"
+         "sequence Original -1 -1 0 +1 +1 0\n"
+         "sequence Alternating +1 -1 +1 -1 +1 -1\n"
+         "sequence Block +1 +1 +1 -1 -1 -1\n"
+         "sequence Mixed 0 -1 +1 0 +1 -1\n"
+         "sequence Sweep -1 0 +1 +1 0 -1\n";
+}
+
+// One schedule before it is paired with the loads
+struct PatternTemplate {
+  std::string name;
+  bool dynamic = false;
+  std::string description;     // Shown in the run header
+  std::vector<double> freqsHz; // One period of the schedule
+};
+
+struct PatternConfig {
+  std::vector<LoadSpec> loads;
+  double centerHz = 277300.0;
+  int iterations = 1000000;
+  int scheduledIterations = 30000;
+  std::vector<PatternTemplate> patterns;
+  bool defaultLoads = false;    // The next load line starts a new list
+  bool defaultPatterns = false; // The next pattern line starts a new list
+};
+
+// Longest generated schedule (one period of a dynamic pattern)
+constexpr size_t PATTERN_MAX_LENGTH = 1u << 24;
+
+inline bool parsePatternNumber(const std::string &text, double &out) {
+  if (text.empty())
+    return false;
+  char *end = nullptr;
+  out = std::strtod(text.c_str(), &end);
+  return end == text.c_str() + text.size() && std::isfinite(out);
+}
+
+// TICK -> Hz: a signed value (or "0") is a kHz offset from the center
+inline bool parseTickFrequency(const std::string &token, double centerHz,
+                               double &hz) {
+  double value;
+  if (!parsePatternNumber(token, value))
+    return false;
+  bool relative = token[0] == '+' || token[0] == '-' || value == 0.0;
+  hz = relative ? centerHz + value * 1000.0 : value * 1000.0;
+  return hz > 0.0;
+}
+
+inline std::string formatKHz(double hz, int precision = 1) {
+  char buf[32];
+  std::snprintf(buf, sizeof(buf), "%.*fkHz", precision, hz / 1000.0);
+  return buf;
+}
+
+// Same stream on every platform (std:: distributions are not portable)
+inline double patternUniform(std::mt19937_64 &gen) {
+  return static_cast<double>(gen() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Splits "key=value" arguments; anything else is an error
+inline bool parsePatternArgs(const std::vector<std::string> &words,
+                             size_t first,
+                             std::map<std::string, std::string> &args,
+                             std::string &error) {
+  for (size_t i = first; i < words.size(); i++) {
+    size_t eq = words[i].find('=');
+    if (eq == std::string::npos || eq == 0) {
+      error = "expected key=value, got '" + words[i] + "'";
+      return false;
+    }
+    args[words[i].substr(0, eq)] = words[i].substr(eq + 1);
+  }
+  return true;
+}
+
+inline bool parseTickList(const std::string &list, double centerHz,
+                          std::vector<double> &freqs, std::string &error) {
+  std::stringstream ss(list);
+  std::string token;
+  while (std::getline(ss, token, ',')) {
+    double hz;
+    if (!parseTickFrequency(token, centerHz, hz)) {
+      error = "bad tick '" + token + "'";
+      return false;
+    }
+    freqs.push_back(hz);
+  }
+  if (freqs.empty()) {
+    error = "empty tick list";
+    return false;
+  }
+  return true;
+}
+
+// Applies one directive to `config`. Returns false with `error` set if the
+// line is malformed; blank and comment lines are accepted.
+inline bool parsePatternLine(PatternConfig &config, const std::string &line,
+                             std::string &error) {
+  std::string text = line.substr(0, line.find('#'));
+  std::stringstream ss(text);
+  std::vector<std::string> words;
+  std::string word;
+  while (ss >> word)
+    words.push_back(word);
+  if (words.empty())
+    return true;
+
+  const std::string &directive = words[0];
+  std::map<std::string, std::string> args;
+  auto number = [&](const std::string &key, double fallback, double &out) {
+    auto it = args.find(key);
+    if (it == args.end()) {
+      out = fallback;
+      return !std::isnan(fallback);
+    }
+    return parsePatternNumber(it->second, out);
+  };
+  auto addPattern = [&](PatternTemplate t) {
+    if (config.defaultPatterns) {
+      config.patterns.clear();
+      config.defaultPatterns = false;
+    }
+    config.patterns.push_back(std::move(t));
+  };
+  const double missing = std::nan("");
+
+  if (directive == "load") {
+    LoadSpec load;
+    double size, repeats, target = 0.0;
+    if (words.size() < 4 || words.size() > 5 ||
+        !parsePatternNumber(words[2], size) ||
+        !parsePatternNumber(words[3], repeats) ||
+        (words.size() == 5 && !parsePatternNumber(words[4], target))) {
+      error = "usage: load NAME FFT_SIZE REPEATS [TARGET_PERCENT]";
+      return false;
+    }
+    int n = static_cast<int>(size);
+    if (n < 2 || n > 4096 || (n & (n - 1)) != 0 || repeats < 1) {
+      error = "FFT size must be a power of two in 2..4096, repeats >= 1";
+      return false;
+    }
+    load.name = words[1];
+    load.fftSize = n;
+    load.repeats = static_cast<int>(repeats);
+    load.targetPercent = target;
+    if (config.defaultLoads) {
+      config.loads.clear();
+      config.defaultLoads = false;
+    }
+    config.loads.push_back(load);
+    return true;
+  }
+
+  if (directive == "center" || directive == "iterations" ||
+      directive == "scheduled_iterations") {
+    double value;
+    if (words.size() != 2 || !parsePatternNumber(words[1], value) ||
+        value <= 0.0) {
+      error = "usage: " + directive + " POSITIVE_NUMBER";
+      return false;
+    }
+    if (directive != "center" &&
+        (value != std::floor(value) ||
+         value > static_cast<double>(std::numeric_limits<int>::max()))) {
+      error = directive + " must be a whole number up to " +
+              std::to_string(std::numeric_limits<int>::max());
+      return false;
+    }
+    if (directive == "center")
+      config.centerHz = value * 1000.0;
+    else if (directive == "iterations")
+      config.iterations = static_cast<int>(value);
+    else
+      config.scheduledIterations = static_cast<int>(value);
+    return true;
+  }
+
+  if (directive == "static" || directive == "sequence") {
+    if (words.size() < 3) {
+      error = "usage: " + directive + " NAME TICK...";
+      return false;
+    }
+    PatternTemplate seq;
+    seq.name = words[1];
+    seq.dynamic = true;
+    for (size_t i = 2; i < words.size(); i++) {
+      double hz;
+      if (!parseTickFrequency(words[i], config.centerHz, hz)) {
+        error = "bad tick '" + words[i] + "'";
+        return false;
+      }
+      if (directive == "static") {
+        PatternTemplate t;
+        t.name = words[1] + words[i];
+        t.description = words[i] + " (" + formatKHz(hz) + ")";
+        t.freqsHz.assign(1, hz);
+        addPattern(t);
+      } else {
+        seq.description += (i > 2 ? "->" : "") + words[i];
+        seq.freqsHz.push_back(hz);
+      }
+    }
+    if (directive == "sequence")
+      addPattern(seq);
+    return true;
+  }
+
+  if (directive == "sweep") {
+    double from, to, step;
+    if (!parsePatternArgs(words, 1, args, error))
+      return false;
+    if (!number("from", missing, from) || !number("to", missing, to) ||
+        !number("step", missing, step) || step <= 0.0 || from <= 0.0 ||
+        to < from) {
+      error = "usage: sweep from=KHZ to=KHZ step=KHZ";
+      return false;
+    }
+    // Enough decimals to tell neighbouring steps apart
+    int precision = 0;
+    while (precision < 6 &&
+           std::fabs(step * std::pow(10.0, precision) -
+                     std::round(step * std::pow(10.0, precision))) > 1e-6)
+      precision++;
+    size_t steps = static_cast<size_t>(std::floor((to - from) / step + 1e-9));
+    if (steps + 1 > PATTERN_MAX_LENGTH) {
+      error = "sweep has too many steps";
+      return false;
+    }
+    for (size_t i = 0; i <= steps; i++) {
+      double hz = (from + step * static_cast<double>(i)) * 1000.0;
+      PatternTemplate t;
+      t.name = formatKHz(hz, precision);
+      t.description = t.name;
+      t.freqsHz.assign(1, hz);
+      addPattern(t);
+    }
+    return true;
+  }
+
+  if (directive == "chirp" || directive == "random" ||
+      directive == "markov") {
+    if (words.size() < 2 || words[1].find('=') != std::string::npos) {
+      error = "usage: " + directive + " NAME key=value...";
+      return false;
+    }
+    if (!parsePatternArgs(words, 2, args, error))
+      return false;
+    double length, seed;
+    if (!number("length", missing, length) || length < 1 ||
+        length > PATTERN_MAX_LENGTH || !number("seed", 1.0, seed)) {
+      error = directive + " needs length=1.." +
+              std::to_string(PATTERN_MAX_LENGTH) + " (and a numeric seed)";
+      return false;
+    }
+    // Seeds are read as doubles: whole numbers up to 2^53 are exact
+    if (seed < 0.0 || seed != std::floor(seed) ||
+        seed > 9007199254740992.0) {
+      error = "seed must be a whole number in 0..2^53";
+      return false;
+    }
+    size_t n = static_cast<size_t>(length);
+    std::mt19937_64 gen(static_cast<uint64_t>(seed));
+    PatternTemplate t;
+    t.name = words[1];
+    t.dynamic = true;
+    char desc[160];
+
+    if (directive == "chirp") {
+      double from, to;
+      std::string shape = args.count("shape") ? args["shape"] : "linear";
+      bool mirror = args.count("return") && args["return"] != "0";
+      if (!number("from", missing, from) || !number("to", missing, to) ||
+          from <= 0.0 || to <= 0.0 || (shape != "linear" && shape != "log")) {
+        error = "usage: chirp NAME from=KHZ to=KHZ length=N "
+                "[shape=linear|log] [return=1]";
+        return false;
+      }
+      for (size_t i = 0; i < n; i++) {
+        double x = n > 1 ? static_cast<double>(i) / (n - 1) : 0.0;
+        double khz = shape == "log" ? from * std::pow(to / from, x)
+                                    : from + (to - from) * x;
+        t.freqsHz.push_back(khz * 1000.0);
+      }
+      // Sweep back down without repeating either end point
+      for (size_t i = n > 2 && mirror ? n - 2 : 0; i > 0; i--)
+        t.freqsHz.push_back(t.freqsHz[i]);
+      std::snprintf(desc, sizeof(desc), "chirp %.3f->%.3f kHz, %zu steps%s%s",
+                    from, to, n, shape == "log" ? " (log)" : "",
+                    mirror ? " and back" : "");
+    } else if (directive == "random") {
+      std::vector<double> states;
+      double from, to;
+      if (args.count("states")) {
+        if (!parseTickList(args["states"], config.centerHz, states, error))
+          return false;
+        for (size_t i = 0; i < n; i++) {
+          size_t k = static_cast<size_t>(patternUniform(gen) * states.size());
+          t.freqsHz.push_back(states[std::min(k, states.size() - 1)]);
+        }
+        std::snprintf(desc, sizeof(desc),
+                      "random over %s, %zu steps, seed %.0f",
+                      args["states"].c_str(), n, seed);
+      } else if (number("from", missing, from) && number("to", missing, to) &&
+                 from > 0.0 && to >= from) {
+        for (size_t i = 0; i < n; i++)
+          t.freqsHz.push_back((from + (to - from) * patternUniform(gen)) *
+                              1000.0);
+        std::snprintf(desc, sizeof(desc),
+                      "random %.3f-%.3f kHz, %zu steps, seed %.0f", from, to,
+                      n, seed);
+      } else {
+        error = "usage: random NAME length=N (from=KHZ to=KHZ | "
+                "states=TICK,...) [seed=S]";
+        return false;
+      }
+    } else {
+      std::vector<double> states;
+      if (!args.count("states") ||
+          !parseTickList(args["states"], config.centerHz, states, error)) {
+        if (error.empty())
+          error = "markov needs states=TICK,...";
+        return false;
+      }
+      size_t k = states.size();
+      // Row-stochastic transition matrix, row i = from state i
+      std::vector<std::vector<double>> p(k, std::vector<double>(k, 0.0));
+      if (args.count("p")) {
+        std::stringstream rows(args["p"]);
+        std::string row;
+        size_t r = 0;
+        for (; std::getline(rows, row, ';'); r++) {
+          std::stringstream cols(row);
+          std::string col;
+          size_t c = 0;
+          double sum = 0.0;
+          for (; r < k && std::getline(cols, col, ','); c++) {
+            if (c >= k || !parsePatternNumber(col, p[r][c]) || p[r][c] < 0) {
+              c = k + 1;
+              break;
+            }
+            sum += p[r][c];
+          }
+          if (r >= k || c != k || sum <= 0.0) {
+            error = "p= must be " + std::to_string(k) + " rows of " +
+                    std::to_string(k) + " non-negative weights";
+            return false;
+          }
+          for (double &w : p[r])
+            w /= sum;
+        }
+        if (r != k) {
+          error = "p= must have one row per state";
+          return false;
+        }
+      } else {
+        double stay;
+        if (!number("stay", 0.8, stay) || stay < 0.0 || stay > 1.0) {
+          error = "stay= must be a probability";
+          return false;
+        }
+        for (size_t r = 0; r < k; r++)
+          for (size_t c = 0; c < k; c++)
+            p[r][c] = k == 1 ? 1.0 : r == c ? stay : (1.0 - stay) / (k - 1);
+      }
+      size_t state = 0;
+      for (size_t i = 0; i < n; i++) {
+        t.freqsHz.push_back(states[state]);
+        double u = patternUniform(gen);
+        size_t next = 0;
+        for (double acc = p[state][0]; next + 1 < k && u >= acc;)
+          acc += p[state][++next];
+        state = next;
+      }
+      std::snprintf(desc, sizeof(desc),
+                    "markov over %s, %zu steps, seed %.0f",
+                    args["states"].c_str(), n, seed);
+    }
+    t.description = desc;
+    addPattern(t);
+    return true;
+  }
+
+  error = "unknown directive '" + directive + "'";
+  return false;
+}
+
+// Applies a whole config text; `source` names it in error messages
+inline bool parsePatternText(PatternConfig &config, const std::string &text,
+                             const std::string &source, std::string &error) {
+  std::stringstream ss(text);
+  std::string line;
+  for (int lineNo = 1; std::getline(ss, line); lineNo++) {
+    if (!parsePatternLine(config, line, error)) {
+      error = source + ":" + std::to_string(lineNo) + ": " + error;
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool loadPatternConfig(PatternConfig &config, const std::string &path,
+                              std::string &error) {
+  std::ifstream in(path);
+  if (!in) {
+    error = "cannot read pattern config " + path;
+    return false;
+  }
+  std::stringstream text;
+  text << in.rdbuf();
+  return parsePatternText(config, text.str(), path, error);
+}
+
+// The built-in patterns, marked so that user lines replace them
+inline PatternConfig defaultPatternConfig() {
+  PatternConfig config;
+  std::string error;
+  parsePatternText(config, defaultPatternConfigText(), "default", error);
+  config.defaultLoads = true;
+  config.defaultPatterns = true;
+  return config;
+}
+
+// One (load, schedule) pair ready to measure
+struct CompiledPattern {
+  std::string key;  // e.g. "FFT75% Tick0", "Dynamic FFT75% Original"
+  std::string name; // Schedule name, e.g. "Tick0", "Original"
+  size_t load = 0;  // Index into PatternPlan::loads
+  bool dynamic = false;
+  std::vector<uint64_t> ticks; // One period, measured in order and repeated
+};
+
+struct PatternPlan {
+  std::vector<LoadSpec> loads;
+  std::vector<PatternTemplate> templates;
+  std::vector<CompiledPattern> patterns; // Static ones first, load-major
+  size_t staticCount = 0;
+  double centerHz = 277300.0;
+  int iterations = 1000000;
+  int scheduledIterations = 30000;
+};
+
+// Pairs every schedule with every load and converts frequencies to ticks
+inline PatternPlan compilePatterns(const PatternConfig &config,
+                                   const CalibrationData &cal) {
+  PatternPlan plan;
+  plan.loads = config.loads;
+  plan.templates = config.patterns;
+  plan.centerHz = config.centerHz;
+  plan.iterations = config.iterations;
+  plan.scheduledIterations = config.scheduledIterations;
+  for (bool dynamic : {false, true}) {
+    for (size_t l = 0; l < plan.loads.size(); l++) {
+      for (const auto &t : plan.templates) {
+        if (t.dynamic != dynamic)
+          continue;
+        CompiledPattern p;
+        p.name = t.name;
+        p.key = (dynamic ? "Dynamic FFT" : "FFT") + plan.loads[l].name + " " +
+                t.name;
+        p.load = l;
+        p.dynamic = dynamic;
+        p.ticks.reserve(t.freqsHz.size());
+        for (double hz : t.freqsHz)
+          p.ticks.push_back(std::max<uint64_t>(
+              1, calculateTicksFromFrequency(cal.cpu_freq_hz, hz)));
+        plan.patterns.push_back(std::move(p));
+      }
+    }
+    if (!dynamic)
+      plan.staticCount = plan.patterns.size();
+  }
+  return plan;
+}
+
+// "1M", "30K" or the plain number
+inline std::string formatSampleCount(int n) {
+  if (n >= 1000000 && n % 1000000 == 0)
+    return std::to_string(n / 1000000) + "M";
+  if (n >= 1000 && n % 1000 == 0)
+    return std::to_string(n / 1000) + "K";
+  return std::to_string(n);
+}
+
+#endif // PATTERN_CONFIG_HPP
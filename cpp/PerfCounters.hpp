@@ -0,0 +1,318 @@
+#ifndef PERF_COUNTERS_HPP
+#define PERF_COUNTERS_HPP
+
+// Optional per-pattern performance counters (Linux perf_event_open).
+// Each measuring thread opens its own counters. The hardware events form
+// one group so they are scheduled together. When the kernel allows user
+// space counter reads (cap_user_rdpmc), each event is read with rdpmc
+// around the loaded phase of every sample, with no syscalls. Whole-pattern
+// totals for every event, software ones included, are read with read()
+// before and after the pattern. When the kernel multiplexes more events
+// than there are hardware counters, those totals are scaled by the time
+// the event was enabled over the time it actually counted, and marked as
+// scaled. Anything that cannot be opened is left out, and on other
+// platforms the set is simply unavailable.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+enum PerfCounterId {
+  PERF_CYCLES,
+  PERF_INSTRUCTIONS,
+  PERF_L1D_MISSES,
+  PERF_LLC_MISSES,
+  PERF_BRANCH_MISSES,
+  PERF_CONTEXT_SWITCHES,
+  PERF_PAGE_FAULTS,
+  PERF_COUNTER_COUNT
+};
+
+// Events that can be read from user space around the loaded phase
+constexpr int PERF_HARDWARE_COUNT = PERF_CONTEXT_SWITCHES;
+
+inline const char *perfCounterName(int id) {
+  static const char *names[PERF_COUNTER_COUNT] = {
+      "cycles",        "instructions",     "L1D misses", "LLC misses",
+      "branch misses", "context switches", "page faults"};
+  return names[id];
+}
+
+// Per-pattern totals filled by PerfCounterSet
+struct PerfTotals {
+  bool available[PERF_COUNTER_COUNT] = {};
+  uint64_t pattern[PERF_COUNTER_COUNT] = {}; // Whole pattern (read())
+  bool scaled[PERF_COUNTER_COUNT] = {};      // pattern[] was multiplexed
+  bool loadPhaseValid = false;               // loadPhase[] was collected
+  uint64_t loadPhase[PERF_HARDWARE_COUNT] = {}; // Summed over samples
+  uint64_t loadSamples = 0; // Samples with a valid loaded-phase reading
+};
+
+class PerfCounterSet {
+  int fds_[PERF_COUNTER_COUNT];
+  void *pages_[PERF_HARDWARE_COUNT] = {};
+  int hwLeader_ = -1;
+  bool rdpmc_ = false;
+  // read() with PERF_FORMAT_TOTAL_TIME_ENABLED | _RUNNING
+  struct Reading {
+    uint64_t value = 0;
+    uint64_t enabled = 0; // ns the event was enabled
+    uint64_t running = 0; // ns it was on a hardware counter
+  };
+  Reading patternStart_[PERF_COUNTER_COUNT];
+  uint64_t loadStart_[PERF_HARDWARE_COUNT] = {};
+  bool loadStartValid_ = false;
+  std::string error_;
+
+#ifdef __linux__
+  static int openEvent(uint32_t type, uint64_t config, int groupFd,
+                       bool excludeKernel) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd < 0 ? 1 : 0;
+    attr.exclude_kernel = excludeKernel ? 1 : 0;
+    attr.exclude_hv = 1;
+    attr.read_format =
+        PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1,
+                                    groupFd, PERF_FLAG_FD_CLOEXEC));
+  }
+
+  static uint64_t cacheMiss(uint64_t cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+           (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  }
+
+  static bool readCounter(int fd, Reading &r) {
+    return fd >= 0 && read(fd, &r, sizeof(r)) == sizeof(r);
+  }
+
+  // Seqlock read of a counter through its mmap page; false if the event is
+  // not currently on a hardware counter
+  static bool readUserCounter(void *page, uint64_t &value) {
+#if defined(__x86_64__)
+    auto *pc = static_cast<volatile perf_event_mmap_page *>(page);
+    uint32_t seq;
+    bool ok;
+    do {
+      seq = pc->lock;
+      __asm__ __volatile__("" ::: "memory");
+      uint32_t idx = pc->index;
+      ok = pc->cap_user_rdpmc && idx != 0;
+      if (ok) {
+        uint32_t lo, hi;
+        __asm__ __volatile__("rdpmc" : "=a"(lo), "=d"(hi) : "c"(idx - 1));
+        uint64_t pmc = (static_cast<uint64_t>(hi) << 32) | lo;
+        uint16_t width = pc->pmc_width;
+        int64_t signedPmc =
+            static_cast<int64_t>(pmc << (64 - width)) >> (64 - width);
+        value = pc->offset + signedPmc;
+      }
+      __asm__ __volatile__("" ::: "memory");
+    } while (pc->lock != seq);
+    return ok;
+#else
+    (void)page;
+    (void)value;
+    return false;
+#endif
+  }
+#endif
+
+public:
+  PerfCounterSet() {
+    for (int &fd : fds_)
+      fd = -1;
+  }
+  PerfCounterSet(const PerfCounterSet &) = delete;
+  PerfCounterSet &operator=(const PerfCounterSet &) = delete;
+  ~PerfCounterSet() { close(); }
+
+  // Opens what the kernel permits for the calling thread. Returns false
+  // (see error()) if no counter at all could be opened.
+  bool open() {
+#ifdef __linux__
+    const struct {
+      uint32_t type;
+      uint64_t config;
+    } events[PERF_COUNTER_COUNT] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_L1D)},
+        {PERF_TYPE_HW_CACHE, cacheMiss(PERF_COUNT_HW_CACHE_LL)},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS}};
+
+    int firstErrno = 0;
+    for (int id = 0; id < PERF_COUNTER_COUNT; id++) {
+      bool hardware = id < PERF_HARDWARE_COUNT;
+      int group = hardware ? hwLeader_ : -1;
+      // User-only counting works under perf_event_paranoid=2; software
+      // events try kernel-inclusive first (context switches happen there)
+      int fd = openEvent(events[id].type, events[id].config, group,
+                         hardware);
+      if (fd < 0 && !hardware)
+        fd = openEvent(events[id].type, events[id].config, group, true);
+      if (fd < 0) {
+        if (!firstErrno)
+          firstErrno = errno;
+        continue;
+      }
+      fds_[id] = fd;
+      if (hardware && hwLeader_ < 0)
+        hwLeader_ = fd;
+      if (!hardware)
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    if (hwLeader_ >= 0)
+      ioctl(hwLeader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    // User-space reads need each event's first mmap page
+    rdpmc_ = hwLeader_ >= 0;
+    for (int id = 0; id < PERF_HARDWARE_COUNT; id++) {
+      if (fds_[id] < 0)
+        continue;
+      void *page = mmap(nullptr, sysconf(_SC_PAGESIZE), PROT_READ,
+                        MAP_SHARED, fds_[id], 0);
+      if (page == MAP_FAILED) {
+        rdpmc_ = false;
+        continue;
+      }
+      pages_[id] = page;
+      if (!static_cast<perf_event_mmap_page *>(page)->cap_user_rdpmc)
+        rdpmc_ = false;
+    }
+
+    bool any = false;
+    for (int fd : fds_)
+      any = any || fd >= 0;
+    if (!any) {
+      error_ = std::strerror(firstErrno);
+      if (firstErrno == EACCES || firstErrno == EPERM)
+        error_ += " (check /proc/sys/kernel/perf_event_paranoid)";
+    } else if (firstErrno) {
+      error_ = std::string("some events unavailable: ") +
+               std::strerror(firstErrno);
+    }
+    return any;
+#else
+    error_ = "perf events are only supported on Linux";
+    return false;
+#endif
+  }
+
+  void close() {
+#ifdef __linux__
+    for (int id = 0; id < PERF_HARDWARE_COUNT; id++) {
+      if (pages_[id])
+        munmap(pages_[id], sysconf(_SC_PAGESIZE));
+      pages_[id] = nullptr;
+    }
+    for (int &fd : fds_) {
+      if (fd >= 0)
+        ::close(fd);
+      fd = -1;
+    }
+#endif
+    hwLeader_ = -1;
+    rdpmc_ = false;
+  }
+
+  bool isOpen(int id) const { return fds_[id] >= 0; }
+  bool userReadable() const { return rdpmc_; }
+  const std::string &error() const { return error_; }
+
+  // e.g. "cycles instructions ... (loaded phase via rdpmc)"
+  std::string describe() const {
+    std::string s;
+    for (int id = 0; id < PERF_COUNTER_COUNT; id++) {
+      if (fds_[id] >= 0)
+        s += std::string(s.empty() ? "" : ", ") + perfCounterName(id);
+    }
+    if (s.empty())
+      return "none";
+    s += rdpmc_ ? " (loaded phase via rdpmc)"
+                : " (pattern totals only, no rdpmc)";
+    return s;
+  }
+
+  void beginPattern() {
+#ifdef __linux__
+    for (int id = 0; id < PERF_COUNTER_COUNT; id++)
+      readCounter(fds_[id], patternStart_[id]);
+#endif
+  }
+
+  void endPattern(PerfTotals &totals) {
+#ifdef __linux__
+    for (int id = 0; id < PERF_COUNTER_COUNT; id++) {
+      Reading end;
+      if (!readCounter(fds_[id], end))
+        continue;
+      const Reading &start = patternStart_[id];
+      uint64_t delta = end.value - start.value;
+      uint64_t enabled = end.enabled - start.enabled;
+      uint64_t running = end.running - start.running;
+      if (running == 0 && enabled > 0)
+        continue; // Never scheduled during the pattern: nothing to scale
+      if (running < enabled) {
+        delta = static_cast<uint64_t>(static_cast<double>(delta) *
+                                      enabled / running);
+        totals.scaled[id] = true;
+      }
+      totals.available[id] = true;
+      totals.pattern[id] += delta;
+    }
+#else
+    (void)totals;
+#endif
+  }
+
+  // Bracket the loaded phase of one sample (no-ops without rdpmc)
+  inline void loadBegin() {
+#ifdef __linux__
+    if (!rdpmc_)
+      return;
+    loadStartValid_ = true;
+    for (int id = 0; id < PERF_HARDWARE_COUNT; id++) {
+      if (pages_[id] && !readUserCounter(pages_[id], loadStart_[id]))
+        loadStartValid_ = false;
+    }
+#endif
+  }
+
+  inline void loadEnd(PerfTotals &totals) {
+#ifdef __linux__
+    if (!rdpmc_ || !loadStartValid_)
+      return;
+    uint64_t end[PERF_HARDWARE_COUNT] = {};
+    for (int id = 0; id < PERF_HARDWARE_COUNT; id++) {
+      if (pages_[id] && !readUserCounter(pages_[id], end[id]))
+        return; // Counter was descheduled; drop this sample
+    }
+    for (int id = 0; id < PERF_HARDWARE_COUNT; id++) {
+      if (pages_[id])
+        totals.loadPhase[id] += end[id] - loadStart_[id];
+    }
+    totals.loadPhaseValid = true;
+    totals.loadSamples++;
+#else
+    (void)totals;
+#endif
+  }
+};
+
+#endif // PERF_COUNTERS_HPP
@@ -2,24 +2,42 @@
 #define QUANTUM_LIB_HPP
 
 // For M_PI on Windows/MSVC - must be before cmath
+#ifndef _USE_MATH_DEFINES
 #define _USE_MATH_DEFINES
+#endif
 #include <cmath>
 
 #include <algorithm>
+#include <array>
 #include <chrono>
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
+#include <memory>
 #include <random>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <utility>
+#include <vector>
+
+#include "QubitRegister.hpp"
+#include "SimdKernels.hpp"
 
 #ifdef _WIN32
 #define NOMINMAX // Prevent Windows min/max macro conflicts
 #include <intrin.h>
+#include <winsock2.h> // Before windows.h, which would pull in winsock 1
 #include <windows.h>
 #else
 #include <pthread.h>
 #include <unistd.h>
+#ifdef __APPLE__
+#include <mach/mach.h>
+#include <mach/thread_policy.h>
+#else
+#include <sched.h>
+#endif
 #endif
 
 // RDTSC wrapper
@@ -38,6 +56,117 @@ inline uint64_t getCycleCount() {
 #endif
 }
 
+// Serialized timer reads for timing a region:
+//   uint64_t t0 = cycleStart(); ...work...; uint64_t t1 = cycleStop();
+// cycleStart waits for earlier instructions to finish before reading and
+// keeps the region from starting before the read; cycleStop waits for the
+// region to retire before reading and keeps later work out of it.
+// x86: lfence;rdtsc;lfence / rdtscp;lfence.  ARM64: isb around cntvct_el0.
+inline uint64_t cycleStart() {
+#ifdef _WIN32
+  _mm_lfence();
+  uint64_t t = __rdtsc();
+  _mm_lfence();
+  return t;
+#elif defined(__x86_64__) || defined(_M_X64)
+  uint32_t lo, hi;
+  __asm__ __volatile__("lfence\n\trdtsc\n\tlfence"
+                       : "=a"(lo), "=d"(hi)
+                       :
+                       : "memory");
+  return ((uint64_t)hi << 32) | lo;
+#else
+  uint64_t val;
+  __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0\n\tisb"
+                       : "=r"(val)
+                       :
+                       : "memory");
+  return val;
+#endif
+}
+
+inline uint64_t cycleStop() {
+#ifdef _WIN32
+  unsigned int aux;
+  uint64_t t = __rdtscp(&aux);
+  _mm_lfence();
+  return t;
+#elif defined(__x86_64__) || defined(_M_X64)
+  uint32_t lo, hi;
+  __asm__ __volatile__("rdtscp\n\tlfence"
+                       : "=a"(lo), "=d"(hi)
+                       :
+                       : "rcx", "memory");
+  return ((uint64_t)hi << 32) | lo;
+#else
+  uint64_t val;
+  __asm__ __volatile__("isb\n\tmrs %0, cntvct_el0\n\tisb"
+                       : "=r"(val)
+                       :
+                       : "memory");
+  return val;
+#endif
+}
+
+inline const char *cycleTimerName() {
+#if defined(_WIN32) || defined(__x86_64__) || defined(_M_X64)
+  return "lfence+rdtsc / rdtscp+lfence";
+#else
+  return "isb+cntvct_el0";
+#endif
+}
+
+// Cost of an empty cycleStart()/cycleStop() pair, in timer ticks
+struct TimerCalibration {
+  uint64_t overhead = 0; // Median; subtracted from timed regions
+  uint64_t minimum = 0;
+  uint64_t p99 = 0;
+  double jitter = 0.0; // Median absolute deviation from `overhead`
+};
+
+inline TimerCalibration calibrateTimer(int samples = 20000) {
+  std::vector<uint64_t> d(samples);
+  for (int i = 0; i < 1000; i++) { // Warm the path
+    uint64_t t0 = cycleStart();
+    d[0] = cycleStop() - t0;
+  }
+  for (int i = 0; i < samples; i++) {
+    uint64_t t0 = cycleStart();
+    uint64_t t1 = cycleStop();
+    d[i] = t1 - t0;
+  }
+  std::sort(d.begin(), d.end());
+
+  TimerCalibration tc;
+  tc.overhead = d[samples / 2];
+  tc.minimum = d[0];
+  tc.p99 = d[samples * 99 / 100];
+  std::vector<double> dev(samples);
+  for (int i = 0; i < samples; i++)
+    dev[i] = std::fabs(static_cast<double>(d[i]) -
+                       static_cast<double>(tc.overhead));
+  std::nth_element(dev.begin(), dev.begin() + samples / 2, dev.end());
+  tc.jitter = dev[samples / 2];
+  return tc;
+}
+
+// Median cycle count of `runs` calls to fn (after a few warmup calls),
+// net of the timer overhead
+template <typename Fn>
+inline uint64_t medianCycles(Fn fn, int runs, uint64_t timerOverhead = 0) {
+  for (int i = 0; i < 10; i++)
+    fn();
+  std::vector<uint64_t> cycles(runs);
+  for (int i = 0; i < runs; i++) {
+    uint64_t start = cycleStart();
+    fn();
+    uint64_t elapsed = cycleStop() - start;
+    cycles[i] = elapsed > timerOverhead ? elapsed - timerOverhead : 0;
+  }
+  std::nth_element(cycles.begin(), cycles.begin() + runs / 2, cycles.end());
+  return cycles[runs / 2];
+}
+
 // NOP wrapper
 inline void nop() {
 #ifdef _WIN32
@@ -48,16 +177,97 @@ inline void nop() {
 }
 
 // Set thread priority
-inline void setHighPriority() {
+// Returns false if the OS refused (e.g. no privilege for SCHED_FIFO)
+inline bool setHighPriority() {
 #ifdef _WIN32
-  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+  return SetThreadPriority(GetCurrentThread(),
+                           THREAD_PRIORITY_TIME_CRITICAL) != 0;
 #else
   // macOS/Linux
   pthread_t thread = pthread_self();
   int policy = SCHED_FIFO;
   struct sched_param param;
   param.sched_priority = sched_get_priority_max(policy);
-  pthread_setschedparam(thread, policy, &param);
+  return pthread_setschedparam(thread, policy, &param) == 0;
+#endif
+}
+
+// Cores a thread can be pinned to: one affinity mask on Windows (a
+// single processor group), the cpu_set_t size on Linux
+#ifdef _WIN32
+constexpr int MAX_PINNABLE_CORES = static_cast<int>(sizeof(DWORD_PTR) * 8);
+#elif defined(__APPLE__)
+constexpr int MAX_PINNABLE_CORES = 1024;
+#else
+constexpr int MAX_PINNABLE_CORES = CPU_SETSIZE;
+#endif
+
+// Pin the calling thread to a single logical core.
+// Returns false if the OS refused (or only accepts it as a hint, as on macOS).
+inline bool pinCurrentThreadToCore(int core) {
+  if (core < 0 || core >= MAX_PINNABLE_CORES)
+    return false;
+#ifdef _WIN32
+  DWORD_PTR mask = DWORD_PTR(1) << core;
+  return SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined(__APPLE__)
+  // macOS has no hard affinity; an affinity tag only groups threads.
+  thread_affinity_policy_data_t policy = {core + 1};
+  thread_policy_set(pthread_mach_thread_np(pthread_self()),
+                    THREAD_AFFINITY_POLICY, (thread_policy_t)&policy,
+                    THREAD_AFFINITY_POLICY_COUNT);
+  return false;
+#else
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(core, &set);
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#endif
+}
+
+// Turn the calling helper thread (log writer, metrics server) into a
+// housekeeping thread. New threads inherit the creator's affinity and
+// real-time policy, so a helper started by the pinned SCHED_FIFO measuring
+// thread would share its core at equal priority. This drops it to normal
+// priority and pins it to `core`, or with core = -1 allows every core but
+// `avoidCore`. Returns false if either step was refused.
+inline bool makeHousekeepingThread(int core, int avoidCore) {
+#ifdef _WIN32
+  bool ok = SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+  if (core >= 0)
+    return pinCurrentThreadToCore(core) && ok;
+  DWORD_PTR processMask = 0, systemMask = 0;
+  if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask,
+                              &systemMask))
+    return false;
+  if (avoidCore >= 0 && avoidCore < MAX_PINNABLE_CORES &&
+      processMask != (DWORD_PTR(1) << avoidCore))
+    processMask &= ~(DWORD_PTR(1) << avoidCore);
+  return SetThreadAffinityMask(GetCurrentThread(), processMask) != 0 && ok;
+#else
+  struct sched_param param;
+  param.sched_priority = 0;
+  bool ok = pthread_setschedparam(pthread_self(), SCHED_OTHER, &param) == 0;
+#ifdef __APPLE__
+  (void)avoidCore; // No hard affinity to get away from
+  if (core >= 0)
+    pinCurrentThreadToCore(core);
+  return ok;
+#else
+  if (core >= 0)
+    return pinCurrentThreadToCore(core) && ok;
+  long configured = sysconf(_SC_NPROCESSORS_CONF);
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int c = 0; c < configured && c < MAX_PINNABLE_CORES; c++) {
+    if (c != avoidCore)
+      CPU_SET(c, &set);
+  }
+  if (CPU_COUNT(&set) == 0)
+    return ok; // Single-core host: nowhere else to go
+  return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 &&
+         ok;
+#endif
 #endif
 }
 
@@ -88,8 +298,9 @@ struct Complex {
 class Qubit {
   Complex alpha;
   Complex beta;
-  static std::mt19937 rng;
-  static std::uniform_real_distribution<double> dist;
+  // Per-thread so that parallel workers never share generator state
+  static thread_local std::mt19937 rng;
+  static thread_local std::uniform_real_distribution<double> dist;
 
 public:
   Qubit() : alpha(1.0, 0.0), beta(0.0, 0.0) {}
@@ -131,6 +342,20 @@ public:
     beta = newBeta;
   }
 
+  // Arbitrary 2x2 unitary {m00r, m00i, m01r, m01i, m10r, m10i, m11r, m11i}
+  void applyMatrix(const double *m) {
+    Complex newAlpha(m[0] * alpha.real - m[1] * alpha.imag +
+                         m[2] * beta.real - m[3] * beta.imag,
+                     m[0] * alpha.imag + m[1] * alpha.real +
+                         m[2] * beta.imag + m[3] * beta.real);
+    Complex newBeta(m[4] * alpha.real - m[5] * alpha.imag +
+                        m[6] * beta.real - m[7] * beta.imag,
+                    m[4] * alpha.imag + m[5] * alpha.real +
+                        m[6] * beta.imag + m[7] * beta.real);
+    alpha = newAlpha;
+    beta = newBeta;
+  }
+
   int measure() {
     double p0 = alpha.squaredModulus();
     return dist(rng) < p0 ? 0 : 1;
@@ -142,8 +367,9 @@ public:
 };
 
 // Static member initialization
-inline std::mt19937 Qubit::rng(std::random_device{}());
-inline std::uniform_real_distribution<double> Qubit::dist(0.0, 1.0);
+inline thread_local std::mt19937 Qubit::rng(std::random_device{}());
+inline thread_local std::uniform_real_distribution<double> Qubit::dist(0.0,
+                                                                       1.0);
 
 // ========== CPU Calibration Functions ==========
 
@@ -151,12 +377,12 @@ inline std::uniform_real_distribution<double> Qubit::dist(0.0, 1.0);
 inline uint64_t measureCPUFrequency() {
   // 100msの間にカウントされるサイクル数を測定
   auto start_time = std::chrono::high_resolution_clock::now();
-  uint64_t start_cycles = getCycleCount();
+  uint64_t start_cycles = cycleStart();
 
   std::this_thread::sleep_for(std::chrono::milliseconds(100));
 
+  uint64_t end_cycles = cycleStop();
   auto end_time = std::chrono::high_resolution_clock::now();
-  uint64_t end_cycles = getCycleCount();
 
   auto duration = std::chrono::duration_cast<std::chrono::microseconds>(
                       end_time - start_time)
@@ -186,31 +412,17 @@ inline uint64_t calculateTicksFromFrequency(uint64_t cpu_freq_hz,
 // キャリブレーション情報を保持する構造体
 struct CalibrationData {
   uint64_t cpu_freq_hz;
+  double cpu_freq_ci_hz = 0.0; // 95% CI half-width (0 = single sample)
   uint64_t tick_center; // 277.3 kHz (3.606 μs)
   uint64_t tick_minus1; // 276.3 kHz (3.619 μs)
   uint64_t tick_plus1;  // 278.3 kHz (3.593 μs)
+  TimerCalibration timer; // cycleStart/cycleStop overhead
 };
 
-// CPU周波数を測定してキャリブレーション
-// Default: 2.4 GHz (for Intel Core i5-6200U and similar CPUs)
-inline CalibrationData calibrateCPU(uint64_t override_freq_hz = 0) {
+// 周波数からtick値を計算してキャリブレーションを構築
+inline CalibrationData calibrationFromFrequency(uint64_t cpu_freq_hz) {
   CalibrationData cal;
-
-  if (override_freq_hz > 0) {
-    // Use override frequency if provided
-    cal.cpu_freq_hz = override_freq_hz;
-  } else {
-    // Try to measure CPU frequency
-    uint64_t measured = measureCPUFrequency();
-
-    // Use measured value if reasonable (> 1 GHz)
-    // Otherwise use 2.4 GHz default for Intel i5-6200U
-    if (measured > 1000000000ULL) {
-      cal.cpu_freq_hz = measured;
-    } else {
-      cal.cpu_freq_hz = 2400000000ULL; // 2.4 GHz default
-    }
-  }
+  cal.cpu_freq_hz = cpu_freq_hz;
 
   // 277.3 kHz +/- 1 kHz
   cal.tick_center =
@@ -220,18 +432,57 @@ inline CalibrationData calibrateCPU(uint64_t override_freq_hz = 0) {
   cal.tick_plus1 =
       calculateTicksFromFrequency(cal.cpu_freq_hz, 278300.0); // 278.3 kHz
 
+  cal.timer = calibrateTimer();
+
   return cal;
 }
 
+// Counter rates below this are measurement failures. ARM64's generic
+// timer runs at 24 MHz, so anything GHz-based would reject it.
+constexpr uint64_t MIN_PLAUSIBLE_TIMER_HZ = 1000000ULL;
+
+// CPU周波数を測定してキャリブレーション
+// Single 100 ms sample, no cache; TscCalibration.hpp has the cached version
+// Default: 2.4 GHz (for Intel Core i5-6200U and similar CPUs)
+inline CalibrationData calibrateCPU(uint64_t override_freq_hz = 0) {
+  if (override_freq_hz > 0) {
+    // Use override frequency if provided
+    return calibrationFromFrequency(override_freq_hz);
+  }
+
+  // Try to measure CPU frequency
+  uint64_t measured = measureCPUFrequency();
+
+  // Use measured value if plausible
+  // Otherwise use 2.4 GHz default for Intel i5-6200U
+  if (measured >= MIN_PLAUSIBLE_TIMER_HZ) {
+    return calibrationFromFrequency(measured);
+  }
+  std::cout << "WARNING: measured CPU frequency " << measured
+            << " Hz is implausible; FALLING BACK TO 2.4 GHz. All tick "
+               "targets are likely wrong.\n";
+  return calibrationFromFrequency(2400000000ULL); // 2.4 GHz default
+}
+
 // キャリブレーション情報を表示
 inline void printCalibrationInfo(const CalibrationData &cal) {
   std::cout << "CPU Frequency: " << std::fixed << std::setprecision(2)
-            << (cal.cpu_freq_hz / 1e9) << " GHz\n";
+            << (cal.cpu_freq_hz / 1e9) << " GHz";
+  if (cal.cpu_freq_ci_hz > 0) {
+    std::cout << " (+/-" << std::setprecision(3) << (cal.cpu_freq_ci_hz / 1e3)
+              << " kHz, 95% CI)" << std::setprecision(2);
+  }
+  std::cout << "\n";
   std::cout << "Calibrated for 3.6μs base period (277.3 kHz region):\n";
   std::cout << "  Tick " << cal.tick_minus1 << " → 276.3 kHz (3.619 μs)\n";
   std::cout << "  Tick " << cal.tick_center
             << " → 277.3 kHz (3.606 μs, center)\n";
   std::cout << "  Tick " << cal.tick_plus1 << " → 278.3 kHz (3.593 μs)\n";
+  std::cout << "Timer: " << cycleTimerName() << ", overhead "
+            << cal.timer.overhead << " cycles (min " << cal.timer.minimum
+            << ", p99 " << cal.timer.p99 << ", jitter +/-"
+            << std::setprecision(1) << cal.timer.jitter << ")\n"
+            << std::setprecision(2);
 }
 
 // ========== End of Calibration Functions ==========
@@ -253,8 +504,9 @@ struct FFTComplex {
   }
 };
 
-// In-place Cooley-Tukey FFT (size must be power of 2)
-inline void fft(FFTComplex *data, int n, bool inverse = false) {
+// Textbook in-place Cooley-Tukey FFT (size must be power of 2).
+// Kept as the reference implementation that FFTPlan is checked against.
+inline void fftReference(FFTComplex *data, int n, bool inverse = false) {
   // Bit-reversal permutation
   for (int i = 1, j = 0; i < n; i++) {
     int bit = n >> 1;
@@ -289,30 +541,262 @@ inline void fft(FFTComplex *data, int n, bool inverse = false) {
   }
 }
 
+// Largest transform FFTPlan accepts (2^24 points)
+constexpr int FFT_MAX_SIZE = 1 << 24;
+
+// Precomputed FFT for one power-of-two size.
+// The bit-reversal swaps and all twiddles are built once in the constructor;
+// every twiddle is evaluated directly with cos/sin, so there is no drift from
+// repeated multiplication. Transforms run as radix-4 passes (plus one radix-2
+// pass when log2(n) is odd) on a split real/imag layout, using the radix-4
+// kernel of the active SimdLevel. Same sign convention as fftReference():
+// forward uses exp(+i*theta), inverse uses exp(-i*theta) and scales by 1/n.
+constexpr int fftLog2(int n) { return n <= 1 ? 0 : 1 + fftLog2(n / 2); }
+
+class FFTPlan {
+  int n_;
+  int log2n_;
+  std::vector<std::pair<uint32_t, uint32_t>> swaps_; // Bit-reversal pairs
+  std::vector<double> twiddles_; // Per pass: see SimdKernels.hpp for layout
+  std::vector<double> signalRe_; // sin() test input used by the loads
+  std::vector<double> signalIm_;
+
+  void run(double *re, double *im, bool inverse, FFTRadix4PassFn pass) const {
+    for (const auto &s : swaps_) {
+      std::swap(re[s.first], re[s.second]);
+      std::swap(im[s.first], im[s.second]);
+    }
+
+    int m = 1;
+    if (log2n_ & 1) {
+      for (int i = 0; i < n_; i += 2) {
+        double r0 = re[i], i0 = im[i];
+        re[i] = r0 + re[i + 1];
+        im[i] = i0 + im[i + 1];
+        re[i + 1] = r0 - re[i + 1];
+        im[i + 1] = i0 - im[i + 1];
+      }
+      m = 2;
+    }
+    const double *tw = twiddles_.data();
+    for (; m < n_; m *= 4) {
+      pass(re, im, n_, m, tw, inverse);
+      tw += 6 * m;
+    }
+
+    if (inverse) {
+      const double scale = 1.0 / n_;
+      for (int i = 0; i < n_; i++) {
+        re[i] *= scale;
+        im[i] *= scale;
+      }
+    }
+  }
+
+public:
+  explicit FFTPlan(int n) : n_(n), log2n_(0) {
+    if (n < 2 || n > FFT_MAX_SIZE || (n & (n - 1)) != 0) {
+      throw std::invalid_argument("FFTPlan: size must be a power of two in "
+                                  "[2, 2^24]");
+    }
+    while ((1 << log2n_) < n)
+      log2n_++;
+
+    for (int i = 0; i < n; i++) {
+      uint32_t r = 0;
+      for (int b = 0; b < log2n_; b++)
+        r |= ((i >> b) & 1u) << (log2n_ - 1 - b);
+      if (static_cast<uint32_t>(i) < r)
+        swaps_.emplace_back(i, r);
+    }
+
+    for (int m = (log2n_ & 1) ? 2 : 1; m < n; m *= 4) {
+      size_t offset = twiddles_.size();
+      twiddles_.resize(offset + 6 * m);
+      for (int k = 1; k <= 3; k++) {
+        double *wr = &twiddles_[offset + (2 * k - 2) * m];
+        double *wi = wr + m;
+        for (int j = 0; j < m; j++) {
+          double angle = 2 * M_PI * j * k / (4.0 * m);
+          wr[j] = cos(angle);
+          wi[j] = sin(angle);
+        }
+      }
+    }
+
+    signalRe_.resize(n);
+    signalIm_.assign(n, 0.0);
+    for (int i = 0; i < n; i++)
+      signalRe_[i] = sin(2 * M_PI * i / n);
+  }
+
+  int size() const { return n_; }
+
+  // In-place transform on split real/imag arrays of n values
+  void execute(double *re, double *im, bool inverse = false) const {
+    run(re, im, inverse, fftRadix4PassFor(activeSimdLevel()));
+  }
+
+  // Same with the size fixed at compile time (N must equal size()): the
+  // radix-2, pass and scale loops get constant trip counts
+  template <int N>
+  void executeFixed(double *re, double *im, bool inverse,
+                    FFTRadix4PassFn pass) const {
+    for (const auto &s : swaps_) {
+      std::swap(re[s.first], re[s.second]);
+      std::swap(im[s.first], im[s.second]);
+    }
+
+    constexpr bool oddLog2 = (fftLog2(N) & 1) != 0;
+    int m = 1;
+    if (oddLog2) {
+      for (int i = 0; i < N; i += 2) {
+        double r0 = re[i], i0 = im[i];
+        re[i] = r0 + re[i + 1];
+        im[i] = i0 + im[i + 1];
+        re[i + 1] = r0 - re[i + 1];
+        im[i + 1] = i0 - im[i + 1];
+      }
+      m = 2;
+    }
+    const double *tw = twiddles_.data();
+    for (; m < N; m *= 4) {
+      pass(re, im, N, m, tw, inverse);
+      tw += 6 * m;
+    }
+
+    if (inverse) {
+      constexpr double scale = 1.0 / N;
+      for (int i = 0; i < N; i++) {
+        re[i] *= scale;
+        im[i] *= scale;
+      }
+    }
+  }
+
+  // Same, with an explicit kernel level (used by verifyFFTKernels)
+  void executeWith(SimdLevel level, double *re, double *im,
+                   bool inverse = false) const {
+    run(re, im, inverse, fftRadix4PassFor(level));
+  }
+
+  // In-place transform of n interleaved complex values
+  void execute(FFTComplex *data, bool inverse = false) const {
+    thread_local std::vector<double> re, im;
+    if (re.size() < static_cast<size_t>(n_)) {
+      re.resize(n_);
+      im.resize(n_);
+    }
+    for (int i = 0; i < n_; i++) {
+      re[i] = data[i].re;
+      im[i] = data[i].im;
+    }
+    execute(re.data(), im.data(), inverse);
+    for (int i = 0; i < n_; i++)
+      data[i] = FFTComplex(re[i], im[i]);
+  }
+
+  // sin(2*pi*i/n) reference input, precomputed once per size
+  const double *testSignalRe() const { return signalRe_.data(); }
+  const double *testSignalIm() const { return signalIm_.data(); }
+};
+
+// Per-thread plan cache, indexed by log2(size). Plans are built on first use.
+inline const FFTPlan &getFFTPlan(int n) {
+  thread_local std::unique_ptr<FFTPlan> plans[25];
+  int log2n = 0;
+  while ((1 << log2n) < n && log2n < 24)
+    log2n++;
+  if ((1 << log2n) != n)
+    throw std::invalid_argument("getFFTPlan: size must be a power of two");
+  if (!plans[log2n])
+    plans[log2n].reset(new FFTPlan(n));
+  return *plans[log2n];
+}
+
+// In-place FFT (size must be power of 2), using the cached plan for n
+inline void fft(FFTComplex *data, int n, bool inverse = false) {
+  getFFTPlan(n).execute(data, inverse);
+}
+
+// Check every SIMD level this host supports against the scalar kernel, and
+// the scalar kernel against fftReference(), on random input of sizes 2..4096.
+// Returns false (and the worst error) if any result is off by more than 1e-9.
+inline bool verifyFFTKernels(double &maxError) {
+  std::mt19937 gen(12345);
+  std::uniform_real_distribution<double> dist(-1.0, 1.0);
+  maxError = 0.0;
+
+  for (int n = 2; n <= 4096; n *= 2) {
+    const FFTPlan &plan = getFFTPlan(n);
+    std::vector<FFTComplex> input(n);
+    for (auto &c : input)
+      c = FFTComplex(dist(gen), dist(gen));
+
+    for (bool inverse : {false, true}) {
+      std::vector<FFTComplex> ref(input);
+      fftReference(ref.data(), n, inverse);
+
+      std::vector<double> sRe(n), sIm(n);
+      for (int i = 0; i < n; i++) {
+        sRe[i] = input[i].re;
+        sIm[i] = input[i].im;
+      }
+      plan.executeWith(SimdLevel::Scalar, sRe.data(), sIm.data(), inverse);
+      for (int i = 0; i < n; i++) {
+        maxError = std::max(maxError, std::fabs(sRe[i] - ref[i].re));
+        maxError = std::max(maxError, std::fabs(sIm[i] - ref[i].im));
+      }
+
+      for (SimdLevel level :
+           {SimdLevel::NEON, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (!simdLevelSupported(level))
+          continue;
+        std::vector<double> vRe(n), vIm(n);
+        for (int i = 0; i < n; i++) {
+          vRe[i] = input[i].re;
+          vIm[i] = input[i].im;
+        }
+        plan.executeWith(level, vRe.data(), vIm.data(), inverse);
+        for (int i = 0; i < n; i++) {
+          maxError = std::max(maxError, std::fabs(vRe[i] - sRe[i]));
+          maxError = std::max(maxError, std::fabs(vIm[i] - sIm[i]));
+        }
+      }
+    }
+  }
+  return maxError < 1e-9;
+}
+
 // FFT size options for different load levels
 // Larger size = more computation time
 constexpr int FFT_SIZE_64 = 64;   // For 60% load
 constexpr int FFT_SIZE_128 = 128; // For 75%/90% load
 
 // Perform FFT with specified size and repeat count
+// The input is copied from the plan's cached test signal and the split work
+// buffers are reused per thread, so no sin() calls or allocation happen here.
 inline void performFFTWithSize(int fft_size, int repeats) {
-  FFTComplex data[256]; // Max size buffer
-
-  // Initialize with test data
-  for (int i = 0; i < fft_size; i++) {
-    data[i] = FFTComplex(sin(2 * M_PI * i / fft_size), 0);
+  const FFTPlan &plan = getFFTPlan(fft_size);
+  thread_local std::vector<double> re, im;
+  if (re.size() < static_cast<size_t>(fft_size)) {
+    re.resize(fft_size);
+    im.resize(fft_size);
   }
 
+  std::copy(plan.testSignalRe(), plan.testSignalRe() + fft_size, re.begin());
+  std::copy(plan.testSignalIm(), plan.testSignalIm() + fft_size, im.begin());
+
   // Perform FFT multiple times
   for (int r = 0; r < repeats; r++) {
-    fft(data, fft_size, false); // Forward FFT
-    fft(data, fft_size, true);  // Inverse FFT
+    plan.execute(re.data(), im.data(), false); // Forward FFT
+    plan.execute(re.data(), im.data(), true);  // Inverse FFT
   }
 }
 
 // FFT Load patterns: 75%, 80%, 85%, 90% of 3.6us base period
 // 75% = 2.70us, 80% = 2.88us, 85% = 3.06us, 90% = 3.24us
-// Calibrated for ~5.25 GHz CPU
+// Calibrated for ~5.25 GHz CPU (LoadTuner.hpp re-tunes them per host)
 enum class FFTLoadLevel {
   LOAD_75_PERCENT, // 2.70 us (75% of 3.6us)
   LOAD_80_PERCENT, // 2.88 us (80% of 3.6us)
@@ -342,37 +826,520 @@ inline void performFFTLoadLegacy() {
   performFFTLoad(FFTLoadLevel::LOAD_75_PERCENT);
 }
 
-// Quantum Load
-inline void performQuantumLoad() {
+// A named FFT load: `repeats` forward + inverse passes of an `fftSize`-point
+// transform. The built-in levels above are LoadSpecs {"75%", 64, 4, 75} ..
+// {"90%", 128, 4, 90}; PatternConfig.hpp lets a config define others.
+struct LoadSpec {
+  std::string name;
+  int fftSize = FFT_SIZE_64;
+  int repeats = 4;
+  double targetPercent = 0.0; // Intended share of the center period
+};
+
+inline void performLoad(const LoadSpec &load) {
+  performFFTWithSize(load.fftSize, load.repeats);
+}
+
+// ========== Gate Circuit IR ==========
+
+enum class GateKind : uint8_t { H, X, Z, S, T, RY, CNOT, NOP };
+
+// One circuit instruction. RY angles are fixed when the circuit is built.
+struct GateOp {
+  GateKind kind;
+  int target;
+  int control;  // CNOT only, -1 otherwise
+  double angle; // RY only
+};
+
+// 2x2 unitary, layout {m00r, m00i, m01r, m01i, m10r, m10i, m11r, m11i}
+struct Gate2x2 {
+  double m[8];
+
+  static Gate2x2 identity() { return {{1, 0, 0, 0, 0, 0, 1, 0}}; }
+
+  // Matrix of a single-qubit gate (same conventions as Qubit)
+  static Gate2x2 of(const GateOp &op) {
+    const double h = 0.70710678118654752;
+    switch (op.kind) {
+    case GateKind::H:
+      return {{h, 0, h, 0, h, 0, -h, 0}};
+    case GateKind::X:
+      return {{0, 0, 1, 0, 1, 0, 0, 0}};
+    case GateKind::Z:
+      return {{1, 0, 0, 0, 0, 0, -1, 0}};
+    case GateKind::S:
+      return {{1, 0, 0, 0, 0, 0, 0, 1}};
+    case GateKind::T:
+      return {{1, 0, 0, 0, 0, 0, h, h}};
+    case GateKind::RY: {
+      double c = cos(op.angle / 2), s = sin(op.angle / 2);
+      return {{c, 0, -s, 0, s, 0, c, 0}};
+    }
+    default:
+      return identity();
+    }
+  }
+
+  // Product this * first, i.e. `first` applied before this
+  Gate2x2 after(const Gate2x2 &first) const {
+    Gate2x2 r;
+    for (int row = 0; row < 2; row++) {
+      for (int col = 0; col < 2; col++) {
+        double re = 0, im = 0;
+        for (int k = 0; k < 2; k++) {
+          double ar = m[(row * 2 + k) * 2], ai = m[(row * 2 + k) * 2 + 1];
+          double br = first.m[(k * 2 + col) * 2];
+          double bi = first.m[(k * 2 + col) * 2 + 1];
+          re += ar * br - ai * bi;
+          im += ar * bi + ai * br;
+        }
+        r.m[(row * 2 + col) * 2] = re;
+        r.m[(row * 2 + col) * 2 + 1] = im;
+      }
+    }
+    return r;
+  }
+};
+
+// Gate list over numQubits qubits, built with chained calls:
+//   QuantumCircuit c(2); c.h(0).cnot(0, 1).ry(1, M_PI / 4);
+class QuantumCircuit {
+  int numQubits_;
+  std::vector<GateOp> ops_;
+
+  QuantumCircuit &add(GateKind kind, int target, int control = -1,
+                      double angle = 0.0) {
+    if (kind != GateKind::NOP && (target < 0 || target >= numQubits_))
+      throw std::out_of_range("QuantumCircuit: qubit index out of range");
+    if (kind == GateKind::CNOT &&
+        (control < 0 || control >= numQubits_ || control == target))
+      throw std::out_of_range("QuantumCircuit: bad CNOT control");
+    ops_.push_back({kind, target, control, angle});
+    return *this;
+  }
+
+public:
+  explicit QuantumCircuit(int numQubits = 1) : numQubits_(numQubits) {}
+
+  QuantumCircuit &h(int q) { return add(GateKind::H, q); }
+  QuantumCircuit &x(int q) { return add(GateKind::X, q); }
+  QuantumCircuit &z(int q) { return add(GateKind::Z, q); }
+  QuantumCircuit &s(int q) { return add(GateKind::S, q); }
+  QuantumCircuit &t(int q) { return add(GateKind::T, q); }
+  QuantumCircuit &ry(int q, double theta) {
+    return add(GateKind::RY, q, -1, theta);
+  }
+  QuantumCircuit &cnot(int control, int target) {
+    return add(GateKind::CNOT, target, control);
+  }
+  // Timing padding: one nop() in the interpreter, dropped when fused
+  QuantumCircuit &pad() { return add(GateKind::NOP, 0); }
+
+  int numQubits() const { return numQubits_; }
+  const std::vector<GateOp> &ops() const { return ops_; }
+
+  size_t gateCount() const {
+    return std::count_if(ops_.begin(), ops_.end(), [](const GateOp &op) {
+      return op.kind != GateKind::NOP;
+    });
+  }
+};
+
+// Fused instruction: a precomputed unitary on one qubit, or a CNOT
+struct FusedOp {
+  bool isCNOT;
+  int target;
+  int control;
+  Gate2x2 u;
+};
+
+// Compiled form of a QuantumCircuit. Every run of single-qubit gates on a
+// qubit is multiplied into one Gate2x2 (RY cos/sin evaluated here, once);
+// pending products are flushed only where a CNOT touches the qubit.
+class CompiledCircuit {
+  int numQubits_;
+  size_t sourceGates_;
+  std::vector<FusedOp> ops_;
+
+public:
+  explicit CompiledCircuit(const QuantumCircuit &circuit)
+      : numQubits_(circuit.numQubits()), sourceGates_(circuit.gateCount()) {
+    std::vector<Gate2x2> pending(numQubits_, Gate2x2::identity());
+    std::vector<bool> dirty(numQubits_, false);
+
+    auto flush = [&](int q) {
+      if (dirty[q]) {
+        ops_.push_back({false, q, -1, pending[q]});
+        pending[q] = Gate2x2::identity();
+        dirty[q] = false;
+      }
+    };
+
+    for (const GateOp &op : circuit.ops()) {
+      if (op.kind == GateKind::NOP)
+        continue;
+      if (op.kind == GateKind::CNOT) {
+        flush(op.control);
+        flush(op.target);
+        ops_.push_back({true, op.target, op.control, Gate2x2::identity()});
+      } else {
+        pending[op.target] = Gate2x2::of(op).after(pending[op.target]);
+        dirty[op.target] = true;
+      }
+    }
+    for (int q = 0; q < numQubits_; q++)
+      flush(q);
+  }
+
+  int numQubits() const { return numQubits_; }
+  size_t sourceGateCount() const { return sourceGates_; }
+  const std::vector<FusedOp> &ops() const { return ops_; }
+};
+
+// Interpreter: one gate call per instruction
+inline void runCircuit(const QuantumCircuit &circuit, Qubit &q) {
+  for (const GateOp &op : circuit.ops()) {
+    switch (op.kind) {
+    case GateKind::H:
+      q.applyHadamard();
+      break;
+    case GateKind::X:
+      q.applyX();
+      break;
+    case GateKind::Z:
+      q.applyZ();
+      break;
+    case GateKind::S:
+      q.applyS();
+      break;
+    case GateKind::T:
+      q.applyT();
+      break;
+    case GateKind::RY:
+      q.applyRY(op.angle);
+      break;
+    case GateKind::NOP:
+      nop();
+      break;
+    case GateKind::CNOT:
+      break; // Not representable on a single qubit
+    }
+  }
+}
+
+inline void runCircuit(const QuantumCircuit &circuit, QubitRegister &reg) {
+  for (const GateOp &op : circuit.ops()) {
+    switch (op.kind) {
+    case GateKind::H:
+      reg.applyHadamard(op.target);
+      break;
+    case GateKind::X:
+      reg.applyX(op.target);
+      break;
+    case GateKind::Z:
+      reg.applyZ(op.target);
+      break;
+    case GateKind::S:
+      reg.applyS(op.target);
+      break;
+    case GateKind::T:
+      reg.applyT(op.target);
+      break;
+    case GateKind::RY:
+      reg.applyRY(op.target, op.angle);
+      break;
+    case GateKind::CNOT:
+      reg.applyCNOT(op.control, op.target);
+      break;
+    case GateKind::NOP:
+      nop();
+      break;
+    }
+  }
+}
+
+// Fused execution: one 2x2 update per fused run
+inline void runCircuit(const CompiledCircuit &circuit, Qubit &q) {
+  for (const FusedOp &op : circuit.ops()) {
+    if (!op.isCNOT)
+      q.applyMatrix(op.u.m);
+  }
+}
+
+inline void runCircuit(const CompiledCircuit &circuit, QubitRegister &reg) {
+  for (const FusedOp &op : circuit.ops()) {
+    if (op.isCNOT)
+      reg.applyCNOT(op.control, op.target);
+    else
+      reg.applyMatrix(op.target, op.u.m);
+  }
+}
+
+// ========== End of Gate Circuit IR ==========
+
+// How a quantum load executes its circuit
+enum class CircuitMode { Interpreted, Fused };
+
+// Quantum Load circuit (Combined: H+G+QFT), built once
+inline const QuantumCircuit &quantumLoadCircuit() {
+  static const QuantumCircuit circuit = [] {
+    QuantumCircuit c(1);
+    c.h(0);
+    for (int i = 0; i < 150; i++)
+      c.x(0).h(0).pad();
+    for (int i = 0; i < 75; i++)
+      c.z(0).h(0).x(0).z(0).x(0).h(0).pad();
+    for (int i = 0; i < 150; i++)
+      c.ry(0, M_PI / (1 << (i % 8 + 1))).s(0).t(0).pad();
+    return c;
+  }();
+  return circuit;
+}
+
+// Quantum Load; returns the measured bit so callers can keep it alive
+inline int performQuantumLoad(CircuitMode mode = CircuitMode::Interpreted) {
+  static const CompiledCircuit fused(quantumLoadCircuit());
   Qubit q;
+  if (mode == CircuitMode::Fused)
+    runCircuit(fused, q);
+  else
+    runCircuit(quantumLoadCircuit(), q);
+  return q.measure();
+}
 
-  // Combined: H+G+QFT
-  q.applyHadamard();
-  for (int i = 0; i < 150; i++) {
-    q.applyX();
-    q.applyHadamard();
-    nop();
+// Register load circuit: `layers` rounds of H on every qubit, a CNOT ladder,
+// RY/S/T on every qubit and Z·X on alternating qubits.
+// Cost grows as layers * N * 2^N; the state takes 16 * 2^N bytes.
+inline QuantumCircuit buildRegisterLoadCircuit(int numQubits, int layers) {
+  QuantumCircuit c(numQubits);
+  for (int l = 0; l < layers; l++) {
+    for (int q = 0; q < numQubits; q++)
+      c.h(q);
+    for (int q = 0; q + 1 < numQubits; q++)
+      c.cnot(q, q + 1);
+    for (int q = 0; q < numQubits; q++)
+      c.ry(q, M_PI / (1 << (q % 8 + 1))).s(q).t(q);
+    for (int q = l & 1; q < numQubits; q += 2)
+      c.z(q).x(q);
   }
+  return c;
+}
+
+// Per-thread state of the register load
+struct RegisterLoadState {
+  std::unique_ptr<QubitRegister> reg;
+  std::unique_ptr<QuantumCircuit> circuit;
+  std::unique_ptr<CompiledCircuit> fused;
+  int layers = 0;
+  std::mt19937_64 gen{std::random_device{}()};
+  std::vector<uint64_t> shot;
+};
 
-  for (int i = 0; i < 75; i++) {
-    q.applyZ();
-    q.applyHadamard();
-    q.applyX();
-    q.applyZ();
-    q.applyX();
-    q.applyHadamard();
-    nop();
+// Builds (or rebuilds for a new shape) the calling thread's register, its
+// sampling scratch, the circuits and the RNG. Called before measuring, so
+// the first loaded window does not allocate a state of up to 4 GiB.
+inline RegisterLoadState &prepareQuantumRegisterLoad(int numQubits,
+                                                     int layers) {
+  thread_local RegisterLoadState state;
+  if (!state.reg || state.reg->size() != numQubits) {
+    state.reg.reset(); // Free the old state before allocating the new one
+    state.reg.reset(new QubitRegister(numQubits));
+    state.reg->reserveSampling();
+  }
+  if (!state.circuit || state.circuit->numQubits() != numQubits ||
+      state.layers != layers) {
+    state.circuit.reset(
+        new QuantumCircuit(buildRegisterLoadCircuit(numQubits, layers)));
+    state.fused.reset(new CompiledCircuit(*state.circuit));
+    state.layers = layers;
   }
+  state.shot.resize(1);
+  return state;
+}
+
+// Register quantum load: the circuit above on a per-thread QubitRegister,
+// followed by one measurement sample, which is returned
+inline uint64_t performQuantumRegisterLoad(int numQubits, int layers = 1,
+                                       CircuitMode mode =
+                                           CircuitMode::Interpreted) {
+  RegisterLoadState &state = prepareQuantumRegisterLoad(numQubits, layers);
+  state.reg->reset();
+
+  if (mode == CircuitMode::Fused)
+    runCircuit(*state.fused, *state.reg);
+  else
+    runCircuit(*state.circuit, *state.reg);
+
+  state.reg->sample(1, state.gen, state.shot);
+  return state.shot[0];
+}
+
+// Which quantum load measureSingle runs: the fixed single-qubit circuit
+// (qubits == 0) or performQuantumRegisterLoad(qubits, layers)
+struct QuantumLoadSpec {
+  int qubits = 0;
+  int layers = 1;
+  CircuitMode mode = CircuitMode::Interpreted;
+};
 
-  for (int i = 0; i < 150; i++) {
-    double angle = M_PI / (1 << (i % 8 + 1));
-    q.applyRY(angle);
-    q.applyS();
-    q.applyT();
-    nop();
+inline void performQuantumLoad(const QuantumLoadSpec &spec) {
+  if (spec.qubits > 0)
+    performQuantumRegisterLoad(spec.qubits, spec.layers, spec.mode);
+  else
+    performQuantumLoad(spec.mode);
+}
+
+// Sets up the quantum load's per-thread state on the calling thread; every
+// measuring thread calls this before its first sample
+inline void prepareQuantumLoad(const QuantumLoadSpec &spec) {
+  if (spec.qubits > 0)
+    prepareQuantumRegisterLoad(spec.qubits, spec.layers);
+  else
+    performQuantumLoad(spec.mode); // Builds the circuits and the Qubit RNG
+}
+
+// ========== Specialized Load Kernels ==========
+// The loaded phase of a sample (FFT load + quantum load) instantiated per
+// FFT size, repeat count and quantum-load variant, so the transform size,
+// the repeat loop and the quantum circuit are compile-time constants. The
+// plan, the SIMD pass and the circuits are resolved once per pattern into
+// LoadKernelArgs, and the kernel is picked once per pattern from a
+// function-pointer table. Shapes outside the table use a generic kernel.
+
+enum class QuantumVariant : uint8_t { Interpreted, Fused, Register };
+constexpr int QUANTUM_VARIANT_COUNT = 3;
+
+inline QuantumVariant quantumVariantOf(const QuantumLoadSpec &spec) {
+  if (spec.qubits > 0)
+    return QuantumVariant::Register;
+  return spec.mode == CircuitMode::Fused ? QuantumVariant::Fused
+                                         : QuantumVariant::Interpreted;
+}
+
+// FFT sizes x repeat counts (1..LOAD_KERNEL_MAX_REPEATS) with a kernel
+constexpr int LOAD_KERNEL_SIZES[] = {16, 32, 64, 128, 256, 512};
+constexpr int LOAD_KERNEL_SIZE_COUNT =
+    sizeof(LOAD_KERNEL_SIZES) / sizeof(LOAD_KERNEL_SIZES[0]);
+constexpr int LOAD_KERNEL_MAX_REPEATS = 16;
+// Bump when the load kernels' cost changes: load choices tuned and cached
+// for older kernels (LoadTuner.hpp) are then discarded
+constexpr int LOAD_KERNEL_VERSION = 2; // 1 = generic, 2 = specialized
+constexpr int LOAD_KERNEL_COUNT =
+    LOAD_KERNEL_SIZE_COUNT * LOAD_KERNEL_MAX_REPEATS * QUANTUM_VARIANT_COUNT;
+
+// Everything a load kernel needs, resolved on the measuring thread
+struct LoadKernelArgs {
+  const FFTPlan *plan = nullptr;
+  FFTRadix4PassFn pass = nullptr;
+  const QuantumCircuit *circuit = nullptr; // Single-qubit load, interpreted
+  const CompiledCircuit *fused = nullptr;  // Single-qubit load, fused
+  LoadSpec load;                           // For the generic kernel
+  QuantumLoadSpec quantum;
+};
+
+inline LoadKernelArgs makeLoadKernelArgs(const LoadSpec &load,
+                                         const QuantumLoadSpec &quantum) {
+  static const CompiledCircuit fused(quantumLoadCircuit());
+  LoadKernelArgs args;
+  args.plan = &getFFTPlan(load.fftSize);
+  args.pass = fftRadix4PassFor(activeSimdLevel());
+  args.circuit = &quantumLoadCircuit();
+  args.fused = &fused;
+  args.load = load;
+  args.quantum = quantum;
+  return args;
+}
+
+// Written once per kernel call so the transforms cannot be optimised away
+inline volatile double &loadKernelSink() {
+  thread_local volatile double sink = 0.0;
+  return sink;
+}
+
+template <QuantumVariant Q>
+inline void runQuantumVariant(const LoadKernelArgs &a) {
+  if constexpr (Q == QuantumVariant::Register) {
+    performQuantumRegisterLoad(a.quantum.qubits, a.quantum.layers,
+                               a.quantum.mode);
+  } else {
+    Qubit q;
+    if constexpr (Q == QuantumVariant::Fused)
+      runCircuit(*a.fused, q);
+    else
+      runCircuit(*a.circuit, q);
+    q.measure();
   }
+}
 
-  q.measure();
+template <int N, int R, QuantumVariant Q> struct LoadPhaseKernel {
+  static void run(const LoadKernelArgs &a) {
+    alignas(64) double re[N], im[N];
+    std::copy(a.plan->testSignalRe(), a.plan->testSignalRe() + N, re);
+    std::copy(a.plan->testSignalIm(), a.plan->testSignalIm() + N, im);
+    for (int r = 0; r < R; r++) {
+      a.plan->executeFixed<N>(re, im, false, a.pass); // Forward FFT
+      a.plan->executeFixed<N>(re, im, true, a.pass);  // Inverse FFT
+    }
+    loadKernelSink() = re[0] + im[N - 1];
+    runQuantumVariant<Q>(a);
+  }
+};
+
+inline void loadPhaseGeneric(const LoadKernelArgs &a) {
+  performLoad(a.load);
+  performQuantumLoad(a.quantum);
+}
+
+// Table slot of a shape, or -1 if it has no specialized kernel
+inline int loadKernelIndex(int fftSize, int repeats, QuantumVariant q) {
+  if (repeats < 1 || repeats > LOAD_KERNEL_MAX_REPEATS)
+    return -1;
+  for (int s = 0; s < LOAD_KERNEL_SIZE_COUNT; s++) {
+    if (LOAD_KERNEL_SIZES[s] == fftSize)
+      return (s * LOAD_KERNEL_MAX_REPEATS + repeats - 1) *
+                 QUANTUM_VARIANT_COUNT +
+             static_cast<int>(q);
+  }
+  return -1;
+}
+
+// K<N, R, Q>::run for every table slot, in loadKernelIndex() order
+template <template <int, int, QuantumVariant> class K, typename Fn,
+          size_t... I>
+constexpr std::array<Fn, sizeof...(I)>
+makeLoadKernelTable(std::index_sequence<I...>) {
+  return {{K<LOAD_KERNEL_SIZES[I / (LOAD_KERNEL_MAX_REPEATS *
+                                    QUANTUM_VARIANT_COUNT)],
+             static_cast<int>(I / QUANTUM_VARIANT_COUNT %
+                              LOAD_KERNEL_MAX_REPEATS) +
+                 1,
+             static_cast<QuantumVariant>(I % QUANTUM_VARIANT_COUNT)>::run...}};
+}
+
+using LoadKernelFn = void (*)(const LoadKernelArgs &);
+
+// Specialized loaded-phase kernel for a shape, or the generic one
+inline LoadKernelFn findLoadKernel(const LoadSpec &load,
+                                   const QuantumLoadSpec &quantum) {
+  static constexpr std::array<LoadKernelFn, LOAD_KERNEL_COUNT> table =
+      makeLoadKernelTable<LoadPhaseKernel, LoadKernelFn>(
+          std::make_index_sequence<LOAD_KERNEL_COUNT>());
+  int index =
+      loadKernelIndex(load.fftSize, load.repeats, quantumVariantOf(quantum));
+  return index < 0 ? loadPhaseGeneric : table[index];
+}
+
+// The quantum half of the loaded phase on its own (for cost reports)
+inline LoadKernelFn findQuantumKernel(const QuantumLoadSpec &quantum) {
+  switch (quantumVariantOf(quantum)) {
+  case QuantumVariant::Fused:
+    return runQuantumVariant<QuantumVariant::Fused>;
+  case QuantumVariant::Register:
+    return runQuantumVariant<QuantumVariant::Register>;
+  default:
+    return runQuantumVariant<QuantumVariant::Interpreted>;
+  }
 }
 
 #endif // QUANTUM_LIB_HPP
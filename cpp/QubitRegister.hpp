@@ -0,0 +1,245 @@
+#ifndef QUBIT_REGISTER_HPP
+#define QUBIT_REGISTER_HPP
+
+#ifndef _USE_MATH_DEFINES
+#define _USE_MATH_DEFINES
+#endif
+#include <cmath>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "SimdKernels.hpp"
+
+// ========== Multi-Qubit State-Vector Register ==========
+
+// Largest register QubitRegister accepts: 2^28 amplitudes, a 4 GiB state
+// plus 2 GiB of sampling scratch
+constexpr int QUBIT_REGISTER_MAX = 28;
+
+// Bytes a register of `numQubits` takes with its sampling scratch
+inline uint64_t qubitRegisterBytes(int numQubits) {
+  return uint64_t(24) << numQubits;
+}
+
+// N-qubit state vector in split real/imag layout.
+// Gates run through the SIMD kernels of the active SimdLevel; the state size
+// (16 * 2^N bytes) and the per-gate cost both scale with N, so the register
+// can be sized to stress a chosen cache level or fill a time window.
+class QubitRegister {
+  int numQubits_;
+  size_t dim_;
+  std::vector<double> re_;
+  std::vector<double> im_;
+  std::vector<double> cumulative_; // Scratch for sample()
+
+  void checkQubit(int q) const {
+    if (q < 0 || q >= numQubits_)
+      throw std::out_of_range("QubitRegister: qubit index out of range");
+  }
+
+  void matrix(int target, size_t controlMask, const double *m) {
+    gateKernelsFor(activeSimdLevel())
+        .matrix(re_.data(), im_.data(), dim_, target, controlMask, m);
+  }
+
+  void phase(int target, size_t controlMask, double pr, double pi) {
+    gateKernelsFor(activeSimdLevel())
+        .phase(re_.data(), im_.data(), dim_, target, controlMask, pr, pi);
+  }
+
+  void swap(int target, size_t controlMask) {
+    gateKernelsFor(activeSimdLevel())
+        .swap(re_.data(), im_.data(), dim_, target, controlMask);
+  }
+
+public:
+  explicit QubitRegister(int numQubits)
+      : numQubits_(numQubits), dim_(size_t(1) << numQubits) {
+    if (numQubits < 1 || numQubits > QUBIT_REGISTER_MAX) {
+      throw std::invalid_argument(
+          "QubitRegister: qubit count must be in [1, " +
+          std::to_string(QUBIT_REGISTER_MAX) + "]");
+    }
+    re_.assign(dim_, 0.0);
+    im_.assign(dim_, 0.0);
+    re_[0] = 1.0;
+  }
+
+  int size() const { return numQubits_; }
+  size_t dimension() const { return dim_; }
+  size_t memoryBytes() const { return 2 * dim_ * sizeof(double); }
+
+  // Back to |00...0>
+  void reset() {
+    std::fill(re_.begin(), re_.end(), 0.0);
+    std::fill(im_.begin(), im_.end(), 0.0);
+    re_[0] = 1.0;
+  }
+
+  void applyHadamard(int q) {
+    checkQubit(q);
+    const double h = 0.70710678118654752;
+    const double m[8] = {h, 0, h, 0, h, 0, -h, 0};
+    matrix(q, 0, m);
+  }
+
+  void applyX(int q) {
+    checkQubit(q);
+    swap(q, 0);
+  }
+
+  void applyZ(int q) {
+    checkQubit(q);
+    phase(q, 0, -1.0, 0.0);
+  }
+
+  void applyS(int q) {
+    checkQubit(q);
+    phase(q, 0, 0.0, 1.0);
+  }
+
+  void applyT(int q) {
+    checkQubit(q);
+    const double c = 0.70710678118654752;
+    phase(q, 0, c, c);
+  }
+
+  void applyRY(int q, double theta) {
+    checkQubit(q);
+    double c = cos(theta / 2);
+    double s = sin(theta / 2);
+    const double m[8] = {c, 0, -s, 0, s, 0, c, 0};
+    matrix(q, 0, m);
+  }
+
+  // Arbitrary 2x2 unitary {m00r, m00i, m01r, m01i, m10r, m10i, m11r, m11i}
+  void applyMatrix(int q, const double *m) {
+    checkQubit(q);
+    matrix(q, 0, m);
+  }
+
+  void applyCNOT(int control, int target) {
+    checkQubit(control);
+    checkQubit(target);
+    if (control == target)
+      throw std::invalid_argument("QubitRegister: control == target");
+    swap(target, size_t(1) << control);
+  }
+
+  // Controlled version of an arbitrary 2x2 unitary
+  void applyControlledMatrix(int control, int target, const double *m) {
+    checkQubit(control);
+    checkQubit(target);
+    if (control == target)
+      throw std::invalid_argument("QubitRegister: control == target");
+    matrix(target, size_t(1) << control, m);
+  }
+
+  // Probability of reading 1 on qubit q
+  double probabilityOne(int q) const {
+    checkQubit(q);
+    const size_t bit = size_t(1) << q;
+    double p = 0.0;
+    for (size_t i = 0; i < dim_; i++) {
+      if (i & bit)
+        p += re_[i] * re_[i] + im_[i] * im_[i];
+    }
+    return p;
+  }
+
+  // Allocate and touch sample()'s scratch ahead of the first call
+  void reserveSampling() { cumulative_.assign(dim_, 0.0); }
+
+  // Draw `shots` basis states from |amplitude|^2 without collapsing the state.
+  // One O(2^N) prefix-sum pass, then a binary search per shot.
+  void sample(int shots, std::mt19937_64 &gen, std::vector<uint64_t> &out) {
+    cumulative_.resize(dim_);
+    double total = 0.0;
+    for (size_t i = 0; i < dim_; i++) {
+      total += re_[i] * re_[i] + im_[i] * im_[i];
+      cumulative_[i] = total;
+    }
+    std::uniform_real_distribution<double> dist(0.0, total);
+    out.resize(shots);
+    for (int s = 0; s < shots; s++) {
+      double r = dist(gen);
+      size_t k = std::upper_bound(cumulative_.begin(), cumulative_.end(), r) -
+                 cumulative_.begin();
+      out[s] = std::min(k, dim_ - 1);
+    }
+  }
+
+  // For testing purposes
+  double amplitudeRe(size_t i) const { return re_[i]; }
+  double amplitudeIm(size_t i) const { return im_[i]; }
+};
+
+// Run one random circuit with every supported SimdLevel and compare the
+// final state against the scalar kernels. Returns false on a mismatch.
+inline bool verifyGateKernels(double &maxError) {
+  const int numQubits = 10;
+  maxError = 0.0;
+  std::vector<double> refRe, refIm;
+
+  for (SimdLevel level : {SimdLevel::Scalar, SimdLevel::NEON, SimdLevel::AVX2,
+                          SimdLevel::AVX512}) {
+    if (!simdLevelSupported(level))
+      continue;
+    SimdLevel previous = activeSimdLevel();
+    setSimdLevel(level);
+
+    QubitRegister reg(numQubits);
+    std::mt19937 gen(2024);
+    for (int k = 0; k < 500; k++) {
+      int q = gen() % numQubits;
+      int c = gen() % numQubits;
+      switch (gen() % 7) {
+      case 0:
+        reg.applyHadamard(q);
+        break;
+      case 1:
+        reg.applyX(q);
+        break;
+      case 2:
+        reg.applyZ(q);
+        break;
+      case 3:
+        reg.applyS(q);
+        break;
+      case 4:
+        reg.applyT(q);
+        break;
+      case 5:
+        reg.applyRY(q, 0.1 * (k % 31));
+        break;
+      default:
+        if (c != q)
+          reg.applyCNOT(c, q);
+        break;
+      }
+    }
+    setSimdLevel(previous);
+
+    if (level == SimdLevel::Scalar) {
+      for (size_t i = 0; i < reg.dimension(); i++) {
+        refRe.push_back(reg.amplitudeRe(i));
+        refIm.push_back(reg.amplitudeIm(i));
+      }
+    } else {
+      for (size_t i = 0; i < reg.dimension(); i++) {
+        maxError = std::max(maxError, std::fabs(reg.amplitudeRe(i) - refRe[i]));
+        maxError = std::max(maxError, std::fabs(reg.amplitudeIm(i) - refIm[i]));
+      }
+    }
+  }
+  return maxError < 1e-9;
+}
+
+// ========== End of Multi-Qubit State-Vector Register ==========
+
+#endif // QUBIT_REGISTER_HPP
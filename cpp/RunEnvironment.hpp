@@ -0,0 +1,324 @@
+#ifndef RUN_ENVIRONMENT_HPP
+#define RUN_ENVIRONMENT_HPP
+
+// Execution environment for the measuring thread.
+// Applies and then verifies what the benchmark asks of the OS: core
+// affinity, real-time priority, locked memory and a pre-faulted stack. It
+// also reads the host settings that decide how noisy a run will be:
+// isolcpus/nohz_full, the cpufreq governor, turbo and SMT siblings. Every
+// result goes into an EnvironmentReport that is printed with the run, and
+// known-noisy settings become warnings, which --strict-env turns into a
+// refusal to run.
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "QuantumLib.hpp"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+// One core number, which must be pinnable (below MAX_PINNABLE_CORES)
+inline bool parseCore(const std::string &text, int &core,
+                      std::string &error) {
+  const char *begin = text.c_str();
+  char *end = nullptr;
+  errno = 0;
+  long value = std::strtol(begin, &end, 10);
+  if (text.empty() || end == begin || *end != '\0' || errno == ERANGE) {
+    error = "'" + text + "' is not a core number";
+    return false;
+  }
+  if (value < 0 || value >= MAX_PINNABLE_CORES) {
+    error = "core " + text + " is out of range 0-" +
+            std::to_string(MAX_PINNABLE_CORES - 1);
+    return false;
+  }
+  core = static_cast<int>(value);
+  return true;
+}
+
+// Parse a core list such as "2,3,8-11"
+inline bool parseCoreList(const std::string &spec, std::vector<int> &cores,
+                          std::string &error) {
+  cores.clear();
+  std::stringstream ss(spec);
+  std::string item;
+  while (std::getline(ss, item, ',')) {
+    item.erase(0, item.find_first_not_of(" \t\n"));
+    item.erase(item.find_last_not_of(" \t\n") + 1);
+    if (item.empty())
+      continue;
+    size_t dash = item.find('-');
+    int first = 0, last = 0;
+    if (dash == std::string::npos) {
+      if (!parseCore(item, first, error))
+        return false;
+      last = first;
+    } else if (!parseCore(item.substr(0, dash), first, error) ||
+               !parseCore(item.substr(dash + 1), last, error)) {
+      return false;
+    }
+    if (first > last) {
+      error = "core range " + item + " is reversed";
+      return false;
+    }
+    for (int c = first; c <= last; c++)
+      cores.push_back(c);
+  }
+  if (cores.empty()) {
+    error = "no cores in '" + spec + "'";
+    return false;
+  }
+  return true;
+}
+
+// Logical core the calling thread is running on (-1 if unknown)
+inline int currentCore() {
+#ifdef _WIN32
+  return static_cast<int>(GetCurrentProcessorNumber());
+#elif defined(__linux__)
+  return sched_getcpu();
+#else
+  return -1;
+#endif
+}
+
+// Physical memory the OS can still hand out, in bytes (0 if unknown)
+inline uint64_t availableMemoryBytes() {
+#ifdef _WIN32
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+  return GlobalMemoryStatusEx(&status) ? status.ullAvailPhys : 0;
+#elif defined(__linux__)
+  std::ifstream in("/proc/meminfo");
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.compare(0, 13, "MemAvailable:") == 0)
+      return std::strtoull(line.c_str() + 13, nullptr, 10) * 1024;
+  }
+  return 0;
+#else
+  return 0;
+#endif
+}
+
+struct EnvironmentOptions {
+  int measureCore = -1;     // Pin the measuring thread here; -1 = current
+  bool pin = true;          // false: leave affinity alone (parallel mode)
+  bool lockMemory = true;   // mlockall(MCL_CURRENT | MCL_FUTURE)
+  size_t stackPrefaultBytes = 256 * 1024;
+};
+
+struct EnvironmentReport {
+  int core = -1;
+  bool pinned = false;
+  bool realtime = false;
+  std::string priority;     // Scheduling policy/priority actually in effect
+  bool memoryLocked = false;
+  std::string memoryNote;
+  size_t stackPrefaulted = 0;
+
+  std::string isolatedCpus; // "" if none or unknown
+  std::string nohzFullCpus;
+  bool coreIsolated = false;
+  std::string governor;     // "" if unknown
+  int turbo = -1;           // 1 on, 0 off, -1 unknown
+  int smtActive = -1;       // 1 on, 0 off, -1 unknown
+  std::string smtSiblings;  // Logical cores sharing the measuring core
+
+  std::vector<std::string> warnings; // Known-noisy settings
+};
+
+inline std::string readSysfsLine(const std::string &path) {
+  std::ifstream in(path);
+  std::string line;
+  if (in)
+    std::getline(in, line);
+  line.erase(line.find_last_not_of(" \t\r\n") + 1);
+  return line;
+}
+
+// Value of `key=` on the kernel command line, "" if absent
+inline std::string kernelCmdlineValue(const std::string &key) {
+  std::string cmdline = readSysfsLine("/proc/cmdline");
+  std::stringstream ss(cmdline);
+  std::string word;
+  while (ss >> word) {
+    if (word.compare(0, key.size() + 1, key + "=") == 0)
+      return word.substr(key.size() + 1);
+  }
+  return "";
+}
+
+// Touch `bytes` of stack below the caller so later calls never fault on it.
+// Each level of recursion owns one 16 KiB frame, so the walk moves down the
+// stack a page at a time; reading the frame after the call keeps it from
+// becoming a tail call.
+inline size_t prefaultStack(size_t bytes) {
+  volatile unsigned char frame[16 * 1024];
+  for (size_t i = 0; i < sizeof(frame); i += 4096)
+    frame[i] = 0;
+  size_t done = sizeof(frame);
+  if (bytes > done)
+    done += prefaultStack(bytes - done);
+  return done + (frame[0] & 0);
+}
+
+// Raise the calling thread to real-time priority and report what actually
+// took effect. Returns true only if the OS granted it.
+inline bool raiseAndVerifyPriority(std::string &description) {
+  bool requested = setHighPriority();
+#ifdef _WIN32
+  int prio = GetThreadPriority(GetCurrentThread());
+  description = prio == THREAD_PRIORITY_TIME_CRITICAL
+                    ? "THREAD_PRIORITY_TIME_CRITICAL"
+                    : "thread priority " + std::to_string(prio);
+  return requested && prio == THREAD_PRIORITY_TIME_CRITICAL;
+#else
+  int policy = 0;
+  sched_param param;
+  std::memset(&param, 0, sizeof(param));
+  pthread_getschedparam(pthread_self(), &policy, &param);
+  description = policy == SCHED_FIFO ? "SCHED_FIFO"
+                : policy == SCHED_RR ? "SCHED_RR"
+                                     : "SCHED_OTHER";
+  description += " " + std::to_string(param.sched_priority);
+  return requested && policy == SCHED_FIFO;
+#endif
+}
+
+// Set up the calling (measuring) thread and inspect the host
+inline EnvironmentReport applyRunEnvironment(const EnvironmentOptions &opt) {
+  EnvironmentReport r;
+
+  r.core = opt.measureCore >= 0 ? opt.measureCore : currentCore();
+  if (opt.pin && r.core >= 0) {
+    r.pinned = pinCurrentThreadToCore(r.core);
+    if (!r.pinned)
+      r.warnings.push_back("could not pin the measuring thread to core " +
+                           std::to_string(r.core));
+  }
+
+  r.realtime = raiseAndVerifyPriority(r.priority);
+  if (!r.realtime)
+    r.warnings.push_back("real-time priority not granted (running " +
+                         r.priority + "); run as root or grant "
+                         "CAP_SYS_NICE / rtprio");
+
+#ifdef _WIN32
+  r.memoryNote = "not supported on Windows";
+#else
+  if (opt.lockMemory) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+      r.memoryLocked = true;
+    } else {
+      r.memoryNote = std::strerror(errno);
+      r.warnings.push_back("mlockall failed (" + r.memoryNote +
+                           "); page faults may land inside samples");
+    }
+  } else {
+    r.memoryNote = "disabled";
+  }
+#endif
+  if (opt.stackPrefaultBytes > 0)
+    r.stackPrefaulted = prefaultStack(opt.stackPrefaultBytes);
+
+#ifdef __linux__
+  const std::string cpuDir = "/sys/devices/system/cpu/";
+  r.isolatedCpus = readSysfsLine(cpuDir + "isolated");
+  if (r.isolatedCpus.empty())
+    r.isolatedCpus = kernelCmdlineValue("isolcpus");
+  r.nohzFullCpus = readSysfsLine(cpuDir + "nohz_full");
+  if (r.nohzFullCpus.empty())
+    r.nohzFullCpus = kernelCmdlineValue("nohz_full");
+  if (r.core >= 0) {
+    std::string isolated = r.isolatedCpus;
+    // isolcpus may carry flags such as "domain,managed_irq,2-3"
+    std::string cpusOnly;
+    std::stringstream ss(isolated);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+      if (!item.empty() && std::isdigit(static_cast<unsigned char>(item[0])))
+        cpusOnly += (cpusOnly.empty() ? "" : ",") + item;
+    }
+    std::vector<int> isolatedCores;
+    std::string error;
+    parseCoreList(cpusOnly, isolatedCores, error);
+    for (int c : isolatedCores)
+      r.coreIsolated = r.coreIsolated || c == r.core;
+
+    std::string coreDir = cpuDir + "cpu" + std::to_string(r.core);
+    r.governor = readSysfsLine(coreDir + "/cpufreq/scaling_governor");
+    r.smtSiblings = readSysfsLine(coreDir + "/topology/thread_siblings_list");
+  }
+
+  std::string noTurbo = readSysfsLine(cpuDir + "intel_pstate/no_turbo");
+  std::string boost = readSysfsLine(cpuDir + "cpufreq/boost");
+  if (!noTurbo.empty())
+    r.turbo = noTurbo == "0" ? 1 : 0;
+  else if (!boost.empty())
+    r.turbo = boost == "1" ? 1 : 0;
+
+  std::string smt = readSysfsLine(cpuDir + "smt/active");
+  if (!smt.empty())
+    r.smtActive = smt == "1" ? 1 : 0;
+
+  if (r.core >= 0 && !r.coreIsolated)
+    r.warnings.push_back("core " + std::to_string(r.core) +
+                         " is not in isolcpus; the scheduler may run other "
+                         "tasks on it");
+  if (!r.governor.empty() && r.governor != "performance")
+    r.warnings.push_back("cpufreq governor is '" + r.governor +
+                         "', not 'performance'");
+  if (r.turbo == 1)
+    r.warnings.push_back("turbo/boost is enabled; the clock varies with "
+                         "load and temperature");
+  if (r.smtActive == 1 && r.smtSiblings.find_first_of(",-") !=
+                              std::string::npos)
+    r.warnings.push_back("SMT sibling(s) of the measuring core are online "
+                         "(" + r.smtSiblings + ")");
+#endif
+
+  return r;
+}
+
+inline void printRunEnvironment(const EnvironmentReport &r) {
+  auto known = [](const std::string &s) { return s.empty() ? "unknown" : s; };
+  auto tri = [](int v, const char *on, const char *off) {
+    return v < 0 ? "unknown" : v ? on : off;
+  };
+  std::cout << "Run Environment:\n";
+  std::cout << "  Measuring core: "
+            << (r.core >= 0 ? std::to_string(r.core) : "unknown")
+            << (r.pinned ? " (pinned)" : " (not pinned)")
+            << (r.coreIsolated ? ", isolated" : "") << "\n";
+  std::cout << "  Priority: " << r.priority
+            << (r.realtime ? " (verified)" : " (NOT real-time)") << "\n";
+  std::cout << "  Memory: "
+            << (r.memoryLocked ? "locked (mlockall)"
+                               : "not locked (" + r.memoryNote + ")")
+            << ", " << r.stackPrefaulted / 1024 << " KiB stack prefaulted\n";
+  std::cout << "  isolcpus: "
+            << (r.isolatedCpus.empty() ? "none" : r.isolatedCpus)
+            << ", nohz_full: "
+            << (r.nohzFullCpus.empty() ? "none" : r.nohzFullCpus) << "\n";
+  std::cout << "  Governor: " << known(r.governor)
+            << ", Turbo: " << tri(r.turbo, "on", "off")
+            << ", SMT: " << tri(r.smtActive, "on", "off");
+  if (!r.smtSiblings.empty())
+    std::cout << " (core siblings " << r.smtSiblings << ")";
+  std::cout << "\n";
+  for (const auto &w : r.warnings)
+    std::cout << "  WARNING: " << w << "\n";
+}
+
+#endif // RUN_ENVIRONMENT_HPP
@@ -0,0 +1,282 @@
+#ifndef SAMPLE_ARENA_HPP
+#define SAMPLE_ARENA_HPP
+
+// Fixed arena for the sample buffers of the measuring loop.
+// One mapping is made before measuring starts and reused for every
+// pattern and scan. It is backed by explicit huge pages (MAP_HUGETLB /
+// MEM_LARGE_PAGES) when the host has them reserved, else by transparent
+// huge pages (madvise) and then by normal pages. Every page is touched
+// and the mapping is locked, so samples written during the timed loop
+// neither page-fault nor call the allocator. Each fallback is reported;
+// none of them is an error.
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "QuantumLib.hpp"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+constexpr size_t ARENA_HUGE_PAGE = 2 * 1024 * 1024;
+constexpr size_t ARENA_PAGE = 4096; // Prefault stride
+constexpr size_t ARENA_ALIGN = 64;  // Cache line per allocation
+
+struct SampleArenaOptions {
+  bool hugePages = true;
+  bool lock = true; // mlock / VirtualLock; follows --no-mlock
+};
+
+enum class ArenaPages {
+  Explicit,    // MAP_HUGETLB / MEM_LARGE_PAGES
+  Transparent, // madvise(MADV_HUGEPAGE)
+  Normal,      // Anonymous mapping, base pages
+  Heap         // Every mapping failed; plain heap memory
+};
+
+inline const char *arenaPagesName(ArenaPages pages) {
+  switch (pages) {
+  case ArenaPages::Explicit:
+    return "explicit huge pages";
+  case ArenaPages::Transparent:
+    return "transparent huge pages";
+  case ArenaPages::Normal:
+    return "normal pages";
+  case ArenaPages::Heap:
+    return "heap";
+  }
+  return "?";
+}
+
+inline size_t arenaRoundUp(size_t n, size_t unit) {
+  return (n + unit - 1) / unit * unit;
+}
+
+#ifdef __linux__
+// THP mode "never" ignores madvise
+inline bool transparentHugePagesAllowed() {
+  std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+  std::string mode;
+  std::getline(in, mode);
+  return !mode.empty() && mode.find("[never]") == std::string::npos;
+}
+#endif
+
+class SampleArena {
+  uint8_t *base_ = nullptr;
+  size_t capacity_ = 0;
+  size_t used_ = 0;
+  ArenaPages pages_ = ArenaPages::Heap;
+  bool locked_ = false;
+  std::string lockNote_;
+  std::vector<uint8_t> heap_; // ArenaPages::Heap only
+
+  bool map(size_t bytes, const SampleArenaOptions &options) {
+#ifdef _WIN32
+    SIZE_T large = options.hugePages ? GetLargePageMinimum() : 0;
+    if (large > 0) {
+      // Fails without SeLockMemoryPrivilege; large pages are never paged
+      size_t size = arenaRoundUp(bytes, large);
+      void *p = VirtualAlloc(nullptr, size,
+                             MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                             PAGE_READWRITE);
+      if (p) {
+        base_ = static_cast<uint8_t *>(p);
+        capacity_ = size;
+        pages_ = ArenaPages::Explicit;
+        return true;
+      }
+    }
+    size_t size = arenaRoundUp(bytes, ARENA_PAGE);
+    void *p = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT,
+                           PAGE_READWRITE);
+    if (!p)
+      return false;
+    base_ = static_cast<uint8_t *>(p);
+    capacity_ = size;
+    pages_ = ArenaPages::Normal;
+    return true;
+#else
+    (void)options; // Unused where no huge pages are known
+    const int prot = PROT_READ | PROT_WRITE;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+    if (options.hugePages) {
+      // Only succeeds with pages reserved in vm.nr_hugepages
+      size_t size = arenaRoundUp(bytes, ARENA_HUGE_PAGE);
+      void *p = mmap(nullptr, size, prot, flags | MAP_HUGETLB, -1, 0);
+      if (p != MAP_FAILED) {
+        base_ = static_cast<uint8_t *>(p);
+        capacity_ = size;
+        pages_ = ArenaPages::Explicit;
+        return true;
+      }
+    }
+#endif
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (options.hugePages && transparentHugePagesAllowed()) {
+      // A huge page needs a 2 MiB aligned range: over-map, then trim
+      size_t size = arenaRoundUp(bytes, ARENA_HUGE_PAGE);
+      void *p = mmap(nullptr, size + ARENA_HUGE_PAGE, prot, flags, -1, 0);
+      if (p != MAP_FAILED) {
+        uintptr_t start = reinterpret_cast<uintptr_t>(p);
+        uintptr_t aligned = arenaRoundUp(start, ARENA_HUGE_PAGE);
+        if (aligned > start)
+          munmap(p, aligned - start);
+        size_t tail = ARENA_HUGE_PAGE - (aligned - start);
+        if (tail > 0)
+          munmap(reinterpret_cast<void *>(aligned + size), tail);
+        base_ = reinterpret_cast<uint8_t *>(aligned);
+        capacity_ = size;
+        pages_ = madvise(base_, size, MADV_HUGEPAGE) == 0
+                     ? ArenaPages::Transparent
+                     : ArenaPages::Normal;
+        return true;
+      }
+    }
+#endif
+    size_t size = arenaRoundUp(bytes, ARENA_PAGE);
+    void *p = mmap(nullptr, size, prot, flags, -1, 0);
+    if (p == MAP_FAILED)
+      return false;
+    base_ = static_cast<uint8_t *>(p);
+    capacity_ = size;
+    pages_ = ArenaPages::Normal;
+    return true;
+#endif
+  }
+
+  void lock() {
+#ifdef _WIN32
+    if (pages_ == ArenaPages::Explicit) {
+      locked_ = true;
+      return;
+    }
+    if (!VirtualLock(base_, capacity_)) {
+      // The default working-set quota allows only a few locked pages
+      SIZE_T lo = 0, hi = 0;
+      HANDLE process = GetCurrentProcess();
+      if (GetProcessWorkingSetSize(process, &lo, &hi))
+        SetProcessWorkingSetSize(process, lo + capacity_, hi + capacity_);
+      if (!VirtualLock(base_, capacity_)) {
+        lockNote_ = "VirtualLock error " + std::to_string(GetLastError());
+        return;
+      }
+    }
+    locked_ = true;
+#else
+    if (mlock(base_, capacity_) == 0)
+      locked_ = true;
+    else
+      lockNote_ = std::strerror(errno);
+#endif
+  }
+
+public:
+  SampleArena() = default;
+  SampleArena(const SampleArena &) = delete;
+  SampleArena &operator=(const SampleArena &) = delete;
+  ~SampleArena() { release(); }
+
+  // Maps, prefaults and locks at least `bytes`. Falls back to the heap
+  // when no mapping can be made, so the arena is usable either way.
+  void reserve(size_t bytes, const SampleArenaOptions &options) {
+    release();
+    bytes = std::max<size_t>(bytes, 1);
+    if (!map(bytes, options)) {
+      heap_.assign(bytes + ARENA_ALIGN, 0); // Zero-filled: faulted in
+      uintptr_t start = reinterpret_cast<uintptr_t>(heap_.data());
+      base_ = reinterpret_cast<uint8_t *>(arenaRoundUp(start, ARENA_ALIGN));
+      capacity_ = bytes;
+      pages_ = ArenaPages::Heap;
+    }
+    for (size_t i = 0; i < capacity_; i += ARENA_PAGE)
+      static_cast<volatile uint8_t *>(base_)[i] = 0;
+    if (!options.lock)
+      lockNote_ = "disabled";
+    else if (pages_ == ArenaPages::Heap)
+      lockNote_ = "heap fallback";
+    else
+      lock();
+  }
+
+  void release() {
+    if (base_ && pages_ != ArenaPages::Heap) {
+#ifdef _WIN32
+      VirtualFree(base_, 0, MEM_RELEASE);
+#else
+      munmap(base_, capacity_); // Also unlocks
+#endif
+    }
+    heap_.clear();
+    heap_.shrink_to_fit();
+    base_ = nullptr;
+    capacity_ = used_ = 0;
+    locked_ = false;
+    lockNote_.clear();
+  }
+
+  // Cache-line aligned; nullptr once the arena is full
+  template <typename T> T *allocate(size_t n) {
+    static_assert(std::is_trivially_copyable<T>::value, "plain data only");
+    size_t offset = arenaRoundUp(used_, ARENA_ALIGN);
+    if (!base_ || offset > capacity_ || n > (capacity_ - offset) / sizeof(T))
+      return nullptr;
+    used_ = offset + n * sizeof(T);
+    return reinterpret_cast<T *>(base_ + offset);
+  }
+
+  // Hands the whole arena out again; earlier pointers become invalid
+  void reset() { used_ = 0; }
+
+  size_t capacity() const { return capacity_; }
+  size_t used() const { return used_; }
+  ArenaPages pages() const { return pages_; }
+  bool locked() const { return locked_; }
+
+  // e.g. "2048 KiB, transparent huge pages, prefaulted, locked"
+  std::string describe() const {
+    std::string s = std::to_string(capacity_ / 1024) + " KiB, " +
+                    arenaPagesName(pages_) + ", prefaulted, ";
+    return s + (locked_ ? "locked" : "not locked (" + lockNote_ + ")");
+  }
+};
+
+// Fixed-capacity sample buffer in an arena. It never reallocates:
+// values past the capacity are dropped.
+template <typename T> class ArenaBuffer {
+  T *data_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = 0;
+
+public:
+  ArenaBuffer() = default;
+  ArenaBuffer(SampleArena &arena, size_t capacity)
+      : data_(arena.allocate<T>(capacity)),
+        capacity_(data_ ? capacity : 0) {}
+
+  void push_back(T value) {
+    if (size_ < capacity_)
+      data_[size_++] = value;
+  }
+
+  void clear() { size_ = 0; }
+
+  const T *data() const { return data_; }
+  const T *begin() const { return data_; }
+  const T *end() const { return data_ + size_; }
+  size_t size() const { return size_; }
+  size_t capacity() const { return capacity_; }
+  bool empty() const { return size_ == 0; }
+};
+
+#endif // SAMPLE_ARENA_HPP
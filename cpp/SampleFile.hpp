@@ -0,0 +1,406 @@
+#ifndef SAMPLE_FILE_HPP
+#define SAMPLE_FILE_HPP
+
+// Compact binary store for raw measureSingle samples.
+//
+// Layout (little-endian):
+//   SampleFileHeader                       calibration of the writing run
+//   repeated:
+//     SampleBlockHeader                    one block = up to 65536 samples
+//     pattern name (nameLength bytes)      of one pattern
+//     tick sequence (tickCount x uint64)
+//     zero padding to 8 bytes
+//     payload (payloadBytes)               zigzag(delta) LEB128 varints
+//
+// Each block is an independent column: deltas restart from 0, so blocks can
+// be decoded in any order. The reader maps the file (MappedFile.hpp) and
+// decodes straight from the mapping; nothing is copied unless the caller
+// asks for a bulk decode.
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "QuantumLib.hpp"
+
+// ========== On-Disk Structures ==========
+
+constexpr char SAMPLE_FILE_MAGIC[8] = {'C', 'R', 'S', 'A', 'M', 'P', '0', '1'};
+constexpr uint32_t SAMPLE_FILE_VERSION = 1;
+constexpr uint32_t SAMPLE_BLOCK_MAGIC = 0x314B4C42; // "BLK1"
+constexpr uint32_t SAMPLE_BLOCK_SIZE = 65536;       // Samples per full block
+
+#pragma pack(push, 1)
+struct SampleFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerBytes;
+  uint64_t cpuFreqHz;
+  uint64_t tickCenter;
+  uint64_t tickMinus1;
+  uint64_t tickPlus1;
+  int64_t createdUnixSeconds;
+  uint64_t reserved;
+};
+
+struct SampleBlockHeader {
+  uint32_t magic;
+  uint32_t patternId;    // Index of the pattern within its run
+  uint32_t sampleCount;  // Values in this block
+  uint32_t headerBytes;  // This header + name + ticks + padding
+  uint64_t payloadBytes; // Encoded values that follow the header
+  int64_t startUnixNanos;
+  uint8_t fftLevel; // Load index within the run's pattern config
+  uint8_t dynamic;  // 1 = tick sequence, 0 = static tick
+  uint16_t nameLength;
+  uint16_t tickCount;
+  uint16_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(SampleFileHeader) == 64, "unexpected header size");
+static_assert(sizeof(SampleBlockHeader) == 40, "unexpected block size");
+
+// Pattern metadata stored with every block
+struct SamplePatternInfo {
+  uint32_t id = 0;
+  std::string name;
+  uint8_t fftLevel = 0;
+  bool dynamic = false;
+  std::vector<uint64_t> ticks;
+};
+
+// ========== Encoding ==========
+
+inline uint64_t zigzagEncode(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t v) {
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+// Buffers one block of samples, encoding each value as it arrives
+class SampleBlockEncoder {
+  std::vector<uint8_t> bytes_;
+  uint32_t count_ = 0;
+  int64_t previous_ = 0;
+  int64_t startUnixNanos_ = 0;
+
+public:
+  SampleBlockEncoder() { bytes_.reserve(SAMPLE_BLOCK_SIZE * 2); }
+
+  void add(int64_t value) {
+    if (count_ == 0) {
+      startUnixNanos_ = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            std::chrono::system_clock::now().time_since_epoch())
+                            .count();
+    }
+    uint64_t z = zigzagEncode(static_cast<int64_t>(
+        static_cast<uint64_t>(value) - static_cast<uint64_t>(previous_)));
+    previous_ = value;
+    while (z >= 0x80) {
+      bytes_.push_back(static_cast<uint8_t>(z) | 0x80);
+      z >>= 7;
+    }
+    bytes_.push_back(static_cast<uint8_t>(z));
+    count_++;
+  }
+
+  bool full() const { return count_ >= SAMPLE_BLOCK_SIZE; }
+  bool empty() const { return count_ == 0; }
+  uint32_t count() const { return count_; }
+  int64_t startUnixNanos() const { return startUnixNanos_; }
+  const std::vector<uint8_t> &bytes() const { return bytes_; }
+
+  void clear() {
+    bytes_.clear();
+    count_ = 0;
+    previous_ = 0;
+  }
+
+  // Touch the reserved buffer, so filling a block between samples does
+  // not page-fault
+  void prefault() {
+    size_t n = bytes_.size();
+    bytes_.resize(bytes_.capacity());
+    bytes_.resize(n);
+  }
+};
+
+// ========== Writer ==========
+
+// Appends blocks to a sample file. writeBlock() is safe to call from several
+// measuring threads; each thread keeps its own SampleBlockEncoder.
+class SampleFileWriter {
+  std::string path_;
+  std::ofstream out_;
+  std::mutex mutex_;
+  uint64_t blocks_ = 0;
+  uint64_t samples_ = 0;
+  bool failed_ = false;
+
+public:
+  // Opens (or appends to) path. A new file gets a header with `cal`. An
+  // existing file is only extended if it is a sample file of the same
+  // version and calibration; otherwise `error` says why.
+  bool open(const std::string &path, const CalibrationData &cal,
+            std::string &error) {
+    bool exists = false;
+    {
+      std::ifstream probe(path, std::ios::binary | std::ios::ate);
+      exists = probe.good() && probe.tellg() > 0;
+      if (exists) {
+        SampleFileHeader h{};
+        probe.seekg(0);
+        probe.read(reinterpret_cast<char *>(&h), sizeof(h));
+        if (!probe || std::memcmp(h.magic, SAMPLE_FILE_MAGIC, 8) != 0) {
+          error = path + " exists and is not a sample file";
+          return false;
+        }
+        if (h.version != SAMPLE_FILE_VERSION ||
+            h.headerBytes != sizeof(SampleFileHeader)) {
+          error = path + " has sample file version " +
+                  std::to_string(h.version);
+          return false;
+        }
+        if (h.cpuFreqHz != cal.cpu_freq_hz ||
+            h.tickCenter != cal.tick_center ||
+            h.tickMinus1 != cal.tick_minus1 ||
+            h.tickPlus1 != cal.tick_plus1) {
+          error = path + " was written under a different calibration";
+          return false;
+        }
+      }
+    }
+    path_ = path;
+    failed_ = false;
+    out_.open(path, std::ios::binary | std::ios::app);
+    if (!out_) {
+      error = "cannot open " + path;
+      return false;
+    }
+    if (!exists) {
+      SampleFileHeader h{};
+      std::memcpy(h.magic, SAMPLE_FILE_MAGIC, sizeof(h.magic));
+      h.version = SAMPLE_FILE_VERSION;
+      h.headerBytes = sizeof(SampleFileHeader);
+      h.cpuFreqHz = cal.cpu_freq_hz;
+      h.tickCenter = cal.tick_center;
+      h.tickMinus1 = cal.tick_minus1;
+      h.tickPlus1 = cal.tick_plus1;
+      h.createdUnixSeconds = std::chrono::duration_cast<std::chrono::seconds>(
+                                 std::chrono::system_clock::now()
+                                     .time_since_epoch())
+                                 .count();
+      out_.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    }
+    if (!out_) {
+      error = "cannot write " + path;
+      return false;
+    }
+    return true;
+  }
+
+  bool isOpen() const { return out_.is_open(); }
+
+  // Returns false if the block could not be written. A failed stream stays
+  // failed: later blocks are dropped too, and failed() reports it.
+  bool writeBlock(const SamplePatternInfo &info,
+                  const SampleBlockEncoder &encoder) {
+    if (encoder.empty())
+      return true;
+    SampleBlockHeader h{};
+    h.magic = SAMPLE_BLOCK_MAGIC;
+    h.patternId = info.id;
+    h.sampleCount = encoder.count();
+    h.payloadBytes = encoder.bytes().size();
+    h.startUnixNanos = encoder.startUnixNanos();
+    h.fftLevel = info.fftLevel;
+    h.dynamic = info.dynamic ? 1 : 0;
+    h.nameLength = static_cast<uint16_t>(info.name.size());
+    // Long generated schedules keep only their first 65535 ticks
+    h.tickCount = static_cast<uint16_t>(
+        std::min<size_t>(info.ticks.size(), UINT16_MAX));
+    size_t metaBytes = sizeof(h) + h.nameLength + h.tickCount * 8;
+    size_t padding = (8 - metaBytes % 8) % 8;
+    h.headerBytes = static_cast<uint32_t>(metaBytes + padding);
+
+    static const char zeros[8] = {};
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.write(reinterpret_cast<const char *>(&h), sizeof(h));
+    out_.write(info.name.data(), h.nameLength);
+    out_.write(reinterpret_cast<const char *>(info.ticks.data()),
+               h.tickCount * 8);
+    out_.write(zeros, padding);
+    out_.write(reinterpret_cast<const char *>(encoder.bytes().data()),
+               encoder.bytes().size());
+    if (!out_) {
+      failed_ = true;
+      return false;
+    }
+    blocks_++;
+    samples_ += encoder.count();
+    return true;
+  }
+
+  // Bytes on disk after flushing everything written so far
+  uint64_t flushedSize() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.flush();
+    if (!out_)
+      failed_ = true;
+    std::error_code ec;
+    uintmax_t size = std::filesystem::file_size(path_, ec);
+    return ec ? 0 : static_cast<uint64_t>(size);
+  }
+
+  bool failed() const { return failed_; }
+  uint64_t blockCount() const { return blocks_; }
+  uint64_t sampleCount() const { return samples_; }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    out_.close();
+  }
+};
+
+// ========== Memory-Mapped Reader ==========
+
+// Zero-copy view of one block inside the mapping
+struct SampleBlockView {
+  const SampleBlockHeader *header;
+  const char *name;
+  const uint8_t *ticks; // tickCount little-endian uint64 values
+  const uint8_t *payload;
+
+  std::string patternName() const {
+    return std::string(name, header->nameLength);
+  }
+
+  uint64_t tick(size_t i) const {
+    uint64_t t;
+    std::memcpy(&t, ticks + i * 8, 8);
+    return t;
+  }
+};
+
+// Walks the varints of one block without copying them anywhere
+class SampleCursor {
+  const uint8_t *p_;
+  const uint8_t *end_;
+  uint32_t remaining_;
+  int64_t previous_ = 0;
+
+public:
+  explicit SampleCursor(const SampleBlockView &block)
+      : p_(block.payload), end_(block.payload + block.header->payloadBytes),
+        remaining_(block.header->sampleCount) {}
+
+  // Returns false at the end of the block (or on a truncated varint,
+  // which also ends the block)
+  bool next(int64_t &value) {
+    if (remaining_ == 0)
+      return false;
+    uint64_t z = 0;
+    int shift = 0;
+    bool terminated = false;
+    while (p_ < end_ && shift <= 63) {
+      uint8_t b = *p_++;
+      z |= static_cast<uint64_t>(b & 0x7F) << shift;
+      if (!(b & 0x80)) {
+        terminated = true;
+        break;
+      }
+      shift += 7;
+    }
+    if (!terminated) {
+      remaining_ = 0;
+      return false;
+    }
+    previous_ = static_cast<int64_t>(static_cast<uint64_t>(previous_) +
+                                     static_cast<uint64_t>(zigzagDecode(z)));
+    value = previous_;
+    remaining_--;
+    return true;
+  }
+};
+
+class SampleFileReader {
+  MappedFile file_;
+  const uint8_t *data_ = nullptr;
+  size_t size_ = 0;
+
+public:
+  // Maps the file and checks its header
+  bool open(const std::string &path) {
+    close();
+    if (!file_.open(path))
+      return false;
+    data_ = file_.data();
+    size_ = file_.size();
+    if (size_ < sizeof(SampleFileHeader) ||
+        std::memcmp(header().magic, SAMPLE_FILE_MAGIC, 8) != 0 ||
+        header().version != SAMPLE_FILE_VERSION ||
+        header().headerBytes < sizeof(SampleFileHeader) ||
+        header().headerBytes > size_) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+    file_.close();
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+  const SampleFileHeader &header() const {
+    return *reinterpret_cast<const SampleFileHeader *>(data_);
+  }
+
+  // Calls fn(const SampleBlockView &) for every block in file order.
+  // Returns false if the file ends in a truncated or corrupt block.
+  template <typename Fn> bool forEachBlock(Fn fn) const {
+    size_t offset = header().headerBytes;
+    while (offset < size_) {
+      if (size_ - offset < sizeof(SampleBlockHeader))
+        return false;
+      const auto *h =
+          reinterpret_cast<const SampleBlockHeader *>(data_ + offset);
+      // Name and ticks must fit in the block header, the block in the file
+      size_t metaBytes =
+          sizeof(*h) + h->nameLength + static_cast<size_t>(h->tickCount) * 8;
+      if (h->magic != SAMPLE_BLOCK_MAGIC || h->headerBytes < metaBytes ||
+          size_ - offset < h->headerBytes ||
+          size_ - offset - h->headerBytes < h->payloadBytes)
+        return false;
+      SampleBlockView view;
+      view.header = h;
+      view.name = reinterpret_cast<const char *>(data_ + offset + sizeof(*h));
+      view.ticks = data_ + offset + sizeof(*h) + h->nameLength;
+      view.payload = data_ + offset + h->headerBytes;
+      fn(view);
+      offset += h->headerBytes + h->payloadBytes;
+    }
+    return true;
+  }
+
+  // Bulk-decodes one block into out[0 .. sampleCount). Returns values written.
+  static size_t decode(const SampleBlockView &block, int64_t *out) {
+    SampleCursor cursor(block);
+    size_t n = 0;
+    int64_t v;
+    while (cursor.next(v))
+      out[n++] = v;
+    return n;
+  }
+};
+
+#endif // SAMPLE_FILE_HPP
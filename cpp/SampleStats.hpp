@@ -0,0 +1,372 @@
+#ifndef SAMPLE_STATS_HPP
+#define SAMPLE_STATS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// ========== Streaming Sample Statistics ==========
+
+// Histogram layout shared by every report: bins of 20 ops, labelled the same
+// way as the original `(value / 20) * 20` grouping.
+constexpr int HISTOGRAM_BIN_WIDTH = 20;
+constexpr int HISTOGRAM_BINS = 4096; // covers [-40960, 40960)
+constexpr int HISTOGRAM_OFFSET = HISTOGRAM_BINS / 2;
+
+// Online accumulator for one pattern.
+// Count, mean and variance use Welford's update; min/max and a fixed-bin
+// histogram are updated in the same step, so memory does not depend on the
+// number of iterations and no separate analysis pass is needed.
+struct SampleAccumulator {
+  uint64_t count = 0;
+  double mean = 0.0;
+  double m2 = 0.0; // Sum of squared deviations from the mean
+  int minVal = std::numeric_limits<int>::max();
+  int maxVal = std::numeric_limits<int>::min();
+  uint64_t underflow = 0; // Samples below the histogram range
+  uint64_t overflow = 0;  // Samples above the histogram range
+  std::vector<uint64_t> bins;
+
+  SampleAccumulator() : bins(HISTOGRAM_BINS, 0) {}
+
+  // Back to empty, keeping the histogram storage
+  void reset() {
+    count = 0;
+    mean = m2 = 0.0;
+    minVal = std::numeric_limits<int>::max();
+    maxVal = std::numeric_limits<int>::min();
+    underflow = overflow = 0;
+    std::fill(bins.begin(), bins.end(), 0);
+  }
+
+  void add(int value) {
+    count++;
+    double delta = value - mean;
+    mean += delta / static_cast<double>(count);
+    m2 += delta * (value - mean);
+
+    if (value < minVal)
+      minVal = value;
+    if (value > maxVal)
+      maxVal = value;
+
+    int index = value / HISTOGRAM_BIN_WIDTH + HISTOGRAM_OFFSET;
+    if (index < 0) {
+      underflow++;
+    } else if (index >= HISTOGRAM_BINS) {
+      overflow++;
+    } else {
+      bins[index]++;
+    }
+  }
+
+  // Add a buffer of samples; same result as add() per value, up to
+  // rounding. Each chunk is reduced by plain loops the compiler vectorizes
+  // (sum, min and max, then squared deviations from the chunk mean while the
+  // chunk is still in L1) and folded in like a partial accumulator. The
+  // histogram is counted in four interleaved copies so runs of samples in
+  // one bin do not serialize on a single counter; the lane counters are
+  // scratch kept per thread, so repeated calls do not allocate.
+  void addBlock(const int *data, size_t n);
+
+  // Fold in the moments of `n` samples with mean `m` and squared
+  // deviations `s` (Chan et al. parallel update)
+  void mergeMoments(uint64_t n, double m, double s, int lo, int hi) {
+    if (n == 0)
+      return;
+    double total = static_cast<double>(count + n);
+    double delta = m - mean;
+    mean += delta * static_cast<double>(n) / total;
+    m2 += s + delta * delta * static_cast<double>(count) *
+                  static_cast<double>(n) / total;
+    count += n;
+    minVal = std::min(minVal, lo);
+    maxVal = std::max(maxVal, hi);
+  }
+
+  // Combine with another accumulator
+  void merge(const SampleAccumulator &o) {
+    if (o.count == 0)
+      return;
+    if (count == 0) {
+      *this = o;
+      return;
+    }
+    mergeMoments(o.count, o.mean, o.m2, o.minVal, o.maxVal);
+    underflow += o.underflow;
+    overflow += o.overflow;
+    for (int i = 0; i < HISTOGRAM_BINS; i++)
+      bins[i] += o.bins[i];
+  }
+
+  // Population variance (divides by n, as the original analysis did)
+  double variance() const { return count ? m2 / count : 0.0; }
+  double stdDev() const { return std::sqrt(variance()); }
+
+  // Most populated bins as (bin start, count), largest first
+  std::vector<std::pair<int, uint64_t>> topBins(size_t k) const {
+    std::vector<std::pair<int, uint64_t>> nonEmpty;
+    for (int i = 0; i < HISTOGRAM_BINS; i++) {
+      if (bins[i] > 0)
+        nonEmpty.emplace_back((i - HISTOGRAM_OFFSET) * HISTOGRAM_BIN_WIDTH,
+                              bins[i]);
+    }
+    size_t n = std::min(k, nonEmpty.size());
+    std::partial_sort(
+        nonEmpty.begin(), nonEmpty.begin() + n, nonEmpty.end(),
+        [](const auto &a, const auto &b) { return a.second > b.second; });
+    nonEmpty.resize(n);
+    return nonEmpty;
+  }
+};
+
+// ========== End of Streaming Sample Statistics ==========
+
+// ========== Batch Sample Statistics ==========
+
+// Samples per moment chunk: 16 KiB, so the second pass reads from L1
+constexpr size_t SAMPLE_CHUNK = 4096;
+// Buffers smaller than this are reduced on the calling thread
+constexpr size_t SAMPLE_PARALLEL_MIN = size_t(1) << 20;
+
+inline void SampleAccumulator::addBlock(const int *data, size_t n) {
+  constexpr int LANES = 4;
+  // Lane counters are flushed before a uint32_t could overflow
+  constexpr size_t FLUSH = size_t(1) << 30;
+  static thread_local std::vector<uint32_t> lanes;
+  lanes.resize(LANES * HISTOGRAM_BINS);
+
+  for (size_t base = 0; base < n; base += FLUSH) {
+    size_t end = std::min(n, base + FLUSH);
+    std::fill(lanes.begin(), lanes.end(), 0u);
+
+    for (size_t start = base; start < end; start += SAMPLE_CHUNK) {
+      size_t len = std::min(SAMPLE_CHUNK, end - start);
+      const int *v = data + start;
+
+      int64_t sum = 0;
+      int lo = std::numeric_limits<int>::max();
+      int hi = std::numeric_limits<int>::min();
+      for (size_t i = 0; i < len; i++) {
+        sum += v[i];
+        lo = std::min(lo, v[i]);
+        hi = std::max(hi, v[i]);
+      }
+      double chunkMean = static_cast<double>(sum) / static_cast<double>(len);
+
+      // Four partial sums break the floating-point dependency chain
+      double s[LANES] = {0.0, 0.0, 0.0, 0.0};
+      size_t i = 0;
+      for (; i + LANES <= len; i += LANES) {
+        for (int l = 0; l < LANES; l++) {
+          double d = v[i + l] - chunkMean;
+          s[l] += d * d;
+        }
+      }
+      for (; i < len; i++) {
+        double d = v[i] - chunkMean;
+        s[0] += d * d;
+      }
+
+      for (i = 0; i < len; i++) {
+        int index = v[i] / HISTOGRAM_BIN_WIDTH + HISTOGRAM_OFFSET;
+        if (static_cast<unsigned>(index) < HISTOGRAM_BINS)
+          lanes[(i % LANES) * HISTOGRAM_BINS + index]++;
+        else if (index < 0)
+          underflow++;
+        else
+          overflow++;
+      }
+
+      mergeMoments(len, chunkMean, (s[0] + s[1]) + (s[2] + s[3]), lo, hi);
+    }
+
+    for (int l = 0; l < LANES; l++) {
+      const uint32_t *lane = &lanes[l * HISTOGRAM_BINS];
+      for (int b = 0; b < HISTOGRAM_BINS; b++)
+        bins[b] += lane[b];
+    }
+  }
+}
+
+// Statistics of a whole buffer, into `total` (reset first, so a caller
+// measuring repeatedly can reuse one accumulator). Large buffers are split
+// into one contiguous range per hardware thread, and the partial
+// accumulators are merged in range order, so the result does not depend on
+// timing. threads: 0 = std::thread::hardware_concurrency()
+inline void computeSampleStats(const int *data, size_t n,
+                               SampleAccumulator &total,
+                               unsigned threads = 0) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  threads = static_cast<unsigned>(
+      std::min<size_t>(threads, std::max<size_t>(n / SAMPLE_PARALLEL_MIN, 1)));
+
+  total.reset();
+  if (threads <= 1) {
+    total.addBlock(data, n);
+    return;
+  }
+
+  std::vector<SampleAccumulator> partial(threads);
+  std::vector<std::thread> workers;
+  size_t per = (n + threads - 1) / threads;
+  for (unsigned t = 0; t < threads; t++) {
+    size_t first = std::min(n, t * per);
+    size_t last = std::min(n, first + per);
+    workers.emplace_back([&partial, data, t, first, last] {
+      partial[t].addBlock(data + first, last - first);
+    });
+  }
+  for (auto &w : workers)
+    w.join();
+  for (const auto &p : partial)
+    total.merge(p);
+}
+
+inline SampleAccumulator computeSampleStats(const int *data, size_t n,
+                                            unsigned threads = 0) {
+  SampleAccumulator total;
+  computeSampleStats(data, n, total, threads);
+  return total;
+}
+
+inline SampleAccumulator computeSampleStats(const std::vector<int> &data,
+                                            unsigned threads = 0) {
+  return computeSampleStats(data.data(), data.size(), threads);
+}
+
+// Exact percentiles (nearest rank) of samples already reduced into `acc`.
+// The histogram locates the bucket holding each rank; the samples are then
+// fed through add() once more (in any number of pieces, so they need not
+// all be in memory) and only those buckets are counted. A histogram bin
+// spans at most 39 distinct values, so it is counted per value; the
+// underflow and overflow buckets are unbounded and keep their samples.
+// `percents` must be ascending.
+class PercentileSelector {
+  // Bin k holds [20k, 20k + 19] for k > 0, [20k - 19, 20k] for k < 0 and
+  // [-19, 19] for k = 0; value - 20k + 19 indexes all three
+  static constexpr int BIN_VALUES = 2 * HISTOGRAM_BIN_WIDTH - 1;
+
+  struct Target {
+    int bucket;    // -1 underflow, HISTOGRAM_BINS overflow
+    uint64_t skip; // Rank within the bucket
+    int slot;      // Into counts_ (in range) or tails_ (outside)
+  };
+  std::vector<Target> targets_;
+  std::vector<int> slot_; // Per bucket (shifted by one), -1 if not needed
+  std::vector<std::vector<uint64_t>> counts_;
+  std::vector<std::vector<int>> tails_;
+  uint64_t expected_ = 0;
+  uint64_t seen_ = 0;
+
+  static int bucketOf(int value) {
+    int index = value / HISTOGRAM_BIN_WIDTH + HISTOGRAM_OFFSET;
+    return std::max(-1, std::min(index, HISTOGRAM_BINS));
+  }
+  static bool inRange(int bucket) {
+    return bucket >= 0 && bucket < HISTOGRAM_BINS;
+  }
+  static int binBase(int bucket) {
+    return (bucket - HISTOGRAM_OFFSET) * HISTOGRAM_BIN_WIDTH -
+           (HISTOGRAM_BIN_WIDTH - 1);
+  }
+
+public:
+  PercentileSelector(const SampleAccumulator &acc,
+                     const std::vector<double> &percents)
+      : slot_(HISTOGRAM_BINS + 2, -1), expected_(acc.count) {
+    if (acc.count == 0)
+      return;
+    auto bucketSize = [&acc](int bucket) {
+      return bucket < 0                 ? acc.underflow
+             : bucket < HISTOGRAM_BINS ? acc.bins[bucket]
+                                        : acc.overflow;
+    };
+    int b = -1;
+    uint64_t start = 0; // Samples in buckets below b
+    for (double p : percents) {
+      double rank = std::ceil(p / 100.0 * static_cast<double>(acc.count));
+      uint64_t r = std::min<uint64_t>(
+          static_cast<uint64_t>(std::max(rank, 1.0)) - 1, acc.count - 1);
+      while (r >= start + bucketSize(b)) {
+        start += bucketSize(b);
+        b++;
+      }
+      int &slot = slot_[b + 1];
+      if (slot < 0) {
+        if (inRange(b)) {
+          slot = static_cast<int>(counts_.size());
+          counts_.emplace_back(BIN_VALUES, 0);
+        } else {
+          slot = static_cast<int>(tails_.size());
+          tails_.emplace_back();
+          tails_.back().reserve(bucketSize(b));
+        }
+      }
+      targets_.push_back({b, r - start, slot});
+    }
+  }
+
+  void add(const int *data, size_t n) {
+    seen_ += n;
+    for (size_t i = 0; i < n; i++) {
+      int b = bucketOf(data[i]);
+      int s = slot_[b + 1];
+      if (s < 0)
+        continue;
+      if (inRange(b))
+        counts_[s][data[i] - binBase(b)]++;
+      else
+        tails_[s].push_back(data[i]);
+    }
+  }
+
+  // One value per percentile; empty when the samples fed in are not the
+  // ones `acc` was built from
+  std::vector<int> result() {
+    std::vector<int> values;
+    if (seen_ != expected_ || targets_.empty())
+      return values;
+    for (const Target &t : targets_) {
+      if (inRange(t.bucket)) {
+        const std::vector<uint64_t> &c = counts_[t.slot];
+        uint64_t before = 0;
+        int v = 0;
+        while (v + 1 < BIN_VALUES && before + c[v] <= t.skip)
+          before += c[v++];
+        values.push_back(binBase(t.bucket) + v);
+      } else {
+        std::vector<int> &m = tails_[t.slot];
+        auto nth = m.begin() + static_cast<std::ptrdiff_t>(t.skip);
+        std::nth_element(m.begin(), nth, m.end());
+        values.push_back(*nth);
+      }
+    }
+    return values;
+  }
+};
+
+// Exact percentiles of a buffer already reduced into `acc`; the buffer is
+// never sorted or reordered
+inline std::vector<int> exactPercentiles(const int *data, size_t n,
+                                         const SampleAccumulator &acc,
+                                         const std::vector<double> &percents) {
+  PercentileSelector selector(acc, percents);
+  selector.add(data, n);
+  return selector.result();
+}
+
+inline std::vector<int> exactPercentiles(const std::vector<int> &data,
+                                         const SampleAccumulator &acc,
+                                         const std::vector<double> &percents) {
+  return exactPercentiles(data.data(), data.size(), acc, percents);
+}
+
+// ========== End of Batch Sample Statistics ==========
+
+#endif // SAMPLE_STATS_HPP
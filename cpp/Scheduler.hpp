@@ -0,0 +1,163 @@
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+// Wall-clock trigger scheduler for scheduled mode.
+// Triggers are cron-like local times ("*:29:00" = every hour at minute 29).
+// The next trigger is computed once per scan with mktime(), the thread then
+// sleeps on an absolute CLOCK_REALTIME deadline (clock_nanosleep with
+// TIMER_ABSTIME on Linux, so clock steps are honoured and there is no
+// polling), and finally spins the last stretch so the scan starts within
+// microseconds of the trigger.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <time.h>
+#endif
+
+using WallClock = std::chrono::system_clock;
+
+// One trigger time; -1 in hour or minute means "every"
+struct ScheduleTrigger {
+  int hour = -1;
+  int minute = 0;
+  int second = 0;
+};
+
+// Parses "HH:MM:SS", "HH:MM" or with "*" for hour and/or minute
+inline bool parseScheduleTrigger(const std::string &text,
+                                 ScheduleTrigger &out) {
+  int fields[3] = {-1, -1, 0};
+  int count = 0;
+  size_t pos = 0;
+  while (pos <= text.size() && count < 3) {
+    size_t end = text.find(':', pos);
+    if (end == std::string::npos)
+      end = text.size();
+    std::string field = text.substr(pos, end - pos);
+    if (field == "*") {
+      if (count == 2)
+        return false; // Seconds must be explicit
+      fields[count] = -1;
+    } else {
+      if (field.empty() || field.size() > 2 ||
+          field.find_first_not_of("0123456789") != std::string::npos)
+        return false;
+      fields[count] = std::stoi(field);
+    }
+    count++;
+    pos = end + 1;
+  }
+  if (count < 2 || pos <= text.size())
+    return false;
+  if (fields[0] > 23 || fields[1] > 59 || fields[2] > 59)
+    return false;
+  out.hour = fields[0];
+  out.minute = fields[1];
+  out.second = fields[2];
+  return true;
+}
+
+inline std::string formatScheduleTrigger(const ScheduleTrigger &t) {
+  // Sized for any int, so -Wformat-truncation has nothing to report
+  char buf[40];
+  char h[12] = "*", m[12] = "*";
+  if (t.hour >= 0)
+    std::snprintf(h, sizeof(h), "%02d", t.hour);
+  if (t.minute >= 0)
+    std::snprintf(m, sizeof(m), "%02d", t.minute);
+  std::snprintf(buf, sizeof(buf), "%s:%s:%02d", h, m, t.second);
+  return buf;
+}
+
+inline std::tm localTimeOf(WallClock::time_point t) {
+  std::time_t tt = WallClock::to_time_t(t);
+  std::tm tm;
+#ifdef _WIN32
+  localtime_s(&tm, &tt);
+#else
+  localtime_r(&tt, &tm);
+#endif
+  return tm;
+}
+
+// First local time strictly after `after` that matches the trigger.
+// Steps by the smallest wildcard field (minute, hour, else day) and re-checks
+// the fixed fields after mktime() normalisation, so DST gaps are skipped.
+inline WallClock::time_point nextTriggerTime(const ScheduleTrigger &trigger,
+                                             WallClock::time_point after) {
+  std::tm base = localTimeOf(after);
+  base.tm_sec = trigger.second;
+  if (trigger.minute >= 0)
+    base.tm_min = trigger.minute;
+  if (trigger.hour >= 0)
+    base.tm_hour = trigger.hour;
+
+  std::time_t afterT = WallClock::to_time_t(after);
+  for (int step = -1; step < 2 * 24 * 60; step++) {
+    std::tm tm = base;
+    if (trigger.minute < 0)
+      tm.tm_min += step;
+    else if (trigger.hour < 0)
+      tm.tm_hour += step;
+    else
+      tm.tm_mday += step;
+    tm.tm_isdst = -1;
+    std::time_t t = std::mktime(&tm);
+    if (t == static_cast<std::time_t>(-1) || t <= afterT)
+      continue;
+    if (tm.tm_sec != trigger.second ||
+        (trigger.minute >= 0 && tm.tm_min != trigger.minute) ||
+        (trigger.hour >= 0 && tm.tm_hour != trigger.hour))
+      continue;
+    return WallClock::from_time_t(t);
+  }
+  return WallClock::time_point::max();
+}
+
+// Earliest upcoming time over a set of triggers
+inline WallClock::time_point
+nextTriggerTime(const std::vector<ScheduleTrigger> &triggers,
+                WallClock::time_point after) {
+  WallClock::time_point best = WallClock::time_point::max();
+  for (const auto &trigger : triggers)
+    best = std::min(best, nextTriggerTime(trigger, after));
+  return best;
+}
+
+// Block until the wall clock reaches `deadline`
+inline void sleepUntilWallClock(WallClock::time_point deadline) {
+#ifdef __linux__
+  auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                deadline.time_since_epoch())
+                .count();
+  timespec ts;
+  ts.tv_sec = static_cast<time_t>(ns / 1000000000LL);
+  ts.tv_nsec = static_cast<long>(ns % 1000000000LL);
+  while (clock_nanosleep(CLOCK_REALTIME, TIMER_ABSTIME, &ts, nullptr) ==
+         EINTR) {
+  }
+#else
+  // No absolute realtime sleep: stop 2 ms early and spin the rest
+  std::this_thread::sleep_until(deadline - std::chrono::milliseconds(2));
+  while (WallClock::now() < deadline) {
+  }
+#endif
+}
+
+// Keep the calling core busy with `work` until the wall clock reaches
+// `deadline`. `work` should take a few microseconds per call.
+template <typename Work>
+inline void spinUntilWallClock(WallClock::time_point deadline, Work work) {
+  while (WallClock::now() < deadline)
+    work();
+}
+
+#endif // SCHEDULER_HPP
@@ -0,0 +1,736 @@
+#ifndef SIMD_KERNELS_HPP
+#define SIMD_KERNELS_HPP
+
+// Runtime-dispatched SIMD kernels.
+// Every kernel exists in a scalar version (the reference) and in AVX2,
+// AVX-512 and NEON versions. The vector versions are compiled with per-
+// function target attributes, so a binary built without -march=native still
+// contains them and picks the widest one the host supports at startup.
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define QL_SIMD_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define QL_SIMD_NEON 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define QL_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define QL_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define QL_TARGET_AVX2
+#define QL_TARGET_AVX512
+#endif
+
+// ========== CPU Feature Detection ==========
+
+enum class SimdLevel { Scalar, NEON, AVX2, AVX512 };
+
+inline const char *simdLevelName(SimdLevel level) {
+  switch (level) {
+  case SimdLevel::Scalar:
+    return "scalar";
+  case SimdLevel::NEON:
+    return "neon";
+  case SimdLevel::AVX2:
+    return "avx2";
+  case SimdLevel::AVX512:
+    return "avx512";
+  }
+  return "unknown";
+}
+
+inline bool parseSimdLevel(const std::string &name, SimdLevel &level) {
+  for (SimdLevel l : {SimdLevel::Scalar, SimdLevel::NEON, SimdLevel::AVX2,
+                      SimdLevel::AVX512}) {
+    if (name == simdLevelName(l)) {
+      level = l;
+      return true;
+    }
+  }
+  return false;
+}
+
+#ifdef QL_SIMD_X86
+inline void cpuidCount(uint32_t leaf, uint32_t sub, uint32_t regs[4]) {
+#ifdef _MSC_VER
+  int r[4];
+  __cpuidex(r, static_cast<int>(leaf), static_cast<int>(sub));
+  for (int i = 0; i < 4; i++)
+    regs[i] = static_cast<uint32_t>(r[i]);
+#else
+  __cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+// XCR0: which register states the OS saves on context switch
+inline uint64_t readXCR0() {
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  uint32_t eax, edx;
+  __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+// Whether the CPU and the OS both support a level
+inline bool simdLevelSupported(SimdLevel level) {
+  if (level == SimdLevel::Scalar)
+    return true;
+#ifdef QL_SIMD_X86
+  uint32_t r1[4], r7[4], r0[4];
+  cpuidCount(0, 0, r0);
+  if (r0[0] < 7)
+    return false;
+  cpuidCount(1, 0, r1);
+  cpuidCount(7, 0, r7);
+  bool osxsave = (r1[2] >> 27) & 1;
+  if (!osxsave)
+    return false;
+  uint64_t xcr0 = readXCR0();
+  bool avxState = (xcr0 & 0x6) == 0x6;
+  bool avx512State = (xcr0 & 0xE6) == 0xE6;
+  bool avx2 = (r7[1] >> 5) & 1;
+  bool fma = (r1[2] >> 12) & 1;
+  bool avx512f = (r7[1] >> 16) & 1;
+  if (level == SimdLevel::AVX2)
+    return avxState && avx2 && fma;
+  if (level == SimdLevel::AVX512)
+    return avx512State && avx512f;
+  return false;
+#elif defined(QL_SIMD_NEON)
+  if (level != SimdLevel::NEON)
+    return false;
+#if defined(__linux__)
+#ifndef HWCAP_ASIMD
+#define HWCAP_ASIMD (1 << 1)
+#endif
+  return (getauxval(AT_HWCAP) & HWCAP_ASIMD) != 0;
+#else
+  return true; // Advanced SIMD is mandatory on Apple Silicon and Windows ARM64
+#endif
+#else
+  return false;
+#endif
+}
+
+// Widest level usable on this host
+inline SimdLevel detectSimdLevel() {
+  for (SimdLevel l : {SimdLevel::AVX512, SimdLevel::AVX2, SimdLevel::NEON}) {
+    if (simdLevelSupported(l))
+      return l;
+  }
+  return SimdLevel::Scalar;
+}
+
+inline SimdLevel &activeSimdLevelStorage() {
+  static SimdLevel level = detectSimdLevel();
+  return level;
+}
+
+inline SimdLevel activeSimdLevel() { return activeSimdLevelStorage(); }
+
+// Force a level (e.g. scalar for comparison). Fails if the host lacks it.
+inline bool setSimdLevel(SimdLevel level) {
+  if (!simdLevelSupported(level))
+    return false;
+  activeSimdLevelStorage() = level;
+  return true;
+}
+
+// ========== FFT Radix-4 Pass Kernels (split real/imag layout) ==========
+//
+// One radix-4 DIT pass over n points with quarter size m. For every block of
+// 4m points and j < m:
+//   c1 = x[j+m]*W^2j, c2 = x[j+2m]*W^j, c3 = x[j+3m]*W^3j
+//   y[j]    = x[j] + c1 + (c2 + c3)      y[j+2m] = x[j] + c1 - (c2 + c3)
+//   y[j+m]  = x[j] - c1 + i*(c2 - c3)    y[j+3m] = x[j] - c1 - i*(c2 - c3)
+// Twiddle block layout: w1re[m] w1im[m] w2re[m] w2im[m] w3re[m] w3im[m].
+// The inverse transform conjugates the twiddles and rotates by -i.
+
+using FFTRadix4PassFn = void (*)(double *re, double *im, int n, int m,
+                                 const double *tw, bool inverse);
+
+inline void fftRadix4PassScalar(double *re, double *im, int n, int m,
+                                const double *tw, bool inverse) {
+  const double sign = inverse ? -1.0 : 1.0;
+  const double *w1r = tw, *w1i = tw + m;
+  const double *w2r = tw + 2 * m, *w2i = tw + 3 * m;
+  const double *w3r = tw + 4 * m, *w3i = tw + 5 * m;
+  for (int base = 0; base < n; base += 4 * m) {
+    double *r0 = re + base, *r1 = r0 + m, *r2 = r1 + m, *r3 = r2 + m;
+    double *i0 = im + base, *i1 = i0 + m, *i2 = i1 + m, *i3 = i2 + m;
+    for (int j = 0; j < m; j++) {
+      double a1r = w1r[j], a1i = sign * w1i[j];
+      double a2r = w2r[j], a2i = sign * w2i[j];
+      double a3r = w3r[j], a3i = sign * w3i[j];
+
+      double c1r = r1[j] * a2r - i1[j] * a2i;
+      double c1i = r1[j] * a2i + i1[j] * a2r;
+      double c2r = r2[j] * a1r - i2[j] * a1i;
+      double c2i = r2[j] * a1i + i2[j] * a1r;
+      double c3r = r3[j] * a3r - i3[j] * a3i;
+      double c3i = r3[j] * a3i + i3[j] * a3r;
+
+      double s01r = r0[j] + c1r, s01i = i0[j] + c1i;
+      double d01r = r0[j] - c1r, d01i = i0[j] - c1i;
+      double s23r = c2r + c3r, s23i = c2i + c3i;
+      double d23r = c2r - c3r, d23i = c2i - c3i;
+      double rotr = -sign * d23i, roti = sign * d23r;
+
+      r0[j] = s01r + s23r;
+      i0[j] = s01i + s23i;
+      r1[j] = d01r + rotr;
+      i1[j] = d01i + roti;
+      r2[j] = s01r - s23r;
+      i2[j] = s01i - s23i;
+      r3[j] = d01r - rotr;
+      i3[j] = d01i - roti;
+    }
+  }
+}
+
+#ifdef QL_SIMD_X86
+QL_TARGET_AVX2 inline void fftRadix4PassAVX2(double *re, double *im, int n,
+                                             int m, const double *tw,
+                                             bool inverse) {
+  if (m < 4) {
+    fftRadix4PassScalar(re, im, n, m, tw, inverse);
+    return;
+  }
+  const __m256d sign = _mm256_set1_pd(inverse ? -1.0 : 1.0);
+  const __m256d negSign = _mm256_set1_pd(inverse ? 1.0 : -1.0);
+  const double *w1r = tw, *w1i = tw + m;
+  const double *w2r = tw + 2 * m, *w2i = tw + 3 * m;
+  const double *w3r = tw + 4 * m, *w3i = tw + 5 * m;
+  for (int base = 0; base < n; base += 4 * m) {
+    double *r0 = re + base, *r1 = r0 + m, *r2 = r1 + m, *r3 = r2 + m;
+    double *i0 = im + base, *i1 = i0 + m, *i2 = i1 + m, *i3 = i2 + m;
+    for (int j = 0; j < m; j += 4) {
+      __m256d a1r = _mm256_loadu_pd(w1r + j);
+      __m256d a1i = _mm256_mul_pd(sign, _mm256_loadu_pd(w1i + j));
+      __m256d a2r = _mm256_loadu_pd(w2r + j);
+      __m256d a2i = _mm256_mul_pd(sign, _mm256_loadu_pd(w2i + j));
+      __m256d a3r = _mm256_loadu_pd(w3r + j);
+      __m256d a3i = _mm256_mul_pd(sign, _mm256_loadu_pd(w3i + j));
+
+      __m256d x0r = _mm256_loadu_pd(r0 + j), x0i = _mm256_loadu_pd(i0 + j);
+      __m256d x1r = _mm256_loadu_pd(r1 + j), x1i = _mm256_loadu_pd(i1 + j);
+      __m256d x2r = _mm256_loadu_pd(r2 + j), x2i = _mm256_loadu_pd(i2 + j);
+      __m256d x3r = _mm256_loadu_pd(r3 + j), x3i = _mm256_loadu_pd(i3 + j);
+
+      __m256d c1r = _mm256_fmsub_pd(x1r, a2r, _mm256_mul_pd(x1i, a2i));
+      __m256d c1i = _mm256_fmadd_pd(x1r, a2i, _mm256_mul_pd(x1i, a2r));
+      __m256d c2r = _mm256_fmsub_pd(x2r, a1r, _mm256_mul_pd(x2i, a1i));
+      __m256d c2i = _mm256_fmadd_pd(x2r, a1i, _mm256_mul_pd(x2i, a1r));
+      __m256d c3r = _mm256_fmsub_pd(x3r, a3r, _mm256_mul_pd(x3i, a3i));
+      __m256d c3i = _mm256_fmadd_pd(x3r, a3i, _mm256_mul_pd(x3i, a3r));
+
+      __m256d s01r = _mm256_add_pd(x0r, c1r), s01i = _mm256_add_pd(x0i, c1i);
+      __m256d d01r = _mm256_sub_pd(x0r, c1r), d01i = _mm256_sub_pd(x0i, c1i);
+      __m256d s23r = _mm256_add_pd(c2r, c3r), s23i = _mm256_add_pd(c2i, c3i);
+      __m256d d23r = _mm256_sub_pd(c2r, c3r), d23i = _mm256_sub_pd(c2i, c3i);
+      __m256d rotr = _mm256_mul_pd(negSign, d23i);
+      __m256d roti = _mm256_mul_pd(sign, d23r);
+
+      _mm256_storeu_pd(r0 + j, _mm256_add_pd(s01r, s23r));
+      _mm256_storeu_pd(i0 + j, _mm256_add_pd(s01i, s23i));
+      _mm256_storeu_pd(r1 + j, _mm256_add_pd(d01r, rotr));
+      _mm256_storeu_pd(i1 + j, _mm256_add_pd(d01i, roti));
+      _mm256_storeu_pd(r2 + j, _mm256_sub_pd(s01r, s23r));
+      _mm256_storeu_pd(i2 + j, _mm256_sub_pd(s01i, s23i));
+      _mm256_storeu_pd(r3 + j, _mm256_sub_pd(d01r, rotr));
+      _mm256_storeu_pd(i3 + j, _mm256_sub_pd(d01i, roti));
+    }
+  }
+}
+
+QL_TARGET_AVX512 inline void fftRadix4PassAVX512(double *re, double *im,
+                                                 int n, int m,
+                                                 const double *tw,
+                                                 bool inverse) {
+  if (m < 8) {
+    fftRadix4PassScalar(re, im, n, m, tw, inverse);
+    return;
+  }
+  const __m512d sign = _mm512_set1_pd(inverse ? -1.0 : 1.0);
+  const __m512d negSign = _mm512_set1_pd(inverse ? 1.0 : -1.0);
+  const double *w1r = tw, *w1i = tw + m;
+  const double *w2r = tw + 2 * m, *w2i = tw + 3 * m;
+  const double *w3r = tw + 4 * m, *w3i = tw + 5 * m;
+  for (int base = 0; base < n; base += 4 * m) {
+    double *r0 = re + base, *r1 = r0 + m, *r2 = r1 + m, *r3 = r2 + m;
+    double *i0 = im + base, *i1 = i0 + m, *i2 = i1 + m, *i3 = i2 + m;
+    for (int j = 0; j < m; j += 8) {
+      __m512d a1r = _mm512_loadu_pd(w1r + j);
+      __m512d a1i = _mm512_mul_pd(sign, _mm512_loadu_pd(w1i + j));
+      __m512d a2r = _mm512_loadu_pd(w2r + j);
+      __m512d a2i = _mm512_mul_pd(sign, _mm512_loadu_pd(w2i + j));
+      __m512d a3r = _mm512_loadu_pd(w3r + j);
+      __m512d a3i = _mm512_mul_pd(sign, _mm512_loadu_pd(w3i + j));
+
+      __m512d x0r = _mm512_loadu_pd(r0 + j), x0i = _mm512_loadu_pd(i0 + j);
+      __m512d x1r = _mm512_loadu_pd(r1 + j), x1i = _mm512_loadu_pd(i1 + j);
+      __m512d x2r = _mm512_loadu_pd(r2 + j), x2i = _mm512_loadu_pd(i2 + j);
+      __m512d x3r = _mm512_loadu_pd(r3 + j), x3i = _mm512_loadu_pd(i3 + j);
+
+      __m512d c1r = _mm512_fmsub_pd(x1r, a2r, _mm512_mul_pd(x1i, a2i));
+      __m512d c1i = _mm512_fmadd_pd(x1r, a2i, _mm512_mul_pd(x1i, a2r));
+      __m512d c2r = _mm512_fmsub_pd(x2r, a1r, _mm512_mul_pd(x2i, a1i));
+      __m512d c2i = _mm512_fmadd_pd(x2r, a1i, _mm512_mul_pd(x2i, a1r));
+      __m512d c3r = _mm512_fmsub_pd(x3r, a3r, _mm512_mul_pd(x3i, a3i));
+      __m512d c3i = _mm512_fmadd_pd(x3r, a3i, _mm512_mul_pd(x3i, a3r));
+
+      __m512d s01r = _mm512_add_pd(x0r, c1r), s01i = _mm512_add_pd(x0i, c1i);
+      __m512d d01r = _mm512_sub_pd(x0r, c1r), d01i = _mm512_sub_pd(x0i, c1i);
+      __m512d s23r = _mm512_add_pd(c2r, c3r), s23i = _mm512_add_pd(c2i, c3i);
+      __m512d d23r = _mm512_sub_pd(c2r, c3r), d23i = _mm512_sub_pd(c2i, c3i);
+      __m512d rotr = _mm512_mul_pd(negSign, d23i);
+      __m512d roti = _mm512_mul_pd(sign, d23r);
+
+      _mm512_storeu_pd(r0 + j, _mm512_add_pd(s01r, s23r));
+      _mm512_storeu_pd(i0 + j, _mm512_add_pd(s01i, s23i));
+      _mm512_storeu_pd(r1 + j, _mm512_add_pd(d01r, rotr));
+      _mm512_storeu_pd(i1 + j, _mm512_add_pd(d01i, roti));
+      _mm512_storeu_pd(r2 + j, _mm512_sub_pd(s01r, s23r));
+      _mm512_storeu_pd(i2 + j, _mm512_sub_pd(s01i, s23i));
+      _mm512_storeu_pd(r3 + j, _mm512_sub_pd(d01r, rotr));
+      _mm512_storeu_pd(i3 + j, _mm512_sub_pd(d01i, roti));
+    }
+  }
+}
+#endif // QL_SIMD_X86
+
+#ifdef QL_SIMD_NEON
+inline void fftRadix4PassNEON(double *re, double *im, int n, int m,
+                              const double *tw, bool inverse) {
+  if (m < 2) {
+    fftRadix4PassScalar(re, im, n, m, tw, inverse);
+    return;
+  }
+  const float64x2_t sign = vdupq_n_f64(inverse ? -1.0 : 1.0);
+  const float64x2_t negSign = vdupq_n_f64(inverse ? 1.0 : -1.0);
+  const double *w1r = tw, *w1i = tw + m;
+  const double *w2r = tw + 2 * m, *w2i = tw + 3 * m;
+  const double *w3r = tw + 4 * m, *w3i = tw + 5 * m;
+  for (int base = 0; base < n; base += 4 * m) {
+    double *r0 = re + base, *r1 = r0 + m, *r2 = r1 + m, *r3 = r2 + m;
+    double *i0 = im + base, *i1 = i0 + m, *i2 = i1 + m, *i3 = i2 + m;
+    for (int j = 0; j < m; j += 2) {
+      float64x2_t a1r = vld1q_f64(w1r + j);
+      float64x2_t a1i = vmulq_f64(sign, vld1q_f64(w1i + j));
+      float64x2_t a2r = vld1q_f64(w2r + j);
+      float64x2_t a2i = vmulq_f64(sign, vld1q_f64(w2i + j));
+      float64x2_t a3r = vld1q_f64(w3r + j);
+      float64x2_t a3i = vmulq_f64(sign, vld1q_f64(w3i + j));
+
+      float64x2_t x0r = vld1q_f64(r0 + j), x0i = vld1q_f64(i0 + j);
+      float64x2_t x1r = vld1q_f64(r1 + j), x1i = vld1q_f64(i1 + j);
+      float64x2_t x2r = vld1q_f64(r2 + j), x2i = vld1q_f64(i2 + j);
+      float64x2_t x3r = vld1q_f64(r3 + j), x3i = vld1q_f64(i3 + j);
+
+      float64x2_t c1r = vfmsq_f64(vmulq_f64(x1r, a2r), x1i, a2i);
+      float64x2_t c1i = vfmaq_f64(vmulq_f64(x1r, a2i), x1i, a2r);
+      float64x2_t c2r = vfmsq_f64(vmulq_f64(x2r, a1r), x2i, a1i);
+      float64x2_t c2i = vfmaq_f64(vmulq_f64(x2r, a1i), x2i, a1r);
+      float64x2_t c3r = vfmsq_f64(vmulq_f64(x3r, a3r), x3i, a3i);
+      float64x2_t c3i = vfmaq_f64(vmulq_f64(x3r, a3i), x3i, a3r);
+
+      float64x2_t s01r = vaddq_f64(x0r, c1r), s01i = vaddq_f64(x0i, c1i);
+      float64x2_t d01r = vsubq_f64(x0r, c1r), d01i = vsubq_f64(x0i, c1i);
+      float64x2_t s23r = vaddq_f64(c2r, c3r), s23i = vaddq_f64(c2i, c3i);
+      float64x2_t d23r = vsubq_f64(c2r, c3r), d23i = vsubq_f64(c2i, c3i);
+      float64x2_t rotr = vmulq_f64(negSign, d23i);
+      float64x2_t roti = vmulq_f64(sign, d23r);
+
+      vst1q_f64(r0 + j, vaddq_f64(s01r, s23r));
+      vst1q_f64(i0 + j, vaddq_f64(s01i, s23i));
+      vst1q_f64(r1 + j, vaddq_f64(d01r, rotr));
+      vst1q_f64(i1 + j, vaddq_f64(d01i, roti));
+      vst1q_f64(r2 + j, vsubq_f64(s01r, s23r));
+      vst1q_f64(i2 + j, vsubq_f64(s01i, s23i));
+      vst1q_f64(r3 + j, vsubq_f64(d01r, rotr));
+      vst1q_f64(i3 + j, vsubq_f64(d01i, roti));
+    }
+  }
+}
+#endif // QL_SIMD_NEON
+
+inline FFTRadix4PassFn fftRadix4PassFor(SimdLevel level) {
+  switch (level) {
+#ifdef QL_SIMD_X86
+  case SimdLevel::AVX2:
+    return fftRadix4PassAVX2;
+  case SimdLevel::AVX512:
+    return fftRadix4PassAVX512;
+#endif
+#ifdef QL_SIMD_NEON
+  case SimdLevel::NEON:
+    return fftRadix4PassNEON;
+#endif
+  default:
+    return fftRadix4PassScalar;
+  }
+}
+
+// ========== State-Vector Gate Kernels (split real/imag layout) ==========
+//
+// An n-qubit state holds 2^n amplitudes in re[]/im[]. A gate on `target`
+// updates every pair (i, i + 2^target) with bit `target` of i clear, and only
+// where all bits of controlMask are set in i (0 = uncontrolled).
+// Vector versions need target and every control bit at or above log2(lanes)
+// so that each vector covers lanes with identical control bits; otherwise they
+// fall back to the scalar kernel.
+// A 2x2 matrix m is passed as {m00r, m00i, m01r, m01i, m10r, m10i, m11r, m11i}.
+
+using GateMatrixFn = void (*)(double *re, double *im, size_t dim, int target,
+                              size_t controlMask, const double *m);
+using GatePhaseFn = void (*)(double *re, double *im, size_t dim, int target,
+                             size_t controlMask, double phaseRe,
+                             double phaseIm);
+using GateSwapFn = void (*)(double *re, double *im, size_t dim, int target,
+                            size_t controlMask);
+
+inline bool gateLanesUsable(int target, size_t controlMask, int log2Lanes) {
+  size_t lowMask = (size_t(1) << log2Lanes) - 1;
+  return target >= log2Lanes && (controlMask & lowMask) == 0;
+}
+
+inline void gateMatrixScalar(double *re, double *im, size_t dim, int target,
+                             size_t controlMask, const double *m) {
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo++) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      double a0r = re[i0], a0i = im[i0], a1r = re[i1], a1i = im[i1];
+      re[i0] = m[0] * a0r - m[1] * a0i + m[2] * a1r - m[3] * a1i;
+      im[i0] = m[0] * a0i + m[1] * a0r + m[2] * a1i + m[3] * a1r;
+      re[i1] = m[4] * a0r - m[5] * a0i + m[6] * a1r - m[7] * a1i;
+      im[i1] = m[4] * a0i + m[5] * a0r + m[6] * a1i + m[7] * a1r;
+    }
+  }
+}
+
+// Multiplies the |1> amplitude of target by (phaseRe + i*phaseIm)
+inline void gatePhaseScalar(double *re, double *im, size_t dim, int target,
+                            size_t controlMask, double phaseRe,
+                            double phaseIm) {
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo++) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      double r = re[i1], i = im[i1];
+      re[i1] = r * phaseRe - i * phaseIm;
+      im[i1] = r * phaseIm + i * phaseRe;
+    }
+  }
+}
+
+// Swaps the |0> and |1> amplitudes of target (X; CNOT when controlled)
+inline void gateSwapScalar(double *re, double *im, size_t dim, int target,
+                           size_t controlMask) {
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo++) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      std::swap(re[i0], re[i1]);
+      std::swap(im[i0], im[i1]);
+    }
+  }
+}
+
+#ifdef QL_SIMD_X86
+QL_TARGET_AVX2 inline void gateMatrixAVX2(double *re, double *im, size_t dim,
+                                          int target, size_t controlMask,
+                                          const double *m) {
+  if (!gateLanesUsable(target, controlMask, 2)) {
+    gateMatrixScalar(re, im, dim, target, controlMask, m);
+    return;
+  }
+  const __m256d m00r = _mm256_set1_pd(m[0]), m00i = _mm256_set1_pd(m[1]);
+  const __m256d m01r = _mm256_set1_pd(m[2]), m01i = _mm256_set1_pd(m[3]);
+  const __m256d m10r = _mm256_set1_pd(m[4]), m10i = _mm256_set1_pd(m[5]);
+  const __m256d m11r = _mm256_set1_pd(m[6]), m11i = _mm256_set1_pd(m[7]);
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo += 4) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      __m256d a0r = _mm256_loadu_pd(re + i0), a0i = _mm256_loadu_pd(im + i0);
+      __m256d a1r = _mm256_loadu_pd(re + i1), a1i = _mm256_loadu_pd(im + i1);
+      __m256d n0r = _mm256_fmsub_pd(m00r, a0r, _mm256_mul_pd(m00i, a0i));
+      n0r = _mm256_fmadd_pd(m01r, a1r, n0r);
+      n0r = _mm256_sub_pd(n0r, _mm256_mul_pd(m01i, a1i));
+      __m256d n0i = _mm256_fmadd_pd(m00r, a0i, _mm256_mul_pd(m00i, a0r));
+      n0i = _mm256_fmadd_pd(m01r, a1i, n0i);
+      n0i = _mm256_fmadd_pd(m01i, a1r, n0i);
+      __m256d n1r = _mm256_fmsub_pd(m10r, a0r, _mm256_mul_pd(m10i, a0i));
+      n1r = _mm256_fmadd_pd(m11r, a1r, n1r);
+      n1r = _mm256_sub_pd(n1r, _mm256_mul_pd(m11i, a1i));
+      __m256d n1i = _mm256_fmadd_pd(m10r, a0i, _mm256_mul_pd(m10i, a0r));
+      n1i = _mm256_fmadd_pd(m11r, a1i, n1i);
+      n1i = _mm256_fmadd_pd(m11i, a1r, n1i);
+      _mm256_storeu_pd(re + i0, n0r);
+      _mm256_storeu_pd(im + i0, n0i);
+      _mm256_storeu_pd(re + i1, n1r);
+      _mm256_storeu_pd(im + i1, n1i);
+    }
+  }
+}
+
+QL_TARGET_AVX2 inline void gatePhaseAVX2(double *re, double *im, size_t dim,
+                                         int target, size_t controlMask,
+                                         double phaseRe, double phaseIm) {
+  if (!gateLanesUsable(target, controlMask, 2)) {
+    gatePhaseScalar(re, im, dim, target, controlMask, phaseRe, phaseIm);
+    return;
+  }
+  const __m256d pr = _mm256_set1_pd(phaseRe), pi = _mm256_set1_pd(phaseIm);
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo += 4) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      __m256d r = _mm256_loadu_pd(re + i1), i = _mm256_loadu_pd(im + i1);
+      _mm256_storeu_pd(re + i1, _mm256_fmsub_pd(r, pr, _mm256_mul_pd(i, pi)));
+      _mm256_storeu_pd(im + i1, _mm256_fmadd_pd(r, pi, _mm256_mul_pd(i, pr)));
+    }
+  }
+}
+
+QL_TARGET_AVX2 inline void gateSwapAVX2(double *re, double *im, size_t dim,
+                                        int target, size_t controlMask) {
+  if (!gateLanesUsable(target, controlMask, 2)) {
+    gateSwapScalar(re, im, dim, target, controlMask);
+    return;
+  }
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo += 4) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      __m256d a0r = _mm256_loadu_pd(re + i0), a0i = _mm256_loadu_pd(im + i0);
+      __m256d a1r = _mm256_loadu_pd(re + i1), a1i = _mm256_loadu_pd(im + i1);
+      _mm256_storeu_pd(re + i0, a1r);
+      _mm256_storeu_pd(im + i0, a1i);
+      _mm256_storeu_pd(re + i1, a0r);
+      _mm256_storeu_pd(im + i1, a0i);
+    }
+  }
+}
+
+QL_TARGET_AVX512 inline void gateMatrixAVX512(double *re, double *im,
+                                              size_t dim, int target,
+                                              size_t controlMask,
+                                              const double *m) {
+  if (!gateLanesUsable(target, controlMask, 3)) {
+    gateMatrixScalar(re, im, dim, target, controlMask, m);
+    return;
+  }
+  const __m512d m00r = _mm512_set1_pd(m[0]), m00i = _mm512_set1_pd(m[1]);
+  const __m512d m01r = _mm512_set1_pd(m[2]), m01i = _mm512_set1_pd(m[3]);
+  const __m512d m10r = _mm512_set1_pd(m[4]), m10i = _mm512_set1_pd(m[5]);
+  const __m512d m11r = _mm512_set1_pd(m[6]), m11i = _mm512_set1_pd(m[7]);
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo += 8) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      __m512d a0r = _mm512_loadu_pd(re + i0), a0i = _mm512_loadu_pd(im + i0);
+      __m512d a1r = _mm512_loadu_pd(re + i1), a1i = _mm512_loadu_pd(im + i1);
+      __m512d n0r = _mm512_fmsub_pd(m00r, a0r, _mm512_mul_pd(m00i, a0i));
+      n0r = _mm512_fmadd_pd(m01r, a1r, n0r);
+      n0r = _mm512_sub_pd(n0r, _mm512_mul_pd(m01i, a1i));
+      __m512d n0i = _mm512_fmadd_pd(m00r, a0i, _mm512_mul_pd(m00i, a0r));
+      n0i = _mm512_fmadd_pd(m01r, a1i, n0i);
+      n0i = _mm512_fmadd_pd(m01i, a1r, n0i);
+      __m512d n1r = _mm512_fmsub_pd(m10r, a0r, _mm512_mul_pd(m10i, a0i));
+      n1r = _mm512_fmadd_pd(m11r, a1r, n1r);
+      n1r = _mm512_sub_pd(n1r, _mm512_mul_pd(m11i, a1i));
+      __m512d n1i = _mm512_fmadd_pd(m10r, a0i, _mm512_mul_pd(m10i, a0r));
+      n1i = _mm512_fmadd_pd(m11r, a1i, n1i);
+      n1i = _mm512_fmadd_pd(m11i, a1r, n1i);
+      _mm512_storeu_pd(re + i0, n0r);
+      _mm512_storeu_pd(im + i0, n0i);
+      _mm512_storeu_pd(re + i1, n1r);
+      _mm512_storeu_pd(im + i1, n1i);
+    }
+  }
+}
+
+QL_TARGET_AVX512 inline void gatePhaseAVX512(double *re, double *im, size_t dim,
+                                             int target, size_t controlMask,
+                                             double phaseRe, double phaseIm) {
+  if (!gateLanesUsable(target, controlMask, 3)) {
+    gatePhaseScalar(re, im, dim, target, controlMask, phaseRe, phaseIm);
+    return;
+  }
+  const __m512d pr = _mm512_set1_pd(phaseRe), pi = _mm512_set1_pd(phaseIm);
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo += 8) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      __m512d r = _mm512_loadu_pd(re + i1), i = _mm512_loadu_pd(im + i1);
+      _mm512_storeu_pd(re + i1, _mm512_fmsub_pd(r, pr, _mm512_mul_pd(i, pi)));
+      _mm512_storeu_pd(im + i1, _mm512_fmadd_pd(r, pi, _mm512_mul_pd(i, pr)));
+    }
+  }
+}
+
+QL_TARGET_AVX512 inline void gateSwapAVX512(double *re, double *im, size_t dim,
+                                            int target, size_t controlMask) {
+  if (!gateLanesUsable(target, controlMask, 3)) {
+    gateSwapScalar(re, im, dim, target, controlMask);
+    return;
+  }
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo += 8) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      __m512d a0r = _mm512_loadu_pd(re + i0), a0i = _mm512_loadu_pd(im + i0);
+      __m512d a1r = _mm512_loadu_pd(re + i1), a1i = _mm512_loadu_pd(im + i1);
+      _mm512_storeu_pd(re + i0, a1r);
+      _mm512_storeu_pd(im + i0, a1i);
+      _mm512_storeu_pd(re + i1, a0r);
+      _mm512_storeu_pd(im + i1, a0i);
+    }
+  }
+}
+#endif // QL_SIMD_X86
+
+#ifdef QL_SIMD_NEON
+inline void gateMatrixNEON(double *re, double *im, size_t dim, int target,
+                           size_t controlMask, const double *m) {
+  if (!gateLanesUsable(target, controlMask, 1)) {
+    gateMatrixScalar(re, im, dim, target, controlMask, m);
+    return;
+  }
+  const float64x2_t m00r = vdupq_n_f64(m[0]), m00i = vdupq_n_f64(m[1]);
+  const float64x2_t m01r = vdupq_n_f64(m[2]), m01i = vdupq_n_f64(m[3]);
+  const float64x2_t m10r = vdupq_n_f64(m[4]), m10i = vdupq_n_f64(m[5]);
+  const float64x2_t m11r = vdupq_n_f64(m[6]), m11i = vdupq_n_f64(m[7]);
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo += 2) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      float64x2_t a0r = vld1q_f64(re + i0), a0i = vld1q_f64(im + i0);
+      float64x2_t a1r = vld1q_f64(re + i1), a1i = vld1q_f64(im + i1);
+      float64x2_t n0r = vsubq_f64(vmulq_f64(m00r, a0r), vmulq_f64(m00i, a0i));
+      n0r = vfmaq_f64(n0r, m01r, a1r);
+      n0r = vsubq_f64(n0r, vmulq_f64(m01i, a1i));
+      float64x2_t n0i = vfmaq_f64(vmulq_f64(m00i, a0r), m00r, a0i);
+      n0i = vfmaq_f64(n0i, m01r, a1i);
+      n0i = vfmaq_f64(n0i, m01i, a1r);
+      float64x2_t n1r = vsubq_f64(vmulq_f64(m10r, a0r), vmulq_f64(m10i, a0i));
+      n1r = vfmaq_f64(n1r, m11r, a1r);
+      n1r = vsubq_f64(n1r, vmulq_f64(m11i, a1i));
+      float64x2_t n1i = vfmaq_f64(vmulq_f64(m10i, a0r), m10r, a0i);
+      n1i = vfmaq_f64(n1i, m11r, a1i);
+      n1i = vfmaq_f64(n1i, m11i, a1r);
+      vst1q_f64(re + i0, n0r);
+      vst1q_f64(im + i0, n0i);
+      vst1q_f64(re + i1, n1r);
+      vst1q_f64(im + i1, n1i);
+    }
+  }
+}
+
+inline void gatePhaseNEON(double *re, double *im, size_t dim, int target,
+                          size_t controlMask, double phaseRe, double phaseIm) {
+  if (!gateLanesUsable(target, controlMask, 1)) {
+    gatePhaseScalar(re, im, dim, target, controlMask, phaseRe, phaseIm);
+    return;
+  }
+  const float64x2_t pr = vdupq_n_f64(phaseRe), pi = vdupq_n_f64(phaseIm);
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo += 2) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      float64x2_t r = vld1q_f64(re + i1), i = vld1q_f64(im + i1);
+      vst1q_f64(re + i1, vsubq_f64(vmulq_f64(r, pr), vmulq_f64(i, pi)));
+      vst1q_f64(im + i1, vfmaq_f64(vmulq_f64(i, pr), r, pi));
+    }
+  }
+}
+
+inline void gateSwapNEON(double *re, double *im, size_t dim, int target,
+                         size_t controlMask) {
+  if (!gateLanesUsable(target, controlMask, 1)) {
+    gateSwapScalar(re, im, dim, target, controlMask);
+    return;
+  }
+  const size_t stride = size_t(1) << target;
+  for (size_t hi = 0; hi < dim; hi += 2 * stride) {
+    for (size_t lo = 0; lo < stride; lo += 2) {
+      size_t i0 = hi + lo, i1 = i0 + stride;
+      if ((i0 & controlMask) != controlMask)
+        continue;
+      float64x2_t a0r = vld1q_f64(re + i0), a0i = vld1q_f64(im + i0);
+      float64x2_t a1r = vld1q_f64(re + i1), a1i = vld1q_f64(im + i1);
+      vst1q_f64(re + i0, a1r);
+      vst1q_f64(im + i0, a1i);
+      vst1q_f64(re + i1, a0r);
+      vst1q_f64(im + i1, a0i);
+    }
+  }
+}
+#endif // QL_SIMD_NEON
+
+struct GateKernels {
+  GateMatrixFn matrix;
+  GatePhaseFn phase;
+  GateSwapFn swap;
+};
+
+inline GateKernels gateKernelsFor(SimdLevel level) {
+  switch (level) {
+#ifdef QL_SIMD_X86
+  case SimdLevel::AVX2:
+    return {gateMatrixAVX2, gatePhaseAVX2, gateSwapAVX2};
+  case SimdLevel::AVX512:
+    return {gateMatrixAVX512, gatePhaseAVX512, gateSwapAVX512};
+#endif
+#ifdef QL_SIMD_NEON
+  case SimdLevel::NEON:
+    return {gateMatrixNEON, gatePhaseNEON, gateSwapNEON};
+#endif
+  default:
+    return {gateMatrixScalar, gatePhaseScalar, gateSwapScalar};
+  }
+}
+
+#endif // SIMD_KERNELS_HPP
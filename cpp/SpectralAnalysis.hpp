@@ -0,0 +1,202 @@
+#ifndef SPECTRAL_ANALYSIS_HPP
+#define SPECTRAL_ANALYSIS_HPP
+
+// Streaming power spectrum of a pattern's sample sequence (Welch's method).
+// Samples are cut into windows of N that overlap by half. Each window has
+// its mean removed, is multiplied by a Hann window and goes through the
+// library FFT, and |X_k|^2 is added to N/2 + 1 power bins. Only the window
+// being filled, the bins and the samples of the chunk in flight are kept.
+// add() just stores a sample; the windows are transformed by flush() at the
+// end of the chunk, so no FFT runs between two measurements (one every N/2
+// samples would put a line on bin 2 and its harmonics). Frequencies are in
+// cycles per sample; with a sample rate (samples per second) they convert
+// to Hz.
+
+#ifndef _USE_MATH_DEFINES
+#define _USE_MATH_DEFINES
+#endif
+#include <cmath>
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "QuantumLib.hpp"
+
+constexpr int SPECTRUM_DEFAULT_WINDOW = 4096;
+
+struct SpectralPeak {
+  int bin = 0;
+  double cyclesPerSample = 0.0;
+  double density = 0.0;
+  double ratioDb = 0.0; // Above the median density (noise floor)
+};
+
+class SpectralAccumulator {
+  int n_ = 0; // Window length; 0 = disabled
+  std::vector<double> window_; // Hann coefficients
+  double windowPower_ = 0.0;   // Sum of squared coefficients
+  std::vector<double> buffer_; // Window being filled
+  int fill_ = 0;
+  std::vector<int> pending_; // Samples of the chunk in flight
+  size_t pendingCount_ = 0;
+  std::vector<double> re_, im_;
+  std::vector<double> power_; // Sum of |X_k|^2 over windows, k = 0..N/2
+  uint64_t windows_ = 0;
+
+  void processWindow() {
+    double mean = 0.0;
+    for (int i = 0; i < n_; i++)
+      mean += buffer_[i];
+    mean /= n_;
+    for (int i = 0; i < n_; i++) {
+      re_[i] = (buffer_[i] - mean) * window_[i];
+      im_[i] = 0.0;
+    }
+    getFFTPlan(n_).execute(re_.data(), im_.data());
+    for (int k = 0; k <= n_ / 2; k++)
+      power_[k] += re_[k] * re_[k] + im_[k] * im_[k];
+    windows_++;
+
+    // Keep the second half as the start of the next window
+    int hop = n_ / 2;
+    std::copy(buffer_.begin() + hop, buffer_.end(), buffer_.begin());
+    fill_ = n_ - hop;
+  }
+
+public:
+  // windowSize: a power of two >= 16, or 0 to disable
+  explicit SpectralAccumulator(int windowSize = 0) {
+    if (windowSize < 16 || (windowSize & (windowSize - 1)) != 0)
+      return;
+    n_ = windowSize;
+    window_.resize(n_);
+    for (int i = 0; i < n_; i++) {
+      window_[i] = 0.5 - 0.5 * std::cos(2.0 * M_PI * i / n_);
+      windowPower_ += window_[i] * window_[i];
+    }
+    buffer_.resize(n_);
+    re_.resize(n_);
+    im_.resize(n_);
+    power_.assign(n_ / 2 + 1, 0.0);
+  }
+
+  bool enabled() const { return n_ > 0; }
+  int windowSize() const { return n_; }
+  uint64_t windows() const { return windows_; }
+  int bins() const { return enabled() ? n_ / 2 + 1 : 0; }
+
+  // Room for `count` samples, written up front so that add() neither
+  // allocates nor page-faults while measuring
+  void beginChunk(size_t count) {
+    if (n_ > 0)
+      pending_.assign(count, 0);
+    pendingCount_ = 0;
+  }
+
+  void add(int value) {
+    if (n_ == 0)
+      return;
+    if (pendingCount_ < pending_.size())
+      pending_[pendingCount_] = value;
+    else
+      pending_.push_back(value);
+    pendingCount_++;
+  }
+
+  // Run the stored samples through the windows and release the chunk
+  // buffer; called between chunks, after the last measurement
+  void flush() {
+    for (size_t i = 0; i < pendingCount_; i++) {
+      buffer_[fill_++] = pending_[i];
+      if (fill_ == n_)
+        processWindow();
+    }
+    pendingCount_ = 0;
+    std::vector<int>().swap(pending_);
+  }
+
+  // One-sided power spectral density of bin k, in (ops)^2 per
+  // (cycle/sample); summed over the bins it gives the sample variance
+  // (less the part inside each window's mean)
+  double density(int k) const {
+    if (windows_ == 0 || k < 0 || k > n_ / 2)
+      return 0.0;
+    double scale = (k == 0 || k == n_ / 2) ? 1.0 : 2.0;
+    return scale * power_[k] /
+           (static_cast<double>(windows_) * windowPower_);
+  }
+
+  double frequency(int k) const {
+    return n_ ? static_cast<double>(k) / n_ : 0.0;
+  }
+
+  // Checkpoint state (Checkpoint.hpp): window length, the window being
+  // filled and the summed power. Taken after flush().
+  template <typename Writer> void saveState(Writer &w) const {
+    w.put(n_);
+    w.put(fill_);
+    w.put(windows_);
+    w.putVector(buffer_);
+    w.putVector(power_);
+  }
+
+  template <typename Reader> bool loadState(Reader &r) {
+    *this = SpectralAccumulator(r.template get<int>());
+    int fill = r.template get<int>();
+    uint64_t windows = r.template get<uint64_t>();
+    std::vector<double> buffer = r.template getVector<double>();
+    std::vector<double> power = r.template getVector<double>();
+    if (!r.ok() || buffer.size() != buffer_.size() ||
+        power.size() != power_.size() || fill < 0 ||
+        fill > std::max(n_ - 1, 0))
+      return false;
+    fill_ = fill;
+    windows_ = windows;
+    buffer_ = buffer;
+    power_ = power;
+    return true;
+  }
+
+  // Local maxima above the noise floor, strongest first. Bins 0 and 1
+  // (the window's mean and its leakage) are skipped.
+  std::vector<SpectralPeak> peaks(size_t k, double minRatioDb = 6.0) const {
+    std::vector<SpectralPeak> found;
+    int last = n_ / 2;
+    if (windows_ == 0 || last < 4)
+      return found;
+    std::vector<double> d(last + 1);
+    for (int b = 0; b <= last; b++)
+      d[b] = density(b);
+    std::vector<double> sorted(d.begin() + 2, d.end());
+    std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2,
+                     sorted.end());
+    double floor = sorted[sorted.size() / 2];
+    if (floor <= 0.0)
+      return found;
+
+    for (int b = 2; b < last; b++) {
+      if (d[b] <= d[b - 1] || d[b] < d[b + 1])
+        continue;
+      double ratioDb = 10.0 * std::log10(d[b] / floor);
+      if (ratioDb < minRatioDb)
+        continue;
+      SpectralPeak p;
+      p.bin = b;
+      p.cyclesPerSample = frequency(b);
+      p.density = d[b];
+      p.ratioDb = ratioDb;
+      found.push_back(p);
+    }
+    size_t n = std::min(k, found.size());
+    std::partial_sort(found.begin(), found.begin() + n, found.end(),
+                      [](const SpectralPeak &a, const SpectralPeak &b) {
+                        return a.ratioDb > b.ratioDb;
+                      });
+    found.resize(n);
+    return found;
+  }
+};
+
+#endif // SPECTRAL_ANALYSIS_HPP
@@ -0,0 +1,563 @@
+#ifndef TSC_CALIBRATION_HPP
+#define TSC_CALIBRATION_HPP
+
+// Timer-frequency calibration with a persistent per-host cache.
+// The cycle counter (TSC on x86, the generic timer on ARM64) is checked for
+// invariance and compared with what the CPU and kernel report; its rate is
+// measured from several samples against CLOCK_MONOTONIC_RAW with a 95%
+// confidence interval. The result is cached per host and CPU model so later
+// runs start instantly; a cached value is re-validated with a short
+// measurement after a reboot or when it is older than the configured age.
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "QuantumLib.hpp"
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+#endif
+
+// ========== Timer Source Detection ==========
+
+// What the platform says about the cycle counter
+struct TimerSourceInfo {
+  std::string hostName;
+  std::string cpuModel;
+  std::string clocksource; // Linux current_clocksource ("" if unknown)
+  std::string bootId;      // Linux boot_id ("" elsewhere)
+  bool invariantKnown = false;
+  bool invariant = false;  // Constant rate across P-/C-states
+  uint64_t nominalHz = 0;  // Rate reported by CPU or kernel, 0 if unknown
+  std::string nominalSource;
+};
+
+inline std::string readFirstLine(const std::string &path) {
+  std::ifstream in(path);
+  std::string line;
+  if (in)
+    std::getline(in, line);
+  return line;
+}
+
+inline std::string trimString(const std::string &s) {
+  size_t b = s.find_first_not_of(" \t\r\n");
+  if (b == std::string::npos)
+    return "";
+  size_t e = s.find_last_not_of(" \t\r\n");
+  return s.substr(b, e - b + 1);
+}
+
+inline TimerSourceInfo detectTimerSource() {
+  TimerSourceInfo info;
+
+#ifdef _WIN32
+  char host[256];
+  DWORD hostLen = sizeof(host);
+  if (GetComputerNameA(host, &hostLen))
+    info.hostName = host;
+#else
+  char host[256] = {0};
+  if (gethostname(host, sizeof(host) - 1) == 0)
+    info.hostName = host;
+#endif
+
+#ifdef QL_SIMD_X86
+  uint32_t r[4];
+  cpuidCount(0x80000000u, 0, r);
+  uint32_t maxExt = r[0];
+  if (maxExt >= 0x80000004u) {
+    char brand[49] = {0};
+    for (uint32_t i = 0; i < 3; i++) {
+      cpuidCount(0x80000002u + i, 0, r);
+      std::memcpy(brand + 16 * i, r, 16);
+    }
+    info.cpuModel = trimString(brand);
+  }
+  if (maxExt >= 0x80000007u) {
+    cpuidCount(0x80000007u, 0, r);
+    info.invariantKnown = true;
+    info.invariant = (r[3] >> 8) & 1;
+  }
+
+  cpuidCount(0, 0, r);
+  uint32_t maxLeaf = r[0];
+  if (maxLeaf >= 0x15) {
+    // TSC = crystal * EBX / EAX
+    cpuidCount(0x15, 0, r);
+    if (r[0] && r[1] && r[2]) {
+      info.nominalHz = static_cast<uint64_t>(r[2]) * r[1] / r[0];
+      info.nominalSource = "CPUID 15h";
+    }
+  }
+  if (!info.nominalHz && maxLeaf >= 0x16) {
+    // Processor base frequency in MHz; equals the TSC rate on most parts
+    cpuidCount(0x16, 0, r);
+    if (r[0]) {
+      info.nominalHz = static_cast<uint64_t>(r[0]) * 1000000ULL;
+      info.nominalSource = "CPUID 16h base clock";
+    }
+  }
+#elif defined(QL_SIMD_NEON) && !defined(_MSC_VER)
+  // The generic timer runs at a fixed architectural rate
+  uint64_t cntfrq;
+  __asm__ __volatile__("mrs %0, cntfrq_el0" : "=r"(cntfrq));
+  info.invariantKnown = true;
+  info.invariant = true;
+  info.nominalHz = cntfrq;
+  info.nominalSource = "CNTFRQ_EL0";
+#endif
+
+#ifdef __linux__
+  info.clocksource = readFirstLine(
+      "/sys/devices/system/clocksource/clocksource0/current_clocksource");
+  info.bootId = readFirstLine("/proc/sys/kernel/random/boot_id");
+  // Present on kernels that export their own TSC calibration
+  std::string tscKhz =
+      readFirstLine("/sys/devices/system/cpu/cpu0/tsc_freq_khz");
+  if (!tscKhz.empty()) {
+    info.nominalHz = std::strtoull(tscKhz.c_str(), nullptr, 10) * 1000ULL;
+    info.nominalSource = "kernel tsc_freq_khz";
+  }
+  if (info.cpuModel.empty()) {
+    std::ifstream cpuinfo("/proc/cpuinfo");
+    std::string line;
+    while (std::getline(cpuinfo, line)) {
+      if (line.compare(0, 10, "model name") == 0 ||
+          line.compare(0, 8, "CPU part") == 0) {
+        info.cpuModel = trimString(line.substr(line.find(':') + 1));
+        break;
+      }
+    }
+  }
+#elif defined(__APPLE__)
+  char brand[256] = {0};
+  size_t brandLen = sizeof(brand) - 1;
+  if (sysctlbyname("machdep.cpu.brand_string", brand, &brandLen, nullptr,
+                   0) == 0)
+    info.cpuModel = brand;
+#endif
+
+  if (info.cpuModel.empty())
+    info.cpuModel = "unknown";
+  return info;
+}
+
+// ========== Frequency Measurement ==========
+
+struct FrequencyEstimate {
+  uint64_t hz = 0;
+  double ciHz = 0.0; // 95% confidence half-width
+  int samples = 0;
+};
+
+// Nanoseconds on a clock that is not slewed by NTP
+inline int64_t rawClockNanos() {
+#ifdef __linux__
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+// Read the counter and the raw clock at (nearly) the same instant: the
+// counter read is bracketed by two clock reads and the tightest of a few
+// tries wins, so the pairing error is a fraction of one clock read.
+inline void pairedTimerRead(int64_t &nanos, uint64_t &cycles) {
+  int64_t bestWindow = INT64_MAX;
+  for (int i = 0; i < 8; i++) {
+    int64_t t0 = rawClockNanos();
+    uint64_t c = cycleStart();
+    int64_t t1 = rawClockNanos();
+    if (t1 - t0 < bestWindow) {
+      bestWindow = t1 - t0;
+      nanos = t0 + (t1 - t0) / 2;
+      cycles = c;
+    }
+  }
+}
+
+// Two-sided 95% Student t quantile for n - 1 degrees of freedom
+inline double studentT95(int n) {
+  static const double table[] = {0,     12.706, 4.303, 3.182, 2.776, 2.571,
+                                 2.447, 2.365,  2.306, 2.262, 2.228, 2.201,
+                                 2.179, 2.160,  2.145, 2.131, 2.120, 2.110,
+                                 2.101, 2.093,  2.086};
+  int df = n - 1;
+  if (df < 1)
+    return 0.0;
+  return df <= 20 ? table[df] : 1.96;
+}
+
+// `samples` independent rate measurements of `sampleMs` each
+inline FrequencyEstimate measureTimerFrequency(int samples = 8,
+                                               int sampleMs = 50) {
+  std::vector<double> rates;
+  for (int s = 0; s < samples; s++) {
+    int64_t n0 = 0, n1 = 0;
+    uint64_t c0 = 0, c1 = 0;
+    pairedTimerRead(n0, c0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(sampleMs));
+    pairedTimerRead(n1, c1);
+    if (n1 > n0)
+      rates.push_back(static_cast<double>(c1 - c0) * 1e9 / (n1 - n0));
+  }
+
+  FrequencyEstimate est;
+  est.samples = static_cast<int>(rates.size());
+  if (rates.empty())
+    return est;
+  double mean = 0.0;
+  for (double r : rates)
+    mean += r;
+  mean /= rates.size();
+  double var = 0.0;
+  for (double r : rates)
+    var += (r - mean) * (r - mean);
+  if (rates.size() > 1)
+    var /= rates.size() - 1;
+  est.hz = static_cast<uint64_t>(std::llround(mean));
+  est.ciHz = studentT95(est.samples) * std::sqrt(var / rates.size());
+  return est;
+}
+
+// ========== Calibration Cache ==========
+
+// Flat key=value file, one per host. Other subsystems may store their own
+// keys next to the calibration; unknown keys are preserved on save.
+class CalibrationCache {
+  std::map<std::string, std::string> values_;
+
+public:
+  bool load(const std::string &path) {
+    values_.clear();
+    std::ifstream in(path);
+    if (!in)
+      return false;
+    std::string line;
+    while (std::getline(in, line)) {
+      size_t eq = line.find('=');
+      if (eq == std::string::npos || line[0] == '#')
+        continue;
+      values_[line.substr(0, eq)] = line.substr(eq + 1);
+    }
+    return true;
+  }
+
+  // Written to a temporary file named after the process, so two runs on
+  // the same host do not share it, then renamed over the old cache, so
+  // there is always a complete cache on disk
+  bool save(const std::string &path) const {
+#ifdef _WIN32
+    std::string tmp =
+        path + ".tmp." + std::to_string(GetCurrentProcessId());
+#else
+    std::string tmp = path + ".tmp." + std::to_string(getpid());
+#endif
+    {
+      std::ofstream out(tmp, std::ios::trunc);
+      if (!out)
+        return false;
+      out << "# Chronos-Resonance calibration cache\n";
+      for (const auto &kv : values_)
+        out << kv.first << "=" << kv.second << "\n";
+      out.flush();
+      if (!out) {
+        out.close();
+        std::remove(tmp.c_str());
+        return false;
+      }
+    }
+#ifdef _WIN32
+    bool replaced = MoveFileExA(tmp.c_str(), path.c_str(),
+                                MOVEFILE_REPLACE_EXISTING |
+                                    MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    bool replaced = std::rename(tmp.c_str(), path.c_str()) == 0;
+#endif
+    if (!replaced)
+      std::remove(tmp.c_str());
+    return replaced;
+  }
+
+  bool has(const std::string &key) const { return values_.count(key) > 0; }
+
+  std::string get(const std::string &key) const {
+    auto it = values_.find(key);
+    return it == values_.end() ? std::string() : it->second;
+  }
+
+  void set(const std::string &key, const std::string &value) {
+    values_[key] = value;
+  }
+
+  void eraseWithPrefix(const std::string &prefix) {
+    auto it = values_.lower_bound(prefix);
+    while (it != values_.end() && it->first.compare(0, prefix.size(),
+                                                    prefix) == 0)
+      it = values_.erase(it);
+  }
+
+  void clear() { values_.clear(); }
+};
+
+inline std::string sanitizeFileName(const std::string &s) {
+  std::string out;
+  for (char c : s)
+    out += (std::isalnum(static_cast<unsigned char>(c)) || c == '-' ||
+            c == '_')
+               ? c
+               : '_';
+  return out.empty() ? "host" : out;
+}
+
+inline bool makeDirectory(const std::string &dir) {
+#ifdef _WIN32
+  return _mkdir(dir.c_str()) == 0 || errno == EEXIST;
+#else
+  return mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+// $XDG_CACHE_HOME/chronos-resonance/calibration-<host>.txt, falling back to
+// ~/.cache (or %LOCALAPPDATA% on Windows). Creates the directory.
+inline std::string defaultCalibrationCachePath(const std::string &host) {
+  std::string base;
+#ifdef _WIN32
+  if (const char *local = std::getenv("LOCALAPPDATA"))
+    base = local;
+#else
+  if (const char *xdg = std::getenv("XDG_CACHE_HOME")) {
+    base = xdg;
+  } else if (const char *home = std::getenv("HOME")) {
+    base = std::string(home) + "/.cache";
+    makeDirectory(base);
+  }
+#endif
+  if (base.empty())
+    return "";
+  std::string dir = base + "/chronos-resonance";
+  if (!makeDirectory(dir))
+    return "";
+  return dir + "/calibration-" + sanitizeFileName(host) + ".txt";
+}
+
+// ========== Cached Calibration ==========
+
+struct CalibrationOptions {
+  std::string cachePath; // Empty = defaultCalibrationCachePath()
+  bool useCache = true;
+  bool recalibrate = false; // Measure even if the cache is fresh
+  int maxAgeHours = 24 * 7; // Older entries are re-validated
+  int samples = 8;
+  int sampleMs = 50;
+};
+
+struct CalibrationReport {
+  TimerSourceInfo source;
+  FrequencyEstimate estimate;
+  std::string status; // "cached", "cached, re-validated" or "measured"
+  std::string cachePath;
+  std::vector<std::string> warnings;
+};
+
+// Cached numbers must parse completely; a truncated or edited cache is not
+// trusted
+inline bool parseCachedNumber(const std::string &text, uint64_t &value) {
+  if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0])))
+    return false;
+  char *end = nullptr;
+  errno = 0;
+  unsigned long long v = std::strtoull(text.c_str(), &end, 10);
+  if (*end != '\0' || errno == ERANGE)
+    return false;
+  value = v;
+  return true;
+}
+
+inline bool parseCachedNumber(const std::string &text, double &value) {
+  if (text.empty())
+    return false;
+  char *end = nullptr;
+  errno = 0;
+  double v = std::strtod(text.c_str(), &end);
+  if (*end != '\0' || errno == ERANGE || !std::isfinite(v) || v < 0.0)
+    return false;
+  value = v;
+  return true;
+}
+
+// Calibrate the cycle counter, using and refreshing the per-host cache.
+// Problems (non-invariant counter, disagreement with the reported rate,
+// wide confidence interval, implausible result) end up in report.warnings.
+inline CalibrationData calibrateCPUCached(const CalibrationOptions &options,
+                                          CalibrationReport &report) {
+  report = CalibrationReport();
+  report.source = detectTimerSource();
+  const TimerSourceInfo &src = report.source;
+
+  report.cachePath = options.cachePath;
+  if (options.useCache && report.cachePath.empty())
+    report.cachePath = defaultCalibrationCachePath(src.hostName);
+
+  CalibrationCache cache;
+  bool haveCache = options.useCache && !report.cachePath.empty() &&
+                   cache.load(report.cachePath) &&
+                   cache.get("host") == src.hostName &&
+                   cache.get("cpu_model") == src.cpuModel &&
+                   !cache.get("freq_hz").empty();
+  if (!haveCache)
+    cache.clear();
+
+  const int64_t now = static_cast<int64_t>(std::time(nullptr));
+  FrequencyEstimate &est = report.estimate;
+  if (haveCache && !options.recalibrate) {
+    FrequencyEstimate cached;
+    uint64_t samples = 0, created = 0;
+    bool valid = parseCachedNumber(cache.get("freq_hz"), cached.hz) &&
+                 cached.hz >= MIN_PLAUSIBLE_TIMER_HZ &&
+                 parseCachedNumber(cache.get("freq_ci_hz"), cached.ciHz) &&
+                 parseCachedNumber(cache.get("samples"), samples) &&
+                 parseCachedNumber(cache.get("created"), created);
+    cached.samples = static_cast<int>(std::min<uint64_t>(samples, 1000000));
+    int64_t age = now - static_cast<int64_t>(created);
+    bool sameBoot = cache.get("boot_id") == src.bootId;
+
+    if (!valid) {
+      // Measured below; drop the bad rate so it is never saved again
+      report.warnings.push_back("calibration cache " + report.cachePath +
+                                " has an unreadable or implausible rate; "
+                                "measuring again");
+      cache.eraseWithPrefix("freq_");
+    } else if (sameBoot && age >= 0 &&
+               age < options.maxAgeHours * 3600LL) {
+      est = cached;
+      report.status = "cached";
+    } else {
+      // Stale: one short measurement must agree with the cached rate
+      FrequencyEstimate quick = measureTimerFrequency(2, options.sampleMs);
+      double tolerance = std::max(3.0 * (cached.ciHz + quick.ciHz),
+                                  2e-4 * static_cast<double>(cached.hz));
+      if (std::fabs(static_cast<double>(quick.hz) -
+                    static_cast<double>(cached.hz)) <= tolerance) {
+        est = cached;
+        report.status = "cached, re-validated";
+      }
+    }
+  }
+
+  if (report.status.empty()) {
+    est = measureTimerFrequency(options.samples, options.sampleMs);
+    report.status = "measured";
+
+    if (est.hz < MIN_PLAUSIBLE_TIMER_HZ) {
+      report.warnings.push_back(
+          "measured counter rate " + std::to_string(est.hz) +
+          " Hz is implausible; FALLING BACK TO 2.4 GHz. All tick targets "
+          "are likely wrong.");
+      est.hz = 2400000000ULL;
+      est.ciHz = 0.0;
+    } else {
+      cache.set("host", src.hostName);
+      cache.set("cpu_model", src.cpuModel);
+      cache.set("freq_hz", std::to_string(est.hz));
+      std::ostringstream ci;
+      ci << std::fixed << std::setprecision(1) << est.ciHz;
+      cache.set("freq_ci_hz", ci.str());
+      cache.set("samples", std::to_string(est.samples));
+    }
+  }
+
+  if (report.status != "cached" && options.useCache &&
+      !report.cachePath.empty() && cache.has("freq_hz")) {
+    cache.set("boot_id", src.bootId);
+    cache.set("created", std::to_string(now));
+    if (!cache.save(report.cachePath))
+      report.warnings.push_back("cannot write calibration cache " +
+                                report.cachePath);
+  }
+
+  if (src.invariantKnown && !src.invariant) {
+    report.warnings.push_back("cycle counter is NOT invariant; its rate "
+                              "follows frequency scaling and sleep states");
+  }
+#ifdef QL_SIMD_X86
+  if (!src.clocksource.empty() && src.clocksource != "tsc") {
+    report.warnings.push_back("kernel clocksource is '" + src.clocksource +
+                              "', not 'tsc'; the kernel does not trust the "
+                              "TSC on this machine");
+  }
+#endif
+  if (src.nominalHz > 0) {
+    double diff = (static_cast<double>(est.hz) -
+                   static_cast<double>(src.nominalHz)) /
+                  static_cast<double>(src.nominalHz);
+    if (std::fabs(diff) > 0.01) {
+      std::ostringstream msg;
+      msg << "measured rate differs from " << src.nominalSource << " ("
+          << std::fixed << std::setprecision(3) << src.nominalHz / 1e9
+          << " GHz) by " << std::setprecision(2) << diff * 100.0 << "%";
+      report.warnings.push_back(msg.str());
+    }
+  }
+  if (est.hz > 0 && est.ciHz > 1e-3 * static_cast<double>(est.hz)) {
+    report.warnings.push_back("wide confidence interval; the system is "
+                              "noisy, consider --recalibrate on an idle "
+                              "machine");
+  }
+
+  CalibrationData cal = calibrationFromFrequency(est.hz);
+  cal.cpu_freq_ci_hz = est.ciHz;
+  return cal;
+}
+
+inline void printCalibrationReport(const CalibrationReport &report) {
+  const TimerSourceInfo &src = report.source;
+  std::cout << "CPU: " << src.cpuModel << "\n";
+  std::cout << "Counter: "
+            << (!src.invariantKnown ? "invariance unknown"
+                : src.invariant     ? "invariant"
+                                    : "NOT invariant");
+  if (!src.clocksource.empty())
+    std::cout << ", kernel clocksource " << src.clocksource;
+  if (src.nominalHz > 0)
+    std::cout << ", reported " << std::fixed << std::setprecision(3)
+              << src.nominalHz / 1e9 << " GHz (" << src.nominalSource << ")";
+  std::cout << "\n";
+  std::cout << "Calibration: " << report.status;
+  if (report.estimate.samples > 0)
+    std::cout << " (" << report.estimate.samples << " samples)";
+  if (!report.cachePath.empty())
+    std::cout << ", cache " << report.cachePath;
+  std::cout << "\n";
+  for (const auto &w : report.warnings)
+    std::cout << "WARNING: " << w << "\n";
+}
+
+#endif // TSC_CALIBRATION_HPP
@@ -1,22 +1,49 @@
+#include "AdaptiveSampling.hpp"
+#include "AsyncLogger.hpp"
+#include "Checkpoint.hpp"
+#include "CommandLine.hpp"
+#include "LoadTuner.hpp"
+#include "MetricsServer.hpp"
+#include "PatternConfig.hpp"
+#include "PerfCounters.hpp"
 #include "QuantumLib.hpp"
+#include "RunEnvironment.hpp"
+#include "SampleArena.hpp"
+#include "SampleFile.hpp"
+#include "SampleStats.hpp"
+#include "Scheduler.hpp"
+#include "SpectralAnalysis.hpp"
+#include "TscCalibration.hpp"
 #include <algorithm>
+#include <array>
 #include <chrono>
+#include <climits>
 #include <cmath>
+#include <condition_variable>
 #include <ctime>
-#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
 #include <vector>
 
-// Single measurement with configurable FFT load
-int measureSingle(uint64_t tick,
-                  FFTLoadLevel fftLevel = FFTLoadLevel::LOAD_75_PERCENT) {
-  // Baseline
-  uint64_t baseStart = getCycleCount();
+// Optional timing of the loaded phase (FFT + quantum load) of a sample
+struct LoadTiming {
+  uint64_t overhead = 0;   // Timer overhead to subtract (TimerCalibration)
+  uint64_t loadCycles = 0; // Out: cycles spent in the loads, net of overhead
+  PerfCounterSet *perf = nullptr; // Optional: counters around the loads
+  PerfTotals *perfTotals = nullptr;
+};
+
+// Baseline half of a sample: nop iterations in `tick` cycles, then an idle
+// window. Each window opens with a serialized timer read so no earlier work
+// is reordered across its start; the spin loops use the plain counter.
+inline uint64_t measureBaseline(uint64_t tick) {
+  uint64_t baseStart = cycleStart();
   uint64_t baseOps = 0;
   while ((getCycleCount() - baseStart) < tick) {
     baseOps++;
@@ -26,13 +53,32 @@ int measureSingle(uint64_t tick,
   while ((getCycleCount() - idleStart1) < tick) {
     nop();
   }
+  return baseOps;
+}
 
-  // Loaded with FFT
-  uint64_t loadStart = getCycleCount();
-  performFFTLoad(fftLevel);
-  performQuantumLoad();
+// Loaded half: `load` runs the loaded phase (FFT + quantum load), then nop
+// iterations until `tick` cycles after it started, then an idle window.
+// The load-timing instrumentation (stop read, perf counters) runs between
+// the load and the spin; the window is pushed back by its duration so it
+// is not charged to the loaded sample.
+template <typename Load>
+inline uint64_t measureLoaded(uint64_t tick, Load load, LoadTiming *timing) {
+  if (timing && timing->perf)
+    timing->perf->loadBegin();
+  uint64_t loadStart = cycleStart();
+  load();
+  uint64_t windowStart = loadStart;
+  if (timing) {
+    uint64_t loadStop = cycleStop();
+    uint64_t loadCycles = loadStop - loadStart;
+    timing->loadCycles =
+        loadCycles > timing->overhead ? loadCycles - timing->overhead : 0;
+    if (timing->perf)
+      timing->perf->loadEnd(*timing->perfTotals);
+    windowStart += getCycleCount() - loadStop;
+  }
   uint64_t loadOps = 0;
-  while ((getCycleCount() - loadStart) < tick) {
+  while ((getCycleCount() - windowStart) < tick) {
     loadOps++;
     nop();
   }
@@ -40,10 +86,240 @@ int measureSingle(uint64_t tick,
   while ((getCycleCount() - idleStart2) < tick) {
     nop();
   }
+  return loadOps;
+}
 
+// Single measurement with configurable FFT load: baseOps - loadOps.
+// Unpaired (amortized baseline), only the loaded half runs and -loadOps is
+// returned; the caller adds a baseline measured separately.
+template <typename Load>
+int measureSingle(uint64_t tick, Load load, LoadTiming *timing,
+                  bool paired = true) {
+  uint64_t baseOps = paired ? measureBaseline(tick) : 0;
+  uint64_t loadOps = measureLoaded(tick, load, timing);
   return static_cast<int>(baseOps) - static_cast<int>(loadOps);
 }
 
+// measureSingle() around one specialized load kernel (QuantumLib.hpp)
+using MeasureKernelFn = int (*)(uint64_t tick, const LoadKernelArgs &args,
+                                LoadTiming *timing, bool paired);
+
+template <int N, int R, QuantumVariant Q> struct MeasureKernel {
+  static int run(uint64_t tick, const LoadKernelArgs &args,
+                 LoadTiming *timing, bool paired) {
+    return measureSingle(
+        tick, [&] { LoadPhaseKernel<N, R, Q>::run(args); }, timing, paired);
+  }
+};
+
+int measureGeneric(uint64_t tick, const LoadKernelArgs &args,
+                   LoadTiming *timing, bool paired) {
+  return measureSingle(tick, [&] { loadPhaseGeneric(args); }, timing,
+                       paired);
+}
+
+// Picked once per pattern: the specialized kernel for its load shape, or
+// the generic one
+MeasureKernelFn selectMeasureKernel(const LoadSpec &load,
+                                    const QuantumLoadSpec &quantumLoad) {
+  static constexpr std::array<MeasureKernelFn, LOAD_KERNEL_COUNT> table =
+      makeLoadKernelTable<MeasureKernel, MeasureKernelFn>(
+          std::make_index_sequence<LOAD_KERNEL_COUNT>());
+  int index = loadKernelIndex(load.fftSize, load.repeats,
+                              quantumVariantOf(quantumLoad));
+  return index < 0 ? measureGeneric : table[index];
+}
+
+// Measure `iterations` samples, walking the compiled tick array in order
+// from position `start` and starting over at its end. Returns the position
+// after the last sample, so a pattern measured in chunks keeps walking its
+// schedule. The inner loop is a plain array walk: no modulo and no
+// per-sample branch on the pattern kind.
+template <typename Record>
+size_t measureTicks(const std::vector<uint64_t> &ticks, const LoadSpec &load,
+                    const QuantumLoadSpec &quantumLoad, int iterations,
+                    LoadTiming *timing, Record record, size_t start = 0) {
+  const MeasureKernelFn kernel = selectMeasureKernel(load, quantumLoad);
+  const LoadKernelArgs args = makeLoadKernelArgs(load, quantumLoad);
+  const uint64_t *tick = ticks.data();
+  const size_t period = ticks.size();
+  const size_t total = static_cast<size_t>(std::max(iterations, 0));
+  if (period == 0)
+    return 0;
+  size_t k = start % period;
+  for (size_t done = 0; done < total;) {
+    size_t n = std::min(period - k, total - done);
+    for (size_t i = 0; i < n; i++)
+      record(kernel(tick[k + i], args, timing, true));
+    done += n;
+    k += n;
+    if (k == period)
+      k = 0;
+  }
+  return k;
+}
+
+// ========== Amortized Baseline ==========
+// A paired sample spends two of its four tick windows re-measuring the
+// unloaded baseline, which depends only on the tick value. Amortized, the
+// loaded half runs alone and is paired with a baseline drawn from a
+// reservoir of recent baseline windows at the same tick. The reservoirs
+// are refilled in a block of baseline windows before every
+// AMORTIZED_BLOCK loaded samples, interleaved over the pattern's distinct
+// tick values. Each reservoir value is used in turn, so the samples keep
+// the baseline's spread and not just its mean. With a paired check, every
+// block is followed by a few ordinary paired samples, so both see the same
+// drift of the host. A pattern with more than AMORTIZED_MAX_TICKS distinct
+// tick values would spread each block's windows too thin (random from=/to=
+// patterns can have millions), so it is measured paired instead.
+
+constexpr size_t AMORTIZED_BLOCK = 4096;    // Loaded samples per block
+constexpr size_t AMORTIZED_RESERVOIR = 64;  // Baseline windows kept per tick
+constexpr size_t AMORTIZED_BLOCK_WINDOWS = 256; // Baseline windows per block
+constexpr size_t AMORTIZED_CHECK_SAMPLES = 64; // Paired samples per block
+// At least 4 windows per tick and block
+constexpr size_t AMORTIZED_MAX_TICKS = AMORTIZED_BLOCK_WINDOWS / 4;
+// Means within this fraction of each other count as equivalent even when
+// the difference is statistically significant
+constexpr double AMORTIZED_EQUIVALENCE_MARGIN = 0.01;
+
+struct AmortizedStats {
+  uint64_t loadedSamples = 0;
+  uint64_t baselineWindows = 0;
+  size_t distinctTicks = 0;
+};
+
+// Distinct values of `ticks` in ascending order; false as soon as there are
+// more than AMORTIZED_MAX_TICKS of them
+inline bool amortizedTickSlots(const std::vector<uint64_t> &ticks,
+                               std::vector<uint64_t> &distinct) {
+  distinct.clear();
+  for (uint64_t t : ticks) {
+    auto it = std::lower_bound(distinct.begin(), distinct.end(), t);
+    if (it != distinct.end() && *it == t)
+      continue;
+    if (distinct.size() == AMORTIZED_MAX_TICKS)
+      return false;
+    distinct.insert(it, t);
+  }
+  return true;
+}
+
+inline bool amortizable(const std::vector<uint64_t> &ticks) {
+  std::vector<uint64_t> distinct;
+  return amortizedTickSlots(ticks, distinct);
+}
+
+// Scratch of measureTicksAmortized, owned by the caller and reused across
+// calls: the reservoir slot of every position is found once per pattern,
+// and the reservoirs stay filled from one chunk of a pattern to the next.
+// reserve() sizes it for a plan up front, so binding allocates nothing.
+struct AmortizedState {
+  const std::vector<uint64_t> *ticks = nullptr; // Bound pattern
+  bool amortizable = false;
+  std::vector<uint64_t> distinct; // Tick value of each slot
+  std::vector<uint32_t> slotOf;   // Slot of each position
+  std::array<int, AMORTIZED_MAX_TICKS * AMORTIZED_RESERVOIR> reservoir{};
+  std::array<size_t, AMORTIZED_MAX_TICKS> filled{}, writePos{}, readPos{};
+
+  void reserve(size_t maxPeriod) {
+    distinct.reserve(AMORTIZED_MAX_TICKS);
+    slotOf.reserve(maxPeriod);
+  }
+
+  // False if the pattern has too many distinct ticks. Binding the pattern
+  // already bound keeps its reservoirs.
+  bool bind(const std::vector<uint64_t> &pattern) {
+    if (ticks == &pattern)
+      return amortizable;
+    ticks = &pattern;
+    filled.fill(0);
+    writePos.fill(0);
+    readPos.fill(0);
+    amortizable = amortizedTickSlots(pattern, distinct);
+    slotOf.clear();
+    if (amortizable) {
+      for (uint64_t t : pattern)
+        slotOf.push_back(static_cast<uint32_t>(
+            std::lower_bound(distinct.begin(), distinct.end(), t) -
+            distinct.begin()));
+    }
+    return amortizable;
+  }
+};
+
+// Same walk and return value as measureTicks(); patterns with too many
+// distinct ticks go through measureTicks() itself and count no amortized
+// samples or paired checks
+template <typename Record>
+size_t measureTicksAmortized(const std::vector<uint64_t> &ticks,
+                             const LoadSpec &load,
+                             const QuantumLoadSpec &quantumLoad,
+                             int iterations, LoadTiming *timing,
+                             Record record, AmortizedState &state,
+                             AmortizedStats *stats = nullptr,
+                             SampleAccumulator *pairedCheck = nullptr,
+                             size_t start = 0) {
+  if (!state.bind(ticks))
+    return measureTicks(ticks, load, quantumLoad, iterations, timing, record,
+                        start);
+  const MeasureKernelFn kernel = selectMeasureKernel(load, quantumLoad);
+  const LoadKernelArgs args = makeLoadKernelArgs(load, quantumLoad);
+  const size_t period = ticks.size();
+  const size_t total = static_cast<size_t>(std::max(iterations, 0));
+  if (period == 0)
+    return 0;
+
+  const size_t slots = state.distinct.size();
+  const size_t perTick = std::max<size_t>(
+      4, std::min(AMORTIZED_RESERVOIR, AMORTIZED_BLOCK_WINDOWS / slots));
+  int *reservoir = state.reservoir.data();
+  size_t *filled = state.filled.data();
+  size_t *writePos = state.writePos.data();
+  size_t *readPos = state.readPos.data();
+  const uint64_t *distinct = state.distinct.data();
+  const uint64_t *tick = ticks.data();
+  const uint32_t *slot = state.slotOf.data();
+  size_t k = start % period, checkK = k;
+  for (size_t done = 0; done < total;) {
+    for (size_t w = 0; w < perTick; w++) {
+      for (size_t s = 0; s < slots; s++) {
+        reservoir[s * AMORTIZED_RESERVOIR + writePos[s]] =
+            static_cast<int>(measureBaseline(distinct[s]));
+        writePos[s] = (writePos[s] + 1) % AMORTIZED_RESERVOIR;
+        filled[s] = std::min(filled[s] + 1, AMORTIZED_RESERVOIR);
+      }
+    }
+    if (stats)
+      stats->baselineWindows += perTick * slots;
+
+    size_t n = std::min(AMORTIZED_BLOCK, total - done);
+    for (size_t i = 0; i < n; i++) {
+      size_t s = slot[k];
+      int base = reservoir[s * AMORTIZED_RESERVOIR + readPos[s]];
+      if (++readPos[s] == filled[s])
+        readPos[s] = 0;
+      record(base + kernel(tick[k], args, timing, false));
+      if (++k == period)
+        k = 0;
+    }
+    done += n;
+
+    for (size_t i = 0; pairedCheck && i < AMORTIZED_CHECK_SAMPLES; i++) {
+      pairedCheck->add(kernel(tick[checkK], args, nullptr, true));
+      if (++checkK == period)
+        checkK = 0;
+    }
+  }
+  if (stats) {
+    stats->loadedSamples += total;
+    stats->distinctTicks = slots;
+  }
+  return k;
+}
+
+// ========== End of Amortized Baseline ==========
+
 // Quick stats for scheduled mode
 struct QuickStats {
   double avg;
@@ -52,90 +328,344 @@ struct QuickStats {
   double peakPercent;
 };
 
-QuickStats quickAnalyze(const std::vector<int> &data) {
-  double sum = 0;
-  for (int v : data)
-    sum += v;
-  double avg = sum / data.size();
+QuickStats quickAnalyze(const SampleAccumulator &acc) {
+  auto peak = std::max_element(acc.bins.begin(), acc.bins.end());
+  int peakBin = *peak ? static_cast<int>(peak - acc.bins.begin() -
+                                         HISTOGRAM_OFFSET) *
+                            HISTOGRAM_BIN_WIDTH
+                      : 0;
+  double peakPercent = acc.count ? (double)*peak / acc.count * 100.0 : 0.0;
 
-  double variance = 0;
-  for (int v : data) {
-    variance += (v - avg) * (v - avg);
-  }
-  variance /= data.size();
-  double stdDev = sqrt(variance);
+  return {acc.mean, acc.stdDev(), peakBin, peakPercent};
+}
 
-  // Find peak bin
-  std::map<int, int> histogram;
-  for (int value : data) {
-    int bin = (value / 20) * 20;
-    histogram[bin]++;
+// Reduces into `scratch`, so the scan loop does not allocate
+QuickStats quickAnalyze(const int *data, size_t n,
+                        SampleAccumulator &scratch) {
+  computeSampleStats(data, n, scratch);
+  return quickAnalyze(scratch);
+}
+
+// Percentiles printed when the samples themselves are available
+const std::vector<double> REPORT_PERCENTILES = {50.0, 90.0, 99.0, 99.9};
+
+// Counter lines printed under a pattern's analysis (--perf)
+void analyzePerf(const PerfTotals &perf, uint64_t samples) {
+  if (perf.loadPhaseValid && perf.loadSamples > 0) {
+    std::cout << "  Perf (loaded phase, per sample):";
+    for (int id = 0; id < PERF_HARDWARE_COUNT; id++) {
+      if (perf.available[id])
+        std::cout << " " << perfCounterName(id) << " " << std::setprecision(1)
+                  << (double)perf.loadPhase[id] / perf.loadSamples;
+    }
+    if (perf.available[PERF_CYCLES] && perf.loadPhase[PERF_CYCLES] > 0)
+      std::cout << ", IPC " << std::setprecision(2)
+                << (double)perf.loadPhase[PERF_INSTRUCTIONS] /
+                       perf.loadPhase[PERF_CYCLES];
+    std::cout << "\n";
+  }
+  bool any = false;
+  for (int id = 0; id < PERF_COUNTER_COUNT; id++)
+    any = any || perf.available[id];
+  if (!any)
+    return;
+  bool scaled = false;
+  std::cout << "  Perf (whole pattern, per sample):";
+  for (int id = 0; id < PERF_COUNTER_COUNT; id++) {
+    if (!perf.available[id])
+      continue;
+    std::cout << " " << perfCounterName(id) << " " << std::setprecision(3)
+              << (double)perf.pattern[id] / std::max<uint64_t>(samples, 1)
+              << (perf.scaled[id] ? "*" : "");
+    scaled = scaled || perf.scaled[id];
   }
+  std::cout << std::setprecision(2) << "\n";
+  if (scaled)
+    std::cout << "  (* multiplexed: scaled by time enabled / time running)\n";
+}
 
-  std::vector<std::pair<int, int>> sorted(histogram.begin(), histogram.end());
-  std::sort(sorted.begin(), sorted.end(),
-            [](const auto &a, const auto &b) { return a.second > b.second; });
+// "1.23 kHz" / "456.7 Hz", or cycles per sample without a sample rate
+std::string formatSpectralFrequency(double cyclesPerSample,
+                                    double sampleRateHz) {
+  char buf[48];
+  double hz = cyclesPerSample * sampleRateHz;
+  if (sampleRateHz <= 0.0)
+    std::snprintf(buf, sizeof(buf), "%.5f /sample", cyclesPerSample);
+  else if (hz >= 1000.0)
+    std::snprintf(buf, sizeof(buf), "%.2f kHz", hz / 1000.0);
+  else
+    std::snprintf(buf, sizeof(buf), "%.1f Hz", hz);
+  return buf;
+}
 
-  int peakBin = sorted.empty() ? 0 : sorted[0].first;
-  int peakCount = sorted.empty() ? 0 : sorted[0].second;
-  double peakPercent = (double)peakCount / data.size() * 100.0;
+// Spectral peaks printed under a pattern's analysis (--spectrum)
+void analyzeSpectrum(const SpectralAccumulator &spectrum,
+                     double sampleRateHz) {
+  std::cout << "  Spectrum: " << spectrum.windows() << " windows of "
+            << spectrum.windowSize();
+  if (spectrum.windows() == 0) {
+    std::cout << " (too few samples)\n";
+    return;
+  }
+  std::cout << " ("
+            << formatSpectralFrequency(spectrum.frequency(1), sampleRateHz)
+            << " bins), peaks:";
+  auto peaks = spectrum.peaks(5);
+  if (peaks.empty())
+    std::cout << " none above the noise floor";
+  for (size_t i = 0; i < peaks.size(); i++)
+    std::cout << (i ? ", " : " ")
+              << formatSpectralFrequency(peaks[i].cyclesPerSample,
+                                         sampleRateHz)
+              << " (+" << std::setprecision(1) << peaks[i].ratioDb << " dB)";
+  std::cout << std::setprecision(2) << "\n";
+}
 
-  return {avg, stdDev, peakBin, peakPercent};
+// Amortized-baseline samples against the paired samples interleaved with
+// them: the means are equivalent if their difference is inside its 99%
+// confidence interval or within AMORTIZED_EQUIVALENCE_MARGIN. The spreads
+// should match too if baseline and load are independent.
+struct PairedCheckResult {
+  double diff = 0.0; // Amortized mean minus paired mean
+  double ci = 0.0;   // Half width of its 99% confidence interval
+  bool same = true;
+};
+
+// False when either side has fewer than two samples
+bool comparePairedCheck(const SampleAccumulator &amortized,
+                        const SampleAccumulator &paired,
+                        PairedCheckResult &result) {
+  if (amortized.count < 2 || paired.count < 2)
+    return false;
+  result.diff = amortized.mean - paired.mean;
+  result.ci = 2.576 * std::sqrt(amortized.variance() / amortized.count +
+                                paired.variance() / paired.count);
+  double margin = AMORTIZED_EQUIVALENCE_MARGIN * std::fabs(paired.mean);
+  result.same = std::fabs(result.diff) <= std::max(result.ci, margin);
+  return true;
 }
 
-void analyze(const std::string &name, const std::vector<int> &data) {
-  double sum = 0;
-  for (int v : data)
-    sum += v;
-  double avg = sum / data.size();
+void analyzePairedCheck(const SampleAccumulator &amortized,
+                        const SampleAccumulator &paired) {
+  PairedCheckResult check;
+  if (!comparePairedCheck(amortized, paired, check))
+    return;
+  std::cout << "  Paired Check: " << paired.count << " samples, mean "
+            << paired.mean << " (diff " << std::showpos << check.diff
+            << std::noshowpos << " +/- " << check.ci << " at 99%), std dev "
+            << paired.stdDev() << " -> "
+            << (check.same ? "equivalent" : "DIFFERS") << "\n";
+}
 
-  double variance = 0;
-  for (int v : data) {
-    variance += (v - avg) * (v - avg);
-  }
-  variance /= data.size();
-  double stdDev = sqrt(variance);
+// Adaptive sampling outcome of a pattern (--adaptive)
+void analyzeAdaptive(const AdaptiveJobState &state) {
+  const PrecisionEstimate &e = state.estimate;
+  std::cout << "  Adaptive: " << state.done << " samples, "
+            << adaptiveStatusName(state.status) << " (mean +/- "
+            << std::fixed << std::setprecision(2) << e.meanHalfWidth
+            << ", peak share +/- " << e.peakHalfWidth
+            << " points, design effect " << e.designEffect << ")\n";
+}
 
-  int minVal = *std::min_element(data.begin(), data.end());
-  int maxVal = *std::max_element(data.begin(), data.end());
+// Optional sections of a pattern's analysis
+struct AnalysisExtras {
+  const SampleAccumulator *loadPhase = nullptr; // From LoadTiming
+  uint64_t cpuFreqHz = 0;                       // Load phase in us
+  const PerfTotals *perf = nullptr;             // From PerfCounterSet
+  const std::vector<int> *percentiles = nullptr; // At REPORT_PERCENTILES
+  const SpectralAccumulator *spectrum = nullptr; // Of the sample sequence
+  double sampleRateHz = 0.0;                     // Spectrum frequency axis
+  const SampleAccumulator *pairedCheck = nullptr; // Amortized baseline only
+  bool pairedFallback = false; // Amortized asked for, too many ticks
+  const AdaptiveJobState *adaptive = nullptr;      // Adaptive sampling only
+};
 
+void analyze(const std::string &name, const SampleAccumulator &acc,
+             const AnalysisExtras &extras = AnalysisExtras()) {
+  const SampleAccumulator *loadPhase = extras.loadPhase;
+  const std::vector<int> *percentiles = extras.percentiles;
   std::cout << name << ":\n";
-  std::cout << "  Average: " << std::fixed << std::setprecision(2) << avg
+  std::cout << "  Average: " << std::fixed << std::setprecision(2) << acc.mean
             << "\n";
-  std::cout << "  Std Dev: " << stdDev << "\n";
-  std::cout << "  Range: [" << minVal << ", " << maxVal << "]\n";
-
-  // Histogram (bins of 20)
-  std::map<int, int> histogram;
-  for (int value : data) {
-    int bin = (value / 20) * 20;
-    histogram[bin]++;
+  std::cout << "  Std Dev: " << acc.stdDev() << "\n";
+  std::cout << "  Range: [" << acc.minVal << ", " << acc.maxVal << "]\n";
+  if (percentiles && percentiles->size() == REPORT_PERCENTILES.size()) {
+    std::cout << "  Percentiles:";
+    for (size_t i = 0; i < percentiles->size(); i++)
+      std::cout << (i ? ", p" : " p") << std::setprecision(3)
+                << std::defaultfloat << REPORT_PERCENTILES[i] << " "
+                << (*percentiles)[i];
+    std::cout << std::fixed << std::setprecision(2) << "\n";
   }
 
   std::cout << "  Histogram (Top 10 bins):\n";
-  std::vector<std::pair<int, int>> sorted(histogram.begin(), histogram.end());
-  std::sort(sorted.begin(), sorted.end(),
-            [](const auto &a, const auto &b) { return a.second > b.second; });
-
-  for (size_t i = 0; i < std::min(size_t(10), sorted.size()); i++) {
-    int bin = sorted[i].first;
-    int count = sorted[i].second;
-    double percentage = (double)count / data.size() * 100.0;
+  for (const auto &entry : acc.topBins(10)) {
+    int bin = entry.first;
+    uint64_t count = entry.second;
+    double percentage = (double)count / acc.count * 100.0;
     std::cout << "    [" << bin << "-" << (bin + 19) << "]: " << count << " ("
               << std::fixed << std::setprecision(2) << percentage << "%)\n";
   }
+  if (acc.underflow || acc.overflow) {
+    std::cout << "    (outside histogram range: " << acc.underflow
+              << " below, " << acc.overflow << " above)\n";
+  }
+  if (loadPhase && loadPhase->count > 0) {
+    std::cout << "  Load Phase: " << loadPhase->mean << " cycles avg";
+    if (extras.cpuFreqHz > 0)
+      std::cout << " (" << (loadPhase->mean * 1e6 / extras.cpuFreqHz)
+                << " us)";
+    std::cout << ", std dev " << loadPhase->stdDev() << ", range ["
+              << loadPhase->minVal << ", " << loadPhase->maxVal << "]\n";
+  }
+  if (extras.adaptive)
+    analyzeAdaptive(*extras.adaptive);
+  if (extras.pairedCheck)
+    analyzePairedCheck(acc, *extras.pairedCheck);
+  if (extras.pairedFallback)
+    std::cout << "  Baseline: paired (more than " << AMORTIZED_MAX_TICKS
+              << " distinct ticks)\n";
+  if (extras.perf)
+    analyzePerf(*extras.perf, acc.count);
+  if (extras.spectrum && extras.spectrum->enabled())
+    analyzeSpectrum(*extras.spectrum, extras.sampleRateHz);
   std::cout << "\n";
 }
 
-// Get current time as formatted string
-std::string getCurrentTimeStr() {
-  auto now = std::chrono::system_clock::now();
-  std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-  std::tm *tm = std::localtime(&now_time);
+// Interpreted vs fused cost of the quantum load circuits
+void reportCircuitCosts(const CalibrationData &cal,
+                        const QuantumLoadSpec &quantumLoad) {
+  auto printRow = [&](const std::string &name, size_t gates, size_t fusedOps,
+                      uint64_t interpreted, uint64_t fused) {
+    std::cout << name << ":\n";
+    std::cout << "  Gates: " << gates << " -> " << fusedOps << " fused ops\n";
+    std::cout << "  Interpreted: " << interpreted << " ticks ("
+              << std::fixed << std::setprecision(3)
+              << (interpreted * 1e6 / cal.cpu_freq_hz) << " us)\n";
+    std::cout << "  Fused:       " << fused << " ticks ("
+              << (fused * 1e6 / cal.cpu_freq_hz) << " us)\n";
+    std::cout << "  Speedup:     " << std::setprecision(2)
+              << (fused ? (double)interpreted / fused : 0.0) << "x\n\n";
+  };
 
-  std::ostringstream oss;
-  oss << std::put_time(tm, "%Y-%m-%d %H:%M:%S");
-  return oss.str();
+  std::cout << "\n=== Quantum Circuit Cost (median of 1000 runs) ===\n\n";
+
+  const uint64_t overhead = cal.timer.overhead;
+  CompiledCircuit singleFused(quantumLoadCircuit());
+  printRow("Single-qubit load", quantumLoadCircuit().gateCount(),
+           singleFused.ops().size(),
+           medianCycles([] { performQuantumLoad(CircuitMode::Interpreted); },
+                        1000, overhead),
+           medianCycles([] { performQuantumLoad(CircuitMode::Fused); }, 1000,
+                        overhead));
+
+  if (quantumLoad.qubits > 0) {
+    QuantumCircuit circuit =
+        buildRegisterLoadCircuit(quantumLoad.qubits, quantumLoad.layers);
+    CompiledCircuit fused(circuit);
+    int runs = quantumLoad.qubits > 20 ? 11 : 1000;
+    printRow("Register load (" + std::to_string(quantumLoad.qubits) +
+                 " qubits, " + std::to_string(quantumLoad.layers) +
+                 " layer(s))",
+             circuit.gateCount(), fused.ops().size(),
+             medianCycles(
+                 [&] {
+                   performQuantumRegisterLoad(quantumLoad.qubits,
+                                              quantumLoad.layers,
+                                              CircuitMode::Interpreted);
+                 },
+                 runs, overhead),
+             medianCycles(
+                 [&] {
+                   performQuantumRegisterLoad(quantumLoad.qubits,
+                                              quantumLoad.layers,
+                                              CircuitMode::Fused);
+                 },
+                 runs, overhead));
+  }
+}
+
+// Re-analyze a raw sample file offline: blocks are grouped by pattern name
+// (in order of first appearance) and decoded straight from the mapping.
+int analyzeRawFile(const std::string &path) {
+  SampleFileReader reader;
+  if (!reader.open(path)) {
+    std::cout << "Error: cannot read sample file " << path << "\n";
+    return 1;
+  }
+  const SampleFileHeader &h = reader.header();
+  std::cout << "=== Raw Sample Analysis: " << path << " ===\n";
+  std::cout << "Recorded at " << std::fixed << std::setprecision(2)
+            << (h.cpuFreqHz / 1e9) << " GHz, ticks " << h.tickMinus1 << " / "
+            << h.tickCenter << " / " << h.tickPlus1 << "\n\n";
+
+  // Two streaming passes, one block decoded at a time: the first reduces
+  // each pattern into its accumulator, the second counts only the histogram
+  // bins holding the percentiles, so memory does not grow with the file
+  std::vector<std::string> order;
+  std::map<std::string, size_t> index;
+  std::vector<SampleAccumulator> stats;
+  std::vector<int> values;
+  uint64_t blocks = 0;
+  auto decode = [&values](const SampleBlockView &block) {
+    values.clear();
+    SampleCursor cursor(block);
+    int64_t v;
+    while (cursor.next(v))
+      values.push_back(static_cast<int>(v));
+  };
+  bool intact = reader.forEachBlock([&](const SampleBlockView &block) {
+    auto it = index.emplace(block.patternName(), order.size()).first;
+    if (it->second == order.size()) {
+      order.push_back(it->first);
+      stats.emplace_back();
+    }
+    decode(block);
+    stats[it->second].addBlock(values.data(), values.size());
+    blocks++;
+  });
+
+  std::vector<PercentileSelector> selectors;
+  for (const auto &acc : stats)
+    selectors.emplace_back(acc, REPORT_PERCENTILES);
+  reader.forEachBlock([&](const SampleBlockView &block) {
+    decode(block);
+    selectors[index[block.patternName()]].add(values.data(), values.size());
+  });
+
+  for (size_t p = 0; p < order.size(); p++) {
+    std::vector<int> percentiles = selectors[p].result();
+    AnalysisExtras extras;
+    extras.percentiles = &percentiles;
+    analyze(order[p], stats[p], extras);
+  }
+  std::cout << blocks << " blocks read";
+  if (!intact)
+    std::cout << " (file ends in a truncated block)";
+  std::cout << "\n";
+  return 0;
+}
+
+// Compiled patterns as measured (--list-patterns)
+void printPatternPlan(const PatternPlan &plan) {
+  std::cout << "\n=== Patterns (" << plan.patterns.size() << ", "
+            << formatSampleCount(plan.iterations) << " samples each, "
+            << formatSampleCount(plan.scheduledIterations)
+            << " in scheduled mode) ===\n";
+  for (const auto &load : plan.loads) {
+    std::cout << "Load " << load.name << ": FFT " << load.fftSize << " x "
+              << load.repeats;
+    if (load.targetPercent > 0)
+      std::cout << " (target " << load.targetPercent << "%)";
+    std::cout << "\n";
+  }
+  for (const auto &pattern : plan.patterns) {
+    std::cout << "  " << pattern.key << ": " << pattern.ticks.size()
+              << " tick(s)";
+    for (size_t k = 0; k < pattern.ticks.size() && k < 8; k++)
+      std::cout << (k ? " " : " [") << pattern.ticks[k];
+    std::cout << (pattern.ticks.size() > 8 ? " ...]" : "]") << "\n";
+  }
 }
 
 // Get current date as formatted string
@@ -149,355 +679,1537 @@ std::string getCurrentDateStr() {
   return oss.str();
 }
 
-// Get current hour and minute
-void getCurrentHourMinute(int &hour, int &minute, int &second) {
-  auto now = std::chrono::system_clock::now();
-  std::time_t now_time = std::chrono::system_clock::to_time_t(now);
-  std::tm *tm = std::localtime(&now_time);
-  hour = tm->tm_hour;
-  minute = tm->tm_min;
-  second = tm->tm_sec;
-}
-
-// Scheduled mode: measurements every 30 minutes
-void runScheduledMode(const CalibrationData &cal) {
-  std::cout << "=== Scheduled Mode: 30-Minute Interval Measurements ===\n";
-  std::cout << "Measuring at: 00:00, 00:30, 01:00, ... 23:00, 23:30\n";
-  std::cout << "Total: 48 measurements x 32 patterns = 1,536 data points/day\n";
-  std::cout << "  - 12 Static (4 FFT x 3 Ticks)\n";
-  std::cout << "  - 20 Dynamic (4 FFT x 5 Patterns)\n";
+// Options shared by both run modes (filled from the command line)
+struct RunOptions {
+  std::vector<int> cores; // Parallel workers (full mode); empty = sequential
+  QuantumLoadSpec quantumLoad;
+  std::string rawOutPath; // Raw sample file (SampleFile.hpp); empty = none
+  int logCore = -1;       // Scheduled-mode log writer core; -1 = not pinned
+  int measureCore = -1;   // Pinned measuring core; helper threads avoid it
+  int fsyncIntervalMs = 0; // Scheduled-mode CSV fsync interval; 0 = never
+  std::vector<ScheduleTrigger> triggers; // Scheduled-mode scan start times
+  int scanSeconds = 120;                 // Length of each boundary scan
+  int prewarmMs = 500; // Busy warm-up before each scan trigger
+  MetricsServerOptions metrics; // Scheduled-mode Prometheus endpoint
+  SampleArenaOptions arena;     // Scheduled-mode sample buffer
+  bool loadTiming = false; // Full mode: report loaded-phase cycles
+  bool perf = false;       // Full mode: perf_event counters per pattern
+  int spectrumWindow = 0;  // Full mode: Welch window length; 0 = off
+  bool amortizedBaseline = false; // Baseline in blocks, not per sample
+  AdaptiveOptions adaptive; // Stop each pattern at a target precision
+  std::string spectrumOutPath; // Full mode: spectra as CSV; empty = none
+  std::string checkpointPath;  // Full mode: checkpoint file; empty = none
+  int checkpointSeconds = 60;  // Minimum time between checkpoint saves
+  bool resume = false;         // Continue from `checkpoint` (read by main)
+  CheckpointFile checkpoint;
+  PatternConfig patterns = defaultPatternConfig(); // Loads and schedules
+};
+
+// Append a pattern's samples to the raw sample file, one block at a time
+void writeRawSamples(SampleFileWriter &raw, const SamplePatternInfo &info,
+                     const std::vector<int> &data) {
+  SampleBlockEncoder encoder;
+  for (int v : data) {
+    encoder.add(v);
+    if (encoder.full()) {
+      raw.writeBlock(info, encoder);
+      encoder.clear();
+    }
+  }
+  raw.writeBlock(info, encoder);
+}
+
+// Raw blocks encoded during a boundary scan (or a parallel chunk) and
+// written after it ends. `info` is built once per pattern and outlives the
+// block, so a block does not copy the pattern's tick array.
+struct PendingRawBlock {
+  const SamplePatternInfo *info = nullptr;
+  SampleBlockEncoder block;
+};
+
+// The first `used` entries of `pending` are taken; the rest are blocks of
+// earlier scans whose buffers are reused
+void encodeRawSamples(const SamplePatternInfo &info, const int *data,
+                      size_t n, std::vector<PendingRawBlock> &pending,
+                      size_t &used) {
+  auto nextBlock = [&] {
+    if (used == pending.size())
+      pending.push_back({&info, SampleBlockEncoder()});
+    PendingRawBlock &block = pending[used++];
+    block.info = &info;
+    block.block.clear();
+  };
+  nextBlock();
+  for (size_t i = 0; i < n; i++) {
+    if (pending[used - 1].block.full())
+      nextBlock();
+    pending[used - 1].block.add(data[i]);
+  }
+}
+
+// Raw-file metadata for a compiled pattern
+SamplePatternInfo rawPatternInfo(const CompiledPattern &pattern, uint32_t id) {
+  SamplePatternInfo info;
+  info.id = id;
+  info.name = pattern.key;
+  info.fftLevel = static_cast<uint8_t>(pattern.load);
+  info.dynamic = pattern.dynamic;
+  info.ticks = pattern.ticks;
+  return info;
+}
+
+// Metadata of every pattern, built once per run: the tick arrays can be
+// large, so they are not copied per scan or per block
+std::vector<SamplePatternInfo> rawPatternInfos(const PatternPlan &plan) {
+  std::vector<SamplePatternInfo> infos;
+  infos.reserve(plan.patterns.size());
+  for (size_t p = 0; p < plan.patterns.size(); p++)
+    infos.push_back(rawPatternInfo(plan.patterns[p], static_cast<uint32_t>(p)));
+  return infos;
+}
+
+// Kernel level and quantum load of the run: shown in the metrics, and a
+// checkpoint is only resumed under both
+std::string runContext(const QuantumLoadSpec &quantumLoad) {
+  std::ostringstream ss;
+  ss << simdLevelName(activeSimdLevel()) << " kernels, quantum load "
+     << quantumLoad.qubits << "x" << quantumLoad.layers << " "
+     << (quantumLoad.mode == CircuitMode::Fused ? "fused" : "interpreted");
+  return ss.str();
+}
+
+// Scheduled mode: boundary scans at the configured trigger times
+// (default *:29:00 and *:59:00, i.e. across every half-hour boundary)
+// During a scan the measuring thread only formats lines into the
+// AsyncLogger ring; the writer thread owns the CSV file and stdout.
+void runScheduledMode(const CalibrationData &cal, const RunOptions &options) {
+  const QuantumLoadSpec &quantumLoad = options.quantumLoad;
+  // Every tick array is built here, before the first scan
+  const PatternPlan plan = compilePatterns(options.patterns, cal);
+  const size_t patternCount = plan.patterns.size();
+  std::cout << "=== Scheduled Mode: Boundary Scan Measurements ===\n";
+  std::cout << "Scan triggers:";
+  for (const auto &trigger : options.triggers) {
+    std::cout << " " << formatScheduleTrigger(trigger);
+  }
+  std::cout << "\n";
+  std::cout << "Each scan: " << options.scanSeconds << " s, pre-warm "
+            << options.prewarmMs << " ms, cycling " << patternCount
+            << " patterns ("
+            << formatSampleCount(plan.scheduledIterations) << " each)\n";
+  std::cout << "  - " << plan.staticCount << " Static (" << plan.loads.size()
+            << " FFT x " << plan.staticCount / plan.loads.size()
+            << " Ticks)\n";
+  std::cout << "  - " << patternCount - plan.staticCount << " Dynamic ("
+            << plan.loads.size() << " FFT x "
+            << (patternCount - plan.staticCount) / plan.loads.size()
+            << " Patterns)\n";
+  if (options.amortizedBaseline)
+    std::cout << "  Baseline amortized over blocks of " << AMORTIZED_BLOCK
+              << " samples, paired check per pattern (up to "
+              << AMORTIZED_MAX_TICKS << " distinct ticks, else paired)\n";
+  if (options.adaptive.enabled)
+    std::cout << "  Adaptive: stop at mean +/- " << options.adaptive.meanCi
+              << " ops and peak share +/- " << options.adaptive.peakCi
+              << " points\n";
   std::cout << "========================================================\n\n";
 
   // Create log file
   std::string logFileName = "time_surface_" + getCurrentDateStr() + ".csv";
-  std::cout << "Log file: " << logFileName << "\n\n";
-
-  // Write CSV header
-  std::ofstream logFile(logFileName, std::ios::app);
-  if (logFile.tellp() == 0) {
-    logFile << "timestamp,hour,minute,type,fft_level,pattern,avg,std_dev,peak_"
-               "bin,peak_percent\n";
+  std::cout << "Log file: " << logFileName << "\n";
+  if (options.logCore >= 0) {
+    std::cout << "Log writer core: " << options.logCore << "\n";
   }
-  logFile.close();
+  if (options.fsyncIntervalMs > 0) {
+    std::cout << "Log fsync: every " << options.fsyncIntervalMs << " ms\n";
+  }
+  std::cout << "\n";
 
-  const int iterations =
-      30000; // 30K per pattern (32 patterns x 30K = 960K total)
+  // Optional raw sample file (blocks are appended across scans and days)
+  SampleFileWriter raw;
+  if (!options.rawOutPath.empty()) {
+    std::string error;
+    if (raw.open(options.rawOutPath, cal, error)) {
+      std::cout << "Raw samples: " << options.rawOutPath << "\n\n";
+    } else {
+      std::cout << "Warning: raw samples not kept (" << error << ")\n\n";
+    }
+  }
+  std::cout.flush();
+
+  // One file handle for the whole run; CSV header written if the file is new
+  AsyncLoggerOptions logOptions;
+  logOptions.path = logFileName;
+  logOptions.writerCore = options.logCore;
+  logOptions.avoidCore = options.measureCore;
+  logOptions.fsyncIntervalMs = options.fsyncIntervalMs;
+  AsyncLogger logger;
+  if (!logger.start(logOptions,
+                    "timestamp,hour,minute,type,fft_level,pattern,avg,std_dev,"
+                    "peak_bin,peak_percent\n")) {
+    std::cout << "Warning: cannot open log file " << logFileName << "\n";
+    return;
+  }
+  auto logNow = [] { return std::chrono::system_clock::now(); };
+
+  // Live metrics: the scan loop only stores into the registry; the server
+  // thread, like the log writer, runs at normal priority on --log-core or
+  // anywhere but the measuring core
+  MetricsRegistry metrics;
+  MetricsServer metricsServer;
+  if (options.metrics.port > 0) {
+    std::vector<PatternMetricLabels> labels;
+    for (const auto &pattern : plan.patterns)
+      labels.push_back({pattern.name, pattern.dynamic ? "Dynamic" : "Static",
+                        plan.loads[pattern.load].name});
+    metrics.setup(labels, cal, runContext(quantumLoad));
+    MetricsServerOptions serverOptions = options.metrics;
+    serverOptions.core = options.logCore;
+    serverOptions.avoidCore = options.measureCore;
+    std::string error;
+    if (metricsServer.start(serverOptions, metrics, error))
+      logger.logf(LogChannel::Console, LogStamp::None, logNow(),
+                  "Metrics: http://%s:%d/metrics\n",
+                  serverOptions.bind.c_str(), serverOptions.port);
+    else
+      logger.logf(LogChannel::Console, LogStamp::None, logNow(),
+                  "Warning: metrics endpoint disabled (%s)\n",
+                  error.c_str());
+  }
 
-  // FFT load levels
-  struct FFTConfig {
-    const char *name;
-    FFTLoadLevel level;
-  };
-  FFTConfig fftConfigs[] = {{"75%", FFTLoadLevel::LOAD_75_PERCENT},
-                            {"80%", FFTLoadLevel::LOAD_80_PERCENT},
-                            {"85%", FFTLoadLevel::LOAD_85_PERCENT},
-                            {"90%", FFTLoadLevel::LOAD_90_PERCENT}};
-
-  // Static tick configurations
-  struct TickConfig {
-    const char *name;
-    uint64_t tick;
-  };
-  TickConfig tickConfigs[] = {
-      {"-1", cal.tick_minus1}, {"0", cal.tick_center}, {"+1", cal.tick_plus1}};
+  const int iterations = plan.scheduledIterations;
+  // Adaptive: never more than the fixed count, so the scan cadence holds;
+  // iterations saved go to the next patterns of the scan
+  uint64_t minIterations = iterations, maxIterations = iterations;
+  if (options.adaptive.enabled)
+    adaptiveBounds(options.adaptive, iterations, 1, minIterations,
+                   maxIterations);
+
+  // Mapped, prefaulted and locked once; reused across patterns and scans
+  // so storing samples in the scan loop neither allocates nor page-faults
+  SampleArena arena;
+  arena.reserve(maxIterations * sizeof(int) + ARENA_ALIGN, options.arena);
+  ArenaBuffer<int> data(arena, maxIterations);
+  SampleAccumulator scanStats; // Reused by every quickAnalyze
+  SampleAccumulator pairedCheck; // Amortized baseline, per pattern
+  // Amortized baseline scratch, sized for the longest pattern; a pattern
+  // measured in several adaptive chunks keeps its reservoirs warm
+  AmortizedState amortizedState;
+  if (options.amortizedBaseline) {
+    size_t maxPeriod = 0;
+    for (const auto &pattern : plan.patterns)
+      maxPeriod = std::max(maxPeriod, pattern.ticks.size());
+    amortizedState.reserve(maxPeriod);
+  }
+  logger.logf(LogChannel::Console, LogStamp::None, logNow(),
+              "Sample arena: %s\n", arena.describe().c_str());
+  // Raw blocks: encoders for one cycle through the patterns are reserved
+  // and prefaulted up front. A scan that cycles more often grows the list
+  // once; later scans reuse it.
+  std::vector<SamplePatternInfo> rawInfos;
+  std::vector<PendingRawBlock> pendingRaw;
+  size_t pendingUsed = 0;
+  if (raw.isOpen()) {
+    rawInfos = rawPatternInfos(plan);
+    size_t perPattern =
+        (maxIterations + SAMPLE_BLOCK_SIZE - 1) / SAMPLE_BLOCK_SIZE;
+    pendingRaw.resize(std::max<size_t>(perPattern, 1) * patternCount);
+    for (PendingRawBlock &block : pendingRaw)
+      block.block.prefault();
+  }
 
-  // Dynamic patterns
-  struct DynamicPattern {
-    const char *name;
-    uint64_t ticks[6];
-  };
-  DynamicPattern dynamicPatterns[] = {
-      {"Original",
-       {cal.tick_minus1, cal.tick_minus1, cal.tick_center, cal.tick_plus1,
-        cal.tick_plus1, cal.tick_center}},
-      {"Alternating",
-       {cal.tick_plus1, cal.tick_minus1, cal.tick_plus1, cal.tick_minus1,
-        cal.tick_plus1, cal.tick_minus1}},
-      {"Block",
-       {cal.tick_plus1, cal.tick_plus1, cal.tick_plus1, cal.tick_minus1,
-        cal.tick_minus1, cal.tick_minus1}},
-      {"Mixed",
-       {cal.tick_center, cal.tick_minus1, cal.tick_plus1, cal.tick_center,
-        cal.tick_plus1, cal.tick_minus1}},
-      {"Sweep",
-       {cal.tick_minus1, cal.tick_center, cal.tick_plus1, cal.tick_plus1,
-        cal.tick_center, cal.tick_minus1}}};
-
-  std::string lastRunTime = "";
-  int lastPrintedMinute = -1;
+  const auto scanDuration = std::chrono::seconds(options.scanSeconds);
+  const auto prewarm = std::chrono::milliseconds(options.prewarmMs);
 
   while (true) {
-    int hour, minute, second;
-    getCurrentHourMinute(hour, minute, second);
-
-    char timeStrBuf[10];
-    snprintf(timeStrBuf, sizeof(timeStrBuf), "%02d:%02d", minute, second);
-    std::string timeStr = timeStrBuf;
-
-    // Trigger at XX:29:00 or XX:59:00 for 2-minute boundary scan
-    bool isBoundaryScan = (second == 0) && (minute == 29 || minute == 59);
-
-    if (isBoundaryScan && lastRunTime != timeStr) {
-      lastRunTime = timeStr;
-
-      int boundaryMinute = (minute == 29) ? 30 : 0;
-      std::string timestamp = getCurrentTimeStr();
-
-      std::cout << "\n[[" << timestamp
-                << "] Starting 2-minute Boundary Scan...\n";
-      std::cout << "  Scanning across " << hour << ":" << std::setfill('0')
-                << std::setw(2) << boundaryMinute << ":00 boundary\n";
-
-      auto scanStart = std::chrono::steady_clock::now();
-      auto scanEnd = scanStart + std::chrono::seconds(120); // 2 minutes
-      int patternIndex = 0;
-
-      // Build pattern list: 12 static + 20 dynamic = 32 patterns
-      // We'll cycle through them continuously
-
-      while (std::chrono::steady_clock::now() < scanEnd) {
-        int pIdx = patternIndex % 32;
-        std::string measureTimestamp = getCurrentTimeStr();
-
-        // Get current time for CSV
-        int mHour, mMinute, mSecond;
-        getCurrentHourMinute(mHour, mMinute, mSecond);
-
-        std::vector<int> data;
-        data.reserve(iterations);
-
-        std::string patternType;
-        std::string fftName;
-        std::string patternName;
-
-        if (pIdx < 12) {
-          // Static pattern (index 0-11)
-          int fftIdx = pIdx / 3;
-          int tickIdx = pIdx % 3;
-          patternType = "Static";
-          fftName = fftConfigs[fftIdx].name;
-          patternName = std::string("Tick") + tickConfigs[tickIdx].name;
-
-          for (int i = 0; i < iterations; i++) {
-            data.push_back(measureSingle(tickConfigs[tickIdx].tick,
-                                         fftConfigs[fftIdx].level));
-          }
-        } else {
-          // Dynamic pattern (index 12-31)
-          int dynIdx = pIdx - 12;
-          int fftIdx = dynIdx / 5;
-          int patIdx = dynIdx % 5;
-          patternType = "Dynamic";
-          fftName = fftConfigs[fftIdx].name;
-          patternName = dynamicPatterns[patIdx].name;
-
-          for (int i = 0; i < iterations; i++) {
-            uint64_t tick = dynamicPatterns[patIdx].ticks[i % 6];
-            data.push_back(measureSingle(tick, fftConfigs[fftIdx].level));
-          }
-        }
-
-        QuickStats stats = quickAnalyze(data);
-
-        // Append to CSV with precise timestamp
-        std::ofstream logFile(logFileName, std::ios::app);
-        logFile << measureTimestamp << "," << mHour << "," << mMinute << ","
-                << patternType << "," << fftName << "," << patternName << ","
-                << std::fixed << std::setprecision(2) << stats.avg << ","
-                << stats.stdDev << "," << stats.peakBin << ","
-                << stats.peakPercent << "\n";
-        logFile.close();
-
-        // Progress indicator every 32 patterns (1 full cycle)
-        if (patternIndex % 32 == 0) {
-          std::cout << "  [" << std::setfill('0') << std::setw(2) << mMinute
-                    << ":" << std::setw(2) << mSecond << "] Cycle "
-                    << (patternIndex / 32 + 1) << "...\n";
+    WallClock::time_point trigger =
+        nextTriggerTime(options.triggers, WallClock::now());
+    if (trigger == WallClock::time_point::max()) {
+      logger.logf(LogChannel::Console, LogStamp::None, logNow(),
+                  "Warning: no upcoming trigger time, stopping\n");
+      return;
+    }
+    std::tm triggerTm = localTimeOf(trigger);
+    // The boundary is the middle of the scan window
+    std::tm boundaryTm = localTimeOf(trigger + scanDuration / 2);
+    logger.logf(LogChannel::Console, LogStamp::None, logNow(),
+                "Waiting for next boundary... (next scan at "
+                "%02d:%02d:%02d)\n",
+                triggerTm.tm_hour, triggerTm.tm_min, triggerTm.tm_sec);
+
+    // Sleep on the absolute deadline, then keep the core busy with the
+    // measurement load until the trigger so caches and clocks are warm
+    sleepUntilWallClock(trigger - prewarm);
+    spinUntilWallClock(trigger, [&] {
+      performLoad(plan.loads.front());
+      performQuantumLoad(quantumLoad);
+    });
+    auto scanStartWall = WallClock::now();
+    auto scanStart = std::chrono::steady_clock::now();
+    double startOffsetUs =
+        std::chrono::duration<double, std::micro>(scanStartWall - trigger)
+            .count();
+
+    char timestamp[32];
+    std::tm startTm = localTimeOf(scanStartWall);
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", &startTm);
+    logger.logf(LogChannel::Console, LogStamp::None, scanStartWall,
+                "\n[[%s] Starting %d-second Boundary Scan... "
+                "(start offset %+.1f us)\n"
+                "  Scanning across %d:%02d:%02d boundary\n",
+                timestamp, options.scanSeconds, startOffsetUs,
+                boundaryTm.tm_hour, boundaryTm.tm_min, boundaryTm.tm_sec);
+
+    auto scanEnd = scanStart + scanDuration;
+    int patternIndex = 0;
+    int pairedChecked = 0, pairedDiffers = 0;
+    size_t pIdx = 0;
+    uint64_t droppedBefore = logger.dropped();
+    metrics.scanStarted(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(scanDuration)
+            .count());
+
+    // Cycle through the compiled patterns continuously
+    while (std::chrono::steady_clock::now() < scanEnd) {
+      const CompiledPattern &pattern = plan.patterns[pIdx];
+      const LoadSpec &load = plan.loads[pattern.load];
+      // Rendered as local time by the log writer thread
+      auto measureTime = std::chrono::system_clock::now();
+      auto measureStart = std::chrono::steady_clock::now();
+
+      data.clear();
+      BatchMeans batches;
+      auto keep = [&](int value) {
+        data.push_back(value);
+        batches.add(value);
+      };
+      // One chunk of the fixed count, or chunks until the target precision
+      QuickStats stats = {};
+      size_t position = 0;
+      pairedCheck.reset();
+      for (uint64_t chunk = minIterations; chunk > 0;) {
+        int n = static_cast<int>(chunk);
+        if (options.amortizedBaseline)
+          position = measureTicksAmortized(pattern.ticks, load, quantumLoad,
+                                           n, nullptr, keep, amortizedState,
+                                           nullptr, &pairedCheck, position);
+        else
+          position = measureTicks(pattern.ticks, load, quantumLoad, n,
+                                  nullptr, keep, position);
+        stats = quickAnalyze(data.data(), data.size(), scanStats);
+        if (!options.adaptive.enabled)
+          break;
+        PrecisionEstimate precision = estimatePrecision(
+            data.size(), stats.stdDev * stats.stdDev, stats.peakPercent,
+            batches, options.adaptive.z);
+        chunk = nextAdaptiveChunk(precision, data.size(), maxIterations,
+                                  options.adaptive);
+      }
+      double measureSeconds = std::chrono::duration<double>(
+                                  std::chrono::steady_clock::now() -
+                                  measureStart)
+                                  .count();
+      PairedCheckResult check;
+      if (options.amortizedBaseline &&
+          comparePairedCheck(scanStats, pairedCheck, check)) {
+        pairedChecked++;
+        if (!check.same) {
+          pairedDiffers++;
+          logger.logf(LogChannel::Console, LogStamp::MinuteSecond,
+                      measureTime,
+                      "Paired check: %s differs (diff %+.2f +/- %.2f)\n",
+                      pattern.key.c_str(), check.diff, check.ci);
         }
+      }
+      if (options.metrics.port > 0)
+        metrics.patternMeasured(
+            pIdx, stats.avg, stats.stdDev, stats.peakBin, stats.peakPercent,
+            data.size(), measureSeconds / std::max<size_t>(data.size(), 1),
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                measureTime.time_since_epoch())
+                .count());
+
+      if (raw.isOpen()) {
+        // Same pattern keys as the full benchmark
+        encodeRawSamples(rawInfos[pIdx], data.data(), data.size(),
+                         pendingRaw, pendingUsed);
+      }
 
-        patternIndex++;
+      // Append to CSV with precise timestamp
+      logger.logf(LogChannel::File, LogStamp::CsvTime, measureTime,
+                  "%s,%s,%s,%.2f,%.2f,%d,%.2f\n",
+                  pattern.dynamic ? "Dynamic" : "Static", load.name.c_str(),
+                  pattern.name.c_str(), stats.avg, stats.stdDev,
+                  stats.peakBin, stats.peakPercent);
+
+      // Progress indicator once per full cycle
+      if (pIdx == 0) {
+        logger.logf(LogChannel::Console, LogStamp::MinuteSecond,
+                    measureTime, "Cycle %d...\n",
+                    static_cast<int>(patternIndex / patternCount) + 1);
       }
 
-      std::cout << "Boundary scan complete. " << patternIndex
-                << " patterns recorded.\n";
-      std::cout << "Waiting for next boundary...\n";
+      patternIndex++;
+      if (++pIdx == patternCount)
+        pIdx = 0;
     }
 
-    if (minute != lastPrintedMinute) {
-      std::cout << "Waiting... (Current: " << std::setfill('0') << std::setw(2)
-                << minute << ":" << std::setw(2) << second << ")\n";
-      lastPrintedMinute = minute;
+    // Raw blocks hit the disk only once the scan is over
+    bool rawWritten = true;
+    for (size_t b = 0; b < pendingUsed; b++) {
+      rawWritten = raw.writeBlock(*pendingRaw[b].info, pendingRaw[b].block) &&
+                   rawWritten;
+    }
+    pendingUsed = 0;
+    if (!rawWritten) {
+      logger.logf(LogChannel::Console, LogStamp::None, logNow(),
+                  "Warning: cannot write raw samples to %s\n",
+                  options.rawOutPath.c_str());
     }
 
-    // Sleep for 0.1s
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    logger.logf(LogChannel::Console, LogStamp::None, logNow(),
+                "Boundary scan complete. %d patterns recorded.\n",
+                patternIndex);
+    if (options.amortizedBaseline) {
+      logger.logf(LogChannel::Console, LogStamp::None, logNow(),
+                  "Paired check: %d of %d patterns equivalent\n",
+                  pairedChecked - pairedDiffers, pairedChecked);
+    }
+    metrics.scanEnded(logger.dropped());
+    uint64_t dropped = logger.dropped() - droppedBefore;
+    if (dropped > 0) {
+      logger.logf(LogChannel::Console, LogStamp::None, logNow(),
+                  "Warning: log ring full, %llu lines dropped\n",
+                  static_cast<unsigned long long>(dropped));
+    }
   }
 }
 
-// Full benchmark mode
-void runFullBenchmark(const CalibrationData &cal) {
-  std::cout << "\nTarget: 277.3 kHz region (+/-1 kHz)\n";
-  std::cout << "Base Period: 3.6 microseconds\n";
-  std::cout << "Iterations: 1,000,000 per measurement\n";
-  std::cout << "Patterns: 32 (12 Static + 20 Dynamic)\n";
-  std::cout << "========================================================\n\n";
+// One full-benchmark pattern: a compiled tick array under its load
+struct BenchJob {
+  const CompiledPattern *pattern;
+  LoadSpec load;
+  QuantumLoadSpec quantumLoad;
+  bool amortizable; // At most AMORTIZED_MAX_TICKS distinct ticks
+  const SamplePatternInfo *rawInfo = nullptr; // Set with a raw writer
+};
+
+// Optional per-job instrumentation (all off by default)
+struct JobProbes {
+  bool loadTiming = false;    // Loaded-phase cycles per sample
+  uint64_t timerOverhead = 0; // Subtracted from those cycles
+  bool perf = false;          // perf_event counters (PerfCounters.hpp)
+  int spectrumWindow = 0;     // Welch window (SpectralAnalysis.hpp); 0 = off
+  bool amortizedBaseline = false; // measureTicksAmortized + paired check
+  bool adaptive = false;          // Batch means for AdaptiveScheduler
+  bool deferRaw = false; // Raw blocks kept in JobResult, written by caller
+};
+
+// Everything measured for one pattern
+struct JobResult {
+  SampleAccumulator samples;
+  SampleAccumulator loadPhase; // Filled with JobProbes::loadTiming
+  PerfTotals perf;             // Filled with JobProbes::perf
+  SpectralAccumulator spectrum; // Filled with JobProbes::spectrumWindow
+  SampleAccumulator pairedCheck; // JobProbes::amortizedBaseline: paired run
+  AmortizedStats amortized;
+  AmortizedState amortizedState; // JobProbes::amortizedBaseline scratch
+  BatchMeans batches; // Filled with JobProbes::adaptive
+  size_t position = 0; // Next position in the tick array
+  std::vector<PendingRawBlock> rawBlocks; // JobProbes::deferRaw
+};
+
+// Run `iterations` samples of one pattern on the calling thread and add
+// them to `result`; a pattern measured in chunks continues where the last
+// chunk stopped. Samples go straight into the accumulator; nothing is
+// stored per sample.
+// With a raw writer, each sample is also encoded and written per block,
+// under the job's rawInfo.
+// With a spectrum window, samples are also stored for the Welch
+// accumulator, which transforms them after the chunk's last measurement.
+// Counters are opened on the calling thread, so each worker counts itself.
+void measureJob(const BenchJob &job, int iterations, JobResult &result,
+                SampleFileWriter *raw = nullptr,
+                const JobProbes &probes = JobProbes()) {
+  SampleAccumulator &acc = result.samples;
+  if (!result.spectrum.enabled())
+    result.spectrum = SpectralAccumulator(probes.spectrumWindow);
+  const bool spectrum = result.spectrum.enabled();
+  LoadTiming timing;
+  timing.overhead = probes.timerOverhead;
+  PerfCounterSet perf;
+  if (probes.perf && perf.open()) {
+    timing.perf = &perf;
+    timing.perfTotals = &result.perf;
+  }
+  LoadTiming *timingOut =
+      (probes.loadTiming || timing.perf) ? &timing : nullptr;
+  SampleBlockEncoder encoder;
+  if (raw)
+    encoder.prefault();
+  if (spectrum)
+    result.spectrum.beginChunk(static_cast<size_t>(std::max(iterations, 0)));
+
+  auto writeRaw = [&] {
+    if (!probes.deferRaw)
+      raw->writeBlock(*job.rawInfo, encoder);
+    else if (!encoder.empty())
+      result.rawBlocks.push_back({job.rawInfo, encoder});
+    encoder.clear();
+  };
+
+  auto record = [&](int value) {
+    acc.add(value);
+    if (spectrum)
+      result.spectrum.add(value);
+    if (probes.adaptive)
+      result.batches.add(value);
+    if (probes.loadTiming)
+      result.loadPhase.add(static_cast<int>(timing.loadCycles));
+    if (raw) {
+      encoder.add(value);
+      if (encoder.full())
+        writeRaw();
+    }
+  };
+
+  if (timing.perf)
+    perf.beginPattern();
+  if (probes.amortizedBaseline)
+    result.position = measureTicksAmortized(
+        job.pattern->ticks, job.load, job.quantumLoad, iterations, timingOut,
+        record, result.amortizedState, &result.amortized, &result.pairedCheck,
+        result.position);
+  else
+    result.position =
+        measureTicks(job.pattern->ticks, job.load, job.quantumLoad,
+                     iterations, timingOut, record, result.position);
+  if (timing.perf)
+    perf.endPattern(result.perf);
+  if (raw)
+    writeRaw();
+  if (spectrum)
+    result.spectrum.flush();
+}
+
+// Report a measured chunk to the scheduler
+void completeChunk(AdaptiveScheduler &scheduler, size_t j,
+                   const JobResult &result) {
+  QuickStats stats = quickAnalyze(result.samples);
+  scheduler.complete(j, result.samples.count, result.samples.variance(),
+                     stats.peakPercent, result.batches);
+}
 
-  // Warmup
-  std::cout << "Warming up...\n";
+// ========== Checkpoints ==========
+// With --checkpoint, patterns are measured in chunks of at most
+// CHECKPOINT_CHUNK samples. After each chunk the pattern's state is
+// serialized, and every --checkpoint-seconds all snapshots go to the file.
+// --resume restores them and measures only what is left. A killed run
+// loses at most the chunks in flight and the time since the last save.
+
+constexpr int CHECKPOINT_CHUNK = 100000;
+
+// Everything a pattern has accumulated so far
+std::string snapshotJob(const JobResult &r, const AdaptiveJobState &state) {
+  CheckpointWriter w;
+  w.put(state);
+  w.put(static_cast<uint64_t>(r.position));
+  saveAccumulator(w, r.samples);
+  saveAccumulator(w, r.loadPhase);
+  saveAccumulator(w, r.pairedCheck);
+  w.put(r.perf);
+  w.put(r.amortized);
+  r.batches.saveState(w);
+  r.spectrum.saveState(w);
+  return w.bytes();
+}
+
+bool restoreJob(const std::string &bytes, JobResult &r,
+                AdaptiveJobState &state) {
+  CheckpointReader in(bytes);
+  state = in.get<AdaptiveJobState>();
+  r.position = static_cast<size_t>(in.get<uint64_t>());
+  bool ok = loadAccumulator(in, r.samples) &&
+            loadAccumulator(in, r.loadPhase) &&
+            loadAccumulator(in, r.pairedCheck);
+  r.perf = in.get<PerfTotals>();
+  r.amortized = in.get<AmortizedStats>();
+  ok = ok && r.batches.loadState(in) && r.spectrum.loadState(in);
+  return ok && in.ok() && in.atEnd();
+}
+
+// The compiled patterns: names, tick arrays, loads and iterations
+uint64_t planHash(const PatternPlan &plan) {
+  auto mix = [](uint64_t h, uint64_t v) {
+    return checkpointHash(&v, sizeof(v), h);
+  };
+  uint64_t h = mix(checkpointHash(nullptr, 0), plan.iterations);
+  for (const LoadSpec &load : plan.loads) {
+    h = checkpointHash(load.name.data(), load.name.size(), h);
+    h = mix(mix(h, load.fftSize), load.repeats);
+  }
+  for (const CompiledPattern &pattern : plan.patterns) {
+    h = checkpointHash(pattern.key.data(), pattern.key.size(), h);
+    h = mix(h, pattern.load);
+    h = checkpointHash(pattern.ticks.data(),
+                       pattern.ticks.size() * sizeof(uint64_t), h);
+  }
+  return h;
+}
+
+// Options that change what is accumulated
+std::string checkpointOptionsKey(const RunOptions &options) {
+  const AdaptiveOptions &a = options.adaptive;
+  std::ostringstream ss;
+  ss << "amortized=" << options.amortizedBaseline
+     << " load-timing=" << options.loadTiming << " perf=" << options.perf
+     << " spectrum=" << options.spectrumWindow << " raw=" << options.rawOutPath
+     << " adaptive=" << a.enabled;
+  if (a.enabled)
+    ss << "/" << a.meanCi << "/" << a.peakCi << "/" << a.minIterations << "/"
+       << a.maxIterations;
+  return ss.str();
+}
+
+// Progress line suffix: the chunk's outcome under adaptive sampling
+std::string chunkProgress(const AdaptiveScheduler &scheduler, size_t j) {
+  if (!scheduler.enabled())
+    return "";
+  const AdaptiveJobState &state = scheduler.job(j);
+  std::ostringstream ss;
+  ss << std::fixed << std::setprecision(2) << " (mean +/- "
+     << state.estimate.meanHalfWidth << ", peak +/- "
+     << state.estimate.peakHalfWidth << ")";
+  if (state.status != AdaptiveStatus::Running)
+    ss << " -> " << adaptiveStatusName(state.status) << " at "
+       << state.done;
+  return ss.str();
+}
+
+// Samples per second of a pattern: one sample spans four tick periods
+// (baseline, idle, loaded, idle; see measureSingle), or two with an
+// amortized baseline, whose blocks are left out
+double sampleRateOf(const CompiledPattern &pattern, uint64_t cpuFreqHz,
+                    bool amortized = false) {
+  double ticks = 0.0;
+  for (uint64_t t : pattern.ticks)
+    ticks += static_cast<double>(t);
+  if (pattern.ticks.empty() || ticks <= 0.0)
+    return 0.0;
+  return cpuFreqHz / ((amortized ? 2.0 : 4.0) * ticks / pattern.ticks.size());
+}
+
+// One row per pattern and frequency bin (--spectrum-out)
+bool writeSpectrumCsv(const std::string &path,
+                      const std::vector<BenchJob> &jobs,
+                      const std::vector<JobResult> &results,
+                      uint64_t cpuFreqHz, bool amortized) {
+  std::FILE *f = std::fopen(path.c_str(), "w");
+  if (!f)
+    return false;
+  std::fprintf(f, "pattern,bin,cycles_per_sample,frequency_hz,density\n");
+  for (size_t j = 0; j < jobs.size(); j++) {
+    const SpectralAccumulator &spectrum = results[j].spectrum;
+    double rate = sampleRateOf(*jobs[j].pattern, cpuFreqHz,
+                               amortized && jobs[j].amortizable);
+    for (int k = 0; k < spectrum.bins() && spectrum.windows() > 0; k++)
+      std::fprintf(f, "%s,%d,%.8f,%.3f,%.6g\n",
+                   jobs[j].pattern->key.c_str(), k, spectrum.frequency(k),
+                   spectrum.frequency(k) * rate, spectrum.density(k));
+  }
+  return std::fclose(f) == 0;
+}
+
+// Busy-wait so the core leaves any idle frequency state before measuring
+void warmupCore() {
   uint64_t warmupStart = getCycleCount();
   while ((getCycleCount() - warmupStart) < 72000000) {
     nop();
   }
-  std::cout << "Done.\n\n";
+}
 
-  const int iterations = 1000000;
+// Default parallel core set: everything except core 0 (left for the OS)
+std::vector<int> defaultParallelCores() {
+  int n = static_cast<int>(std::thread::hardware_concurrency());
+  std::vector<int> cores;
+  for (int c = (n > 1 ? 1 : 0); c < std::max(n, 1); c++)
+    cores.push_back(c);
+  return cores;
+}
 
-  // FFT load levels
-  struct FFTConfig {
-    const char *name;
-    FFTLoadLevel level;
-  };
-  FFTConfig fftConfigs[] = {{"75%", FFTLoadLevel::LOAD_75_PERCENT},
-                            {"80%", FFTLoadLevel::LOAD_80_PERCENT},
-                            {"85%", FFTLoadLevel::LOAD_85_PERCENT},
-                            {"90%", FFTLoadLevel::LOAD_90_PERCENT}};
-
-  // Tick configurations
-  struct TickConfig {
-    const char *name;
-    uint64_t tick;
-  };
-  TickConfig tickConfigs[] = {
-      {"-1", cal.tick_minus1}, {"0", cal.tick_center}, {"+1", cal.tick_plus1}};
+// Run the job list across pinned worker threads.
+// Each worker pins itself, raises its priority, warms up its core and checks
+// that the TSC rate seen from that core matches the global calibration.
+// Workers take chunks from the scheduler under one lock; a pattern is only
+// ever measured by one worker at a time. A worker with nothing to take
+// waits while other workers' chunks may still lead to more work.
+// `onChunk` runs under the same lock after every chunk.
+// Qubit's RNG is thread_local, so every worker draws from its own generator.
+void runJobsParallel(const std::vector<BenchJob> &jobs,
+                     const std::vector<int> &cores, const CalibrationData &cal,
+                     AdaptiveScheduler &scheduler,
+                     std::vector<JobResult> &results, SampleFileWriter *raw,
+                     const JobProbes &probes,
+                     const std::function<void(size_t)> &onChunk) {
+  std::mutex printMutex;
+  std::mutex workMutex;
+  std::condition_variable workChanged;
+
+  auto worker = [&](int core) {
+    bool pinned = pinCurrentThreadToCore(core);
+    std::string priority;
+    bool realtime = raiseAndVerifyPriority(priority);
+    prefaultStack(256 * 1024);
+    if (!jobs.empty())
+      prepareQuantumLoad(jobs.front().quantumLoad);
+
+    uint64_t coreFreq = measureCPUFrequency();
+    double deviation =
+        (static_cast<double>(coreFreq) - static_cast<double>(cal.cpu_freq_hz)) /
+        static_cast<double>(cal.cpu_freq_hz) * 100.0;
+    {
+      std::lock_guard<std::mutex> lock(printMutex);
+      std::cout << "  [core " << core << "] "
+                << (pinned ? "pinned" : "NOT pinned") << ", " << priority
+                << (realtime ? "" : " (NOT real-time)") << ", "
+                << std::fixed << std::setprecision(2) << (coreFreq / 1e9)
+                << " GHz (" << std::showpos << deviation << std::noshowpos
+                << "% vs calibration)"
+                << (std::fabs(deviation) > 2.0 ? "  WARNING: mismatch" : "")
+                << "\n";
+    }
 
-  // Dynamic patterns
-  struct DynamicPattern {
-    const char *name;
-    uint64_t ticks[6];
+    warmupCore();
+
+    while (true) {
+      size_t j = 0;
+      int iterations = 0;
+      {
+        std::unique_lock<std::mutex> lock(workMutex);
+        AdaptiveScheduler::Step step = AdaptiveScheduler::Step::Done;
+        workChanged.wait(lock, [&] {
+          step = scheduler.next(j, iterations);
+          return step != AdaptiveScheduler::Step::Wait;
+        });
+        if (step == AdaptiveScheduler::Step::Done)
+          break;
+      }
+      measureJob(jobs[j], iterations, results[j], raw, probes);
+      std::string progress;
+      {
+        std::lock_guard<std::mutex> lock(workMutex);
+        completeChunk(scheduler, j, results[j]);
+        onChunk(j);
+        progress = chunkProgress(scheduler, j);
+      }
+      workChanged.notify_all();
+      std::lock_guard<std::mutex> lock(printMutex);
+      std::cout << "  [core " << core << "] " << jobs[j].pattern->key << " ("
+                << formatSampleCount(iterations) << ")... done" << progress
+                << "\n";
+    }
   };
-  DynamicPattern dynamicPatterns[] = {
-      {"Original",
-       {cal.tick_minus1, cal.tick_minus1, cal.tick_center, cal.tick_plus1,
-        cal.tick_plus1, cal.tick_center}},
-      {"Alternating",
-       {cal.tick_plus1, cal.tick_minus1, cal.tick_plus1, cal.tick_minus1,
-        cal.tick_plus1, cal.tick_minus1}},
-      {"Block",
-       {cal.tick_plus1, cal.tick_plus1, cal.tick_plus1, cal.tick_minus1,
-        cal.tick_minus1, cal.tick_minus1}},
-      {"Mixed",
-       {cal.tick_center, cal.tick_minus1, cal.tick_plus1, cal.tick_center,
-        cal.tick_plus1, cal.tick_minus1}},
-      {"Sweep",
-       {cal.tick_minus1, cal.tick_center, cal.tick_plus1, cal.tick_plus1,
-        cal.tick_center, cal.tick_minus1}}};
-
-  // Storage for results
-  std::map<std::string, std::vector<int>> results;
-
-  // Part 1: Static Patterns (12 = 4 FFT x 3 Ticks)
-  std::cout << "Part 1: Static Patterns (12 = 4 FFT x 3 Ticks)\n";
-  std::cout << "--------------------------------------------\n";
-  std::cout
-      << "FFT Load: 75% (2.70us), 80% (2.88us), 85% (3.06us), 90% (3.24us)\n";
-  std::cout << "Tick Variation: -1 (276.3kHz), 0 (277.3kHz), +1 (278.3kHz)\n";
-  std::cout << "12 combinations x 1M samples each\n\n";
-
-  for (const auto &fft : fftConfigs) {
-    for (const auto &tick : tickConfigs) {
-      std::string key = std::string("FFT") + fft.name + " Tick" + tick.name;
-      std::cout << key << " (1M)...";
-      std::cout.flush();
 
-      std::vector<int> data;
-      data.reserve(iterations);
-      for (int i = 0; i < iterations; i++) {
-        data.push_back(measureSingle(tick.tick, fft.level));
+  std::vector<std::thread> threads;
+  for (int core : cores)
+    threads.emplace_back(worker, core);
+  for (auto &t : threads)
+    t.join();
+}
+
+// Full benchmark mode
+// With a non-empty core list the patterns are spread over pinned workers.
+// Returns 1 if the checkpoint to resume does not match this run.
+int runFullBenchmark(const CalibrationData &cal, const RunOptions &options) {
+  const std::vector<int> &cores = options.cores;
+  const QuantumLoadSpec &quantumLoad = options.quantumLoad;
+  // Every tick array is built here, before the first measurement
+  const PatternPlan plan = compilePatterns(options.patterns, cal);
+  const int iterations = plan.iterations;
+  const size_t dynamicCount = plan.patterns.size() - plan.staticCount;
+  const double centerPeriodUs = 1e6 / plan.centerHz;
+  const bool checkpointing = !options.checkpointPath.empty();
+  AdaptiveScheduler scheduler(plan.patterns.size(), iterations,
+                              options.adaptive,
+                              checkpointing ? CHECKPOINT_CHUNK : 0);
+
+  CheckpointFile checkpoint;
+  checkpoint.calibration =
+      checkpointCalibrationOf(cal, runContext(quantumLoad));
+  checkpoint.planHash = planHash(plan);
+  checkpoint.options = checkpointOptionsKey(options);
+  checkpoint.loads = plan.loads;
+  checkpoint.patterns.resize(plan.patterns.size());
+  if (options.resume) {
+    const CheckpointFile &saved = options.checkpoint;
+    if (saved.planHash != checkpoint.planHash ||
+        saved.patterns.size() != plan.patterns.size()) {
+      std::cout << "Error: the checkpoint was made with other patterns, "
+                   "loads or iterations\n";
+      return 1;
+    }
+    if (saved.options != checkpoint.options) {
+      std::cout << "Error: the checkpoint was made with other options\n"
+                << "  checkpoint: " << saved.options << "\n"
+                << "  this run:   " << checkpoint.options << "\n";
+      return 1;
+    }
+  }
+
+  std::cout << "\nTarget: " << std::fixed << std::setprecision(1)
+            << plan.centerHz / 1000.0 << " kHz region\n";
+  std::cout << "Base Period: " << std::setprecision(3) << centerPeriodUs
+            << " microseconds\n";
+  if (scheduler.enabled()) {
+    std::cout << "Iterations: adaptive, " << scheduler.minIterations()
+              << " to " << scheduler.maxIterations()
+              << " per pattern, budget " << scheduler.budget() << " ("
+              << iterations << " per pattern)\n";
+    std::cout << "Precision: mean +/- " << std::setprecision(2)
+              << options.adaptive.meanCi << " ops, peak share +/- "
+              << options.adaptive.peakCi << " points (z = "
+              << options.adaptive.z << ")\n";
+  } else {
+    std::cout << "Iterations: " << iterations << " per measurement\n";
+  }
+  std::cout << "Patterns: " << plan.patterns.size() << " ("
+            << plan.staticCount << " Static + " << dynamicCount
+            << " Dynamic)\n";
+  if (quantumLoad.qubits > 0) {
+    std::cout << "Quantum Load: " << quantumLoad.qubits << "-qubit register x "
+              << quantumLoad.layers << " layer(s)\n";
+  }
+  if (options.perf) {
+    // Probe on this thread; workers open their own counters per pattern
+    PerfCounterSet probe;
+    if (probe.open()) {
+      std::cout << "Perf Counters: " << probe.describe() << "\n";
+      if (!probe.error().empty())
+        std::cout << "  (" << probe.error() << ")\n";
+    } else {
+      std::cout << "Perf Counters: unavailable (" << probe.error()
+                << "), continuing without\n";
+    }
+  }
+  if (options.loadTiming) {
+    std::cout << "Load Timing: on (timer overhead " << cal.timer.overhead
+              << " cycles subtracted)\n";
+  }
+  if (options.amortizedBaseline) {
+    std::cout << "Baseline: amortized, one block of baseline windows per "
+              << AMORTIZED_BLOCK << " loaded samples, "
+              << AMORTIZED_CHECK_SAMPLES << " paired check samples after "
+              << "each\n";
+  }
+  if (options.spectrumWindow > 0) {
+    std::cout << "Spectrum: Welch, Hann window of " << options.spectrumWindow
+              << " samples, 50% overlap\n";
+  }
+  if (checkpointing) {
+    std::cout << "Checkpoint: " << options.checkpointPath << " every "
+              << options.checkpointSeconds << " s (chunks of "
+              << formatSampleCount(CHECKPOINT_CHUNK) << " samples)\n";
+  }
+  if (!cores.empty()) {
+    std::cout << "Parallel: " << cores.size() << " worker(s) on cores";
+    for (int c : cores)
+      std::cout << " " << c;
+    std::cout << "\n";
+  }
+  std::cout << "========================================================\n\n";
+
+  // Job list: static patterns first, then dynamic, each load-major
+  std::vector<BenchJob> jobs;
+  for (const auto &pattern : plan.patterns) {
+    jobs.push_back({&pattern, plan.loads[pattern.load], quantumLoad,
+                    amortizable(pattern.ticks)});
+  }
+
+  // Optional raw sample file
+  SampleFileWriter raw;
+  SampleFileWriter *rawOut = nullptr;
+  std::vector<SamplePatternInfo> rawInfos; // Referenced by jobs[].rawInfo
+  if (!options.rawOutPath.empty()) {
+    if (options.resume) {
+      // Drop blocks written after the checkpoint; they are measured again
+      std::error_code ec;
+      uintmax_t size = std::filesystem::file_size(options.rawOutPath, ec);
+      if (ec || size < options.checkpoint.rawBytes) {
+        std::cout << "Error: raw sample file " << options.rawOutPath
+                  << " is shorter than at the checkpoint\n";
+        return 1;
+      }
+      std::filesystem::resize_file(options.rawOutPath,
+                                   options.checkpoint.rawBytes, ec);
+      if (ec) {
+        std::cout << "Error: cannot truncate raw sample file "
+                  << options.rawOutPath << " to the checkpoint ("
+                  << ec.message() << ")\n";
+        return 1;
       }
-      results[key] = data;
-      std::cout << " done\n";
+    }
+    std::string error;
+    if (raw.open(options.rawOutPath, cal, error)) {
+      rawOut = &raw;
+      rawInfos = rawPatternInfos(plan);
+      for (size_t j = 0; j < jobs.size(); j++)
+        jobs[j].rawInfo = &rawInfos[j];
+      std::cout << "Raw samples: " << options.rawOutPath << "\n\n";
+    } else {
+      std::cout << "Warning: raw samples not kept (" << error << ")\n\n";
     }
   }
 
-  // Part 2: Dynamic Transition (20 = 4 FFT x 5 Patterns)
-  std::cout << "\nPart 2: Dynamic Transition (20 = 4 FFT x 5 Patterns)\n";
-  std::cout << "--------------------------------------------\n";
-  std::cout << "Patterns:\n";
-  std::cout << "  Original: -1->-1->0->+1->+1->0\n";
-  std::cout << "  Alternating: +1->-1->+1->-1->+1->-1\n";
-  std::cout << "  Block: +1->+1->+1->-1->-1->-1\n";
-  std::cout << "  Mixed: 0->-1->+1->0->+1->-1\n";
-  std::cout << "  Sweep: -1->0->+1->+1->0->-1\n";
-  std::cout << "20 combinations x 1M samples each\n\n";
+  // Per-pattern streaming statistics (constant memory per pattern)
+  std::vector<JobResult> results(jobs.size());
+  JobProbes probes;
+  probes.loadTiming = options.loadTiming;
+  probes.timerOverhead = cal.timer.overhead;
+  probes.perf = options.perf;
+  probes.spectrumWindow = options.spectrumWindow;
+  probes.amortizedBaseline = options.amortizedBaseline;
+  probes.adaptive = scheduler.enabled();
+  probes.deferRaw = checkpointing && rawOut;
+
+  if (options.resume) {
+    uint64_t restored = 0;
+    size_t finished = 0, started = 0;
+    for (size_t j = 0; j < jobs.size(); j++) {
+      const std::string &bytes = options.checkpoint.patterns[j];
+      if (bytes.empty())
+        continue;
+      AdaptiveJobState state;
+      if (!restoreJob(bytes, results[j], state)) {
+        std::cout << "Error: checkpoint state of " << jobs[j].pattern->key
+                  << " is corrupt\n";
+        return 1;
+      }
+      scheduler.restore(j, state);
+      checkpoint.patterns[j] = bytes;
+      restored += state.done;
+      started++;
+      finished += state.status != AdaptiveStatus::Running;
+    }
+    std::cout << "Resumed: " << finished << " pattern(s) finished, "
+              << started - finished << " in progress, " << restored
+              << " samples restored\n\n";
+  }
 
-  for (const auto &fft : fftConfigs) {
-    for (const auto &pattern : dynamicPatterns) {
-      std::string key =
-          std::string("Dynamic FFT") + fft.name + " " + pattern.name;
-      std::cout << key << " (1M)...";
-      std::cout.flush();
+  // Runs under the scheduler lock after every chunk: deferred raw blocks
+  // are written first, so the saved raw size only covers saved state
+  auto lastSave = std::chrono::steady_clock::now();
+  auto saveCheckpoint = [&]() {
+    checkpoint.rawBytes = rawOut ? rawOut->flushedSize() : 0;
+    if (rawOut && rawOut->failed()) {
+      // The raw file no longer holds every sample of the saved state
+      std::cout << "Warning: raw sample file write failed, checkpoint "
+                   "not updated\n";
+      return;
+    }
+    if (!checkpoint.save(options.checkpointPath))
+      std::cout << "Warning: cannot write checkpoint "
+                << options.checkpointPath << "\n";
+    lastSave = std::chrono::steady_clock::now();
+  };
+  auto onChunk = [&](size_t j) {
+    JobResult &r = results[j];
+    for (const PendingRawBlock &b : r.rawBlocks)
+      rawOut->writeBlock(*b.info, b.block);
+    r.rawBlocks.clear();
+    if (!checkpointing)
+      return;
+    checkpoint.patterns[j] = snapshotJob(r, scheduler.job(j));
+    if (std::chrono::steady_clock::now() - lastSave >=
+        std::chrono::seconds(options.checkpointSeconds))
+      saveCheckpoint();
+  };
+  auto analyzeJob = [&](size_t j) {
+    const JobResult &r = results[j];
+    AnalysisExtras extras;
+    extras.loadPhase = options.loadTiming ? &r.loadPhase : nullptr;
+    extras.cpuFreqHz = cal.cpu_freq_hz;
+    extras.perf = options.perf ? &r.perf : nullptr;
+    extras.spectrum = &r.spectrum;
+    bool amortized = options.amortizedBaseline && jobs[j].amortizable;
+    extras.sampleRateHz =
+        sampleRateOf(*jobs[j].pattern, cal.cpu_freq_hz, amortized);
+    extras.pairedCheck = amortized ? &r.pairedCheck : nullptr;
+    extras.pairedFallback = options.amortizedBaseline && !amortized;
+    extras.adaptive = scheduler.enabled() ? &scheduler.job(j) : nullptr;
+    analyze(jobs[j].pattern->key, r.samples, extras);
+  };
 
-      std::vector<int> data;
-      data.reserve(iterations);
-      for (int i = 0; i < iterations; i++) {
-        uint64_t tick = pattern.ticks[i % 6];
-        data.push_back(measureSingle(tick, fft.level));
+  const std::string perPattern =
+      scheduler.enabled()
+          ? " x adaptive sample counts\n"
+          : " x " + formatSampleCount(iterations) + " samples each\n";
+  auto printStaticHeader = [&]() {
+    if (plan.staticCount == 0)
+      return;
+    std::cout << "Part 1: Static Patterns (" << plan.staticCount << " = "
+              << plan.loads.size() << " FFT x "
+              << plan.staticCount / plan.loads.size() << " Ticks)\n";
+    std::cout << "--------------------------------------------\n";
+    std::cout << "FFT Load:";
+    for (size_t l = 0; l < plan.loads.size(); l++) {
+      const LoadSpec &load = plan.loads[l];
+      std::cout << (l ? ", " : " ") << load.name;
+      if (load.targetPercent > 0)
+        std::cout << " (" << std::setprecision(2)
+                  << load.targetPercent / 100.0 * centerPeriodUs << "us)";
+    }
+    std::cout << "\nTick Variation:";
+    bool first = true;
+    for (const auto &t : plan.templates) {
+      if (!t.dynamic) {
+        std::cout << (first ? " " : ", ") << t.description;
+        first = false;
       }
-      results[key] = data;
-      std::cout << " done\n";
     }
+    std::cout << "\n" << plan.staticCount << " combinations" << perPattern
+              << "\n";
+  };
+
+  auto printDynamicHeader = [&]() {
+    if (dynamicCount == 0)
+      return;
+    std::cout << "\nPart 2: Dynamic Transition (" << dynamicCount << " = "
+              << plan.loads.size() << " FFT x "
+              << dynamicCount / plan.loads.size() << " Patterns)\n";
+    std::cout << "--------------------------------------------\n";
+    std::cout << "Patterns:\n";
+    for (const auto &t : plan.templates) {
+      if (t.dynamic)
+        std::cout << "  " << t.name << ": " << t.description << "\n";
+    }
+    std::cout << dynamicCount << " combinations" << perPattern << "\n";
+  };
+
+  if (cores.empty()) {
+    // Warmup
+    std::cout << "Warming up...\n";
+    warmupCore();
+    std::cout << "Done.\n\n";
+
+    printStaticHeader();
+    size_t j = 0;
+    int chunk = 0;
+    bool dynamicHeader = false;
+    while (scheduler.next(j, chunk) == AdaptiveScheduler::Step::Chunk) {
+      const BenchJob &job = jobs[j];
+      if (j >= plan.staticCount && !dynamicHeader) {
+        printDynamicHeader();
+        dynamicHeader = true;
+      }
+      std::cout << job.pattern->key << " (" << formatSampleCount(chunk)
+                << ")...";
+      std::cout.flush();
+      measureJob(job, chunk, results[j], rawOut, probes);
+      completeChunk(scheduler, j, results[j]);
+      onChunk(j);
+      std::cout << " done" << chunkProgress(scheduler, j) << "\n";
+    }
+  } else {
+    printStaticHeader();
+    printDynamicHeader();
+    std::cout << "Starting workers...\n";
+    runJobsParallel(jobs, cores, cal, scheduler, results, rawOut, probes,
+                    onChunk);
   }
+  if (checkpointing)
+    saveCheckpoint();
+
+  if (scheduler.enabled()) {
+    int counts[6] = {};
+    for (size_t j = 0; j < jobs.size(); j++)
+      counts[static_cast<int>(scheduler.job(j).status)]++;
+    std::cout << "\nAdaptive: " << scheduler.assigned() << " of "
+              << scheduler.budget() << " budgeted samples ("
+              << std::setprecision(1)
+              << 100.0 * scheduler.assigned() / scheduler.budget() << "%), "
+              << counts[static_cast<int>(AdaptiveStatus::Converged)]
+              << " converged, "
+              << counts[static_cast<int>(AdaptiveStatus::AtMaximum)]
+              << " at maximum, "
+              << counts[static_cast<int>(AdaptiveStatus::Budget)]
+              << " out of budget\n";
+  }
+  if (rawOut && rawOut->failed())
+    std::cout << "\nWarning: cannot write raw samples to "
+              << options.rawOutPath << "; the file is incomplete\n";
 
   // Analysis
   std::cout << "\n========================================================\n";
   std::cout << "Statistical Analysis\n";
   std::cout << "========================================================\n\n";
 
-  // Static analysis
-  for (const auto &fft : fftConfigs) {
-    std::cout << "--- FFT " << fft.name << " + Tick Variations ---\n\n";
-    for (const auto &tick : tickConfigs) {
-      std::string key = std::string("FFT") + fft.name + " Tick" + tick.name;
-      analyze(key, results[key]);
+  // Static analysis, grouped by load
+  for (size_t j = 0; j < plan.staticCount; j++) {
+    const CompiledPattern &pattern = *jobs[j].pattern;
+    if (j == 0 || jobs[j - 1].pattern->load != pattern.load) {
+      std::cout << "--- FFT " << plan.loads[pattern.load].name
+                << " + Tick Variations ---\n\n";
     }
+    analyzeJob(j);
   }
 
   // Dynamic analysis
-  std::cout << "--- Dynamic Transition (5 patterns x 4 FFT) ---\n\n";
-  for (const auto &fft : fftConfigs) {
-    for (const auto &pattern : dynamicPatterns) {
-      std::string key =
-          std::string("Dynamic FFT") + fft.name + " " + pattern.name;
-      analyze(key, results[key]);
-    }
+  if (dynamicCount > 0) {
+    std::cout << "--- Dynamic Transition (" << dynamicCount / plan.loads.size()
+              << " patterns x " << plan.loads.size() << " FFT) ---\n\n";
+  }
+  for (size_t j = plan.staticCount; j < jobs.size(); j++) {
+    analyzeJob(j);
+  }
+
+  if (!options.spectrumOutPath.empty()) {
+    if (writeSpectrumCsv(options.spectrumOutPath, jobs, results,
+                         cal.cpu_freq_hz, options.amortizedBaseline))
+      std::cout << "Spectra written to " << options.spectrumOutPath << "\n";
+    else
+      std::cout << "Warning: cannot write " << options.spectrumOutPath
+                << "\n";
   }
 
   std::cout << "========================================================\n";
   std::cout << "Done.\n";
+  return 0;
 }
 
 int main(int argc, char *argv[]) {
-  setHighPriority();
-
-  // Check for scheduled mode
+  // Check for scheduled / parallel mode
   bool scheduledMode = false;
+  bool parallelMode = false;
+  std::vector<int> cores;
+  bool circuitReport = false;
+  QuantumLoadSpec quantumLoad;
+  std::string rawOutPath;
+  int logCore = -1;
+  int fsyncIntervalMs = 0;
+  std::vector<ScheduleTrigger> triggers;
+  int scanSeconds = 120;
+  int prewarmMs = 500;
+  bool loadTiming = false;
+  bool perf = false;
+  int spectrumWindow = 0;
+  std::string spectrumOutPath;
+  bool amortizedBaseline = false;
+  AdaptiveOptions adaptive;
+  std::string checkpointPath;
+  int checkpointSeconds = 60;
+  std::string resumePath;
+  MetricsServerOptions metricsOptions;
+  EnvironmentOptions envOptions;
+  SampleArenaOptions arenaOptions;
+  bool strictEnv = false;
+  CalibrationOptions calibrationOptions;
+  PatternConfig patterns = defaultPatternConfig();
+  bool listPatterns = false;
+  LoadTuneOptions loadTuneOptions;
   for (int i = 1; i < argc; i++) {
     std::string arg = argv[i];
     if (arg == "--scheduled" || arg == "-s") {
       scheduledMode = true;
+    } else if (arg == "--parallel" || arg == "-p") {
+      parallelMode = true;
+    } else if (arg == "--cores" && i + 1 < argc) {
+      // e.g. --cores 2,3,8-11 (implies --parallel)
+      std::string error;
+      if (!parseCoreList(argv[++i], cores, error)) {
+        std::cout << "Error: --cores: " << error << "\n";
+        return 1;
+      }
+      parallelMode = true;
+    } else if (arg == "--qubits" && i + 1 < argc) {
+      // N-qubit register load instead of the single-qubit circuit
+      std::string error;
+      if (!parseIntArg(argv[++i], 0, QUBIT_REGISTER_MAX, quantumLoad.qubits,
+                       error)) {
+        std::cout << "Error: --qubits: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--qubit-layers" && i + 1 < argc) {
+      std::string error;
+      if (!parseIntArg(argv[++i], 1, 1000000, quantumLoad.layers, error)) {
+        std::cout << "Error: --qubit-layers: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--fused") {
+      // Run the quantum load from its fused (precomputed 2x2) circuit
+      quantumLoad.mode = CircuitMode::Fused;
+    } else if (arg == "--measure-core" && i + 1 < argc) {
+      // Core for the measuring thread (default: the one we start on)
+      std::string error;
+      if (!parseCore(argv[++i], envOptions.measureCore, error)) {
+        std::cout << "Error: --measure-core: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--no-mlock") {
+      envOptions.lockMemory = false;
+    } else if (arg == "--no-huge-pages") {
+      // Scheduled-mode sample arena on normal pages
+      arenaOptions.hugePages = false;
+    } else if (arg == "--strict-env") {
+      // Refuse to run when the environment is known to be noisy
+      strictEnv = true;
+    } else if (arg == "--recalibrate") {
+      // Ignore the cached calibration and measure again
+      calibrationOptions.recalibrate = true;
+    } else if (arg == "--no-calibration-cache") {
+      calibrationOptions.useCache = false;
+    } else if (arg == "--calibration-cache" && i + 1 < argc) {
+      calibrationOptions.cachePath = argv[++i];
+    } else if ((arg == "--config" || arg == "--pattern" || arg == "--sweep" ||
+                arg == "--iterations") &&
+               i + 1 < argc) {
+      // Pattern config file, or one config line from the command line
+      std::string value = argv[++i];
+      std::string error;
+      bool ok;
+      if (arg == "--config") {
+        ok = loadPatternConfig(patterns, value, error);
+      } else {
+        std::string line = value;
+        if (arg == "--iterations") {
+          line = "iterations " + value;
+        } else if (arg == "--sweep") {
+          // FROM:TO:STEP in kHz
+          std::replace(value.begin(), value.end(), ':', ' ');
+          std::stringstream ss(value);
+          std::string from, to, step;
+          ss >> from >> to >> step;
+          line = "sweep from=" + from + " to=" + to + " step=" + step;
+        }
+        ok = parsePatternLine(patterns, line, error);
+        if (!ok)
+          error = arg + " '" + argv[i] + "': " + error;
+      }
+      if (!ok) {
+        std::cout << "Error: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--no-load-tune") {
+      // Keep the configured FFT sizes and repeat counts as they are
+      loadTuneOptions.enabled = false;
+    } else if (arg == "--load-tolerance" && i + 1 < argc) {
+      // Allowed distance from each load's target, in percentage points
+      std::string error;
+      if (!parseDoubleArg(argv[++i], 0.1, 100.0,
+                          loadTuneOptions.tolerancePercent, error)) {
+        std::cout << "Error: --load-tolerance: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--list-patterns") {
+      listPatterns = true;
+    } else if (arg == "--perf") {
+      // Hardware/software counters per pattern (Linux perf_event)
+      perf = true;
+    } else if (arg == "--load-timing") {
+      // Time the FFT + quantum phase of every sample (full mode)
+      loadTiming = true;
+    } else if (arg == "--amortized-baseline") {
+      // Baseline windows in blocks, shared by many loaded samples
+      amortizedBaseline = true;
+    } else if (arg == "--adaptive") {
+      // Stop each pattern once its confidence intervals are narrow enough
+      adaptive.enabled = true;
+    } else if (arg == "--adaptive-mean-ci" && i + 1 < argc) {
+      adaptive.enabled = true;
+      std::string error;
+      if (!parseDoubleArg(argv[++i], 0.0, 1e9, adaptive.meanCi, error)) {
+        std::cout << "Error: --adaptive-mean-ci: " << error << "\n";
+        return 1;
+      }
+      if (adaptive.meanCi <= 0.0) {
+        std::cout << "Error: --adaptive-mean-ci must be positive\n";
+        return 1;
+      }
+    } else if (arg == "--adaptive-peak-ci" && i + 1 < argc) {
+      adaptive.enabled = true;
+      std::string error;
+      if (!parseDoubleArg(argv[++i], 0.0, 100.0, adaptive.peakCi, error)) {
+        std::cout << "Error: --adaptive-peak-ci: " << error << "\n";
+        return 1;
+      }
+      if (adaptive.peakCi <= 0.0) {
+        std::cout << "Error: --adaptive-peak-ci must be positive\n";
+        return 1;
+      }
+    } else if (arg == "--adaptive-min" && i + 1 < argc) {
+      adaptive.enabled = true;
+      std::string error;
+      if (!parseIntArg(argv[++i], 1, INT_MAX, adaptive.minIterations,
+                       error)) {
+        std::cout << "Error: --adaptive-min: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--adaptive-max" && i + 1 < argc) {
+      adaptive.enabled = true;
+      std::string error;
+      if (!parseIntArg(argv[++i], 1, INT_MAX, adaptive.maxIterations,
+                       error)) {
+        std::cout << "Error: --adaptive-max: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--metrics-port" && i + 1 < argc) {
+      // Serve scheduled-mode metrics for Prometheus on this port
+      std::string error;
+      if (!parseIntArg(argv[++i], 1, 65535, metricsOptions.port, error)) {
+        std::cout << "Error: --metrics-port: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--metrics-bind" && i + 1 < argc) {
+      metricsOptions.bind = argv[++i];
+    } else if (arg == "--checkpoint" && i + 1 < argc) {
+      // Save the full benchmark's progress to a file as it runs
+      checkpointPath = argv[++i];
+    } else if (arg == "--checkpoint-seconds" && i + 1 < argc) {
+      std::string error;
+      if (!parseIntArg(argv[++i], 0, 86400, checkpointSeconds, error)) {
+        std::cout << "Error: --checkpoint-seconds: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--resume" && i + 1 < argc) {
+      // Continue a full benchmark from its checkpoint file
+      resumePath = argv[++i];
+    } else if (arg == "--spectrum") {
+      // Welch power spectrum of each pattern's sample sequence (full mode)
+      if (spectrumWindow == 0)
+        spectrumWindow = SPECTRUM_DEFAULT_WINDOW;
+    } else if (arg == "--spectrum-window" && i + 1 < argc) {
+      std::string error;
+      if (!parseIntArg(argv[++i], 16, 1 << 24, spectrumWindow, error)) {
+        std::cout << "Error: --spectrum-window: " << error << "\n";
+        return 1;
+      }
+      if (spectrumWindow & (spectrumWindow - 1)) {
+        std::cout << "Error: --spectrum-window must be a power of two >= 16\n";
+        return 1;
+      }
+    } else if (arg == "--spectrum-out" && i + 1 < argc) {
+      spectrumOutPath = argv[++i];
+      if (spectrumWindow == 0)
+        spectrumWindow = SPECTRUM_DEFAULT_WINDOW;
+    } else if (arg == "--circuit-report") {
+      circuitReport = true;
+    } else if (arg == "--raw-out" && i + 1 < argc) {
+      // Keep every sample in a binary sample file
+      rawOutPath = argv[++i];
+    } else if (arg == "--analyze-raw" && i + 1 < argc) {
+      return analyzeRawFile(argv[++i]);
+    } else if (arg == "--log-core" && i + 1 < argc) {
+      // Pin the scheduled-mode log writer to a housekeeping core
+      std::string error;
+      if (!parseCore(argv[++i], logCore, error)) {
+        std::cout << "Error: --log-core: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--fsync-ms" && i + 1 < argc) {
+      // fsync the scheduled-mode CSV at most every N ms (0 = never)
+      std::string error;
+      if (!parseIntArg(argv[++i], 0, 3600000, fsyncIntervalMs, error)) {
+        std::cout << "Error: --fsync-ms: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--trigger" && i + 1 < argc) {
+      // Scheduled-mode scan start, e.g. "*:29:00" (repeatable)
+      ScheduleTrigger trigger;
+      if (parseScheduleTrigger(argv[++i], trigger)) {
+        triggers.push_back(trigger);
+      } else {
+        std::cout << "Warning: ignoring bad trigger '" << argv[i] << "'\n";
+      }
+    } else if (arg == "--scan-seconds" && i + 1 < argc) {
+      std::string error;
+      if (!parseIntArg(argv[++i], 1, 3600, scanSeconds, error)) {
+        std::cout << "Error: --scan-seconds: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--prewarm-ms" && i + 1 < argc) {
+      std::string error;
+      if (!parseIntArg(argv[++i], 0, 60000, prewarmMs, error)) {
+        std::cout << "Error: --prewarm-ms: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--simd" && i + 1 < argc) {
+      // Force a kernel level: scalar, avx2, avx512 or neon
+      std::string name = argv[++i];
+      SimdLevel level;
+      if (!parseSimdLevel(name, level) || !setSimdLevel(level)) {
+        std::cout << "Warning: SIMD level '" << name
+                  << "' not available, using "
+                  << simdLevelName(activeSimdLevel()) << "\n";
+      }
+    }
+  }
+  if (adaptive.minIterations > 0 && adaptive.maxIterations > 0 &&
+      adaptive.minIterations > adaptive.maxIterations) {
+    std::cout << "Error: --adaptive-min " << adaptive.minIterations
+              << " is above --adaptive-max " << adaptive.maxIterations
+              << "\n";
+    return 1;
+  }
+  if (parallelMode && cores.empty()) {
+    cores = defaultParallelCores();
+  }
+  if (quantumLoad.qubits > 0) {
+    // Every thread that runs the load keeps its own register, locked in
+    // memory; in parallel mode this thread (load tuning) holds one too
+    uint64_t threads = parallelMode ? cores.size() + 1 : 1;
+    uint64_t needed = qubitRegisterBytes(quantumLoad.qubits) * threads;
+    uint64_t available = availableMemoryBytes();
+    if (available > 0 && needed > available) {
+      std::cout << "Error: --qubits " << quantumLoad.qubits << " needs "
+                << std::fixed << std::setprecision(1)
+                << needed / (1024.0 * 1024 * 1024) << " GiB for " << threads
+                << " measuring thread(s), "
+                << available / (1024.0 * 1024 * 1024) << " GiB available\n";
+      return 1;
     }
   }
 
+  // Parallel workers pin themselves; otherwise this thread measures
+  envOptions.pin = !parallelMode;
+  EnvironmentReport environment = applyRunEnvironment(envOptions);
+
   std::cout << "=== Quantum Transition Measurement (Cross-Platform) ===\n";
+  printRunEnvironment(environment);
+  if (strictEnv && !environment.warnings.empty()) {
+    std::cout << "Refusing to run in a noisy environment (--strict-env)\n";
+    return 2;
+  }
+  std::cout << "\n";
   std::cout << "Auto-calibrating for your CPU...\n\n";
 
-  CalibrationData cal = calibrateCPU();
+  CalibrationReport calibrationReport;
+  CalibrationData cal =
+      calibrateCPUCached(calibrationOptions, calibrationReport);
+  printCalibrationReport(calibrationReport);
   printCalibrationInfo(cal);
 
+  // Check the dispatched FFT kernels against the scalar reference
+  double fftError = 0.0;
+  bool fftOk = verifyFFTKernels(fftError);
+  std::cout << "SIMD kernels: " << simdLevelName(activeSimdLevel())
+            << " (FFT check " << (fftOk ? "OK" : "FAILED") << ", max error "
+            << std::scientific << std::setprecision(1) << fftError
+            << std::fixed << ")\n";
+  double gateError = 0.0;
+  bool gateOk = verifyGateKernels(gateError);
+  std::cout << "              (gate check " << (gateOk ? "OK" : "FAILED")
+            << ", max error " << std::scientific << std::setprecision(1)
+            << gateError << std::fixed << ")\n";
+  if (!fftOk || !gateOk) {
+    std::cout << "Warning: falling back to scalar kernels\n";
+    setSimdLevel(SimdLevel::Scalar);
+  }
+  if (quantumLoad.qubits > 0) {
+    std::cout << "Quantum load: " << quantumLoad.qubits << " qubits, "
+              << quantumLoad.layers << " layer(s), "
+              << (16.0 * (1ULL << quantumLoad.qubits) / 1024.0)
+              << " KiB state\n";
+  }
+  // Built here, before any load is timed
+  prepareQuantumLoad(quantumLoad);
+  if (quantumLoad.mode == CircuitMode::Fused) {
+    std::cout << "Quantum load circuit: fused\n";
+  }
+
+  // A resumed run keeps the checkpoint's calibration, so the patterns
+  // compile to the same ticks
+  CheckpointFile checkpoint;
+  if (scheduledMode && !checkpointPath.empty())
+    std::cout << "Warning: --checkpoint applies to the full benchmark only\n";
+  if (!scheduledMode && metricsOptions.port > 0)
+    std::cout << "Warning: --metrics-port applies to scheduled mode only\n";
+  if (!scheduledMode && !arenaOptions.hugePages)
+    std::cout << "Warning: --no-huge-pages applies to scheduled mode only\n";
+  if (!resumePath.empty()) {
+    std::string error;
+    if (scheduledMode) {
+      std::cout << "Error: --resume applies to the full benchmark only\n";
+      return 1;
+    }
+    if (!checkpoint.load(resumePath, error) ||
+        !adoptCheckpointCalibration(checkpoint.calibration,
+                                    runContext(quantumLoad), cal, error)) {
+      std::cout << "Error: cannot resume: " << error << "\n";
+      return 1;
+    }
+    std::cout << "Resume: " << resumePath << ", calibration "
+              << cal.cpu_freq_hz << " Hz, tick center " << cal.tick_center
+              << "\n";
+    if (checkpointPath.empty())
+      checkpointPath = resumePath;
+  }
+
+  if (circuitReport) {
+    reportCircuitCosts(cal, quantumLoad);
+    return 0;
+  }
+  // Size the FFT loads for this host's clock and kernels
+  loadTuneOptions.useCache = calibrationOptions.useCache;
+  loadTuneOptions.retune = calibrationOptions.recalibrate;
+  loadTuneOptions.cachePath = calibrationReport.cachePath;
+  // The load percentages refer to the plan's center, not necessarily
+  // 277.3 kHz
+  uint64_t centerTick = std::max<uint64_t>(
+      1, calculateTicksFromFrequency(cal.cpu_freq_hz, patterns.centerHz));
+  if (!resumePath.empty()) {
+    // Measure with the shapes the checkpoint was made with
+    std::string error;
+    if (!applyCheckpointLoads(checkpoint.loads, patterns.loads, error)) {
+      std::cout << "Error: cannot resume: " << error << "\n";
+      return 1;
+    }
+    std::cout << "Load tuning: from the checkpoint\n";
+    for (const LoadSpec &load : patterns.loads)
+      std::cout << "  " << load.name << ": FFT " << load.fftSize << " x "
+                << load.repeats << "\n";
+  } else {
+    LoadTuneReport loadTune = tuneLoads(patterns.loads, cal, centerTick,
+                                        quantumLoad, loadTuneOptions);
+    printLoadTuneReport(loadTune);
+  }
+
+  if (listPatterns) {
+    printPatternPlan(compilePatterns(patterns, cal));
+    return 0;
+  }
+
+  RunOptions options;
+  options.cores = parallelMode ? cores : std::vector<int>{};
+  options.quantumLoad = quantumLoad;
+  options.rawOutPath = rawOutPath;
+  options.logCore = logCore;
+  options.measureCore = environment.pinned ? environment.core : -1;
+  options.fsyncIntervalMs = fsyncIntervalMs;
+  options.triggers = triggers;
+  if (options.triggers.empty()) {
+    // 2-minute scans across every XX:00 and XX:30 boundary
+    options.triggers = {{-1, 29, 0}, {-1, 59, 0}};
+  }
+  options.scanSeconds = scanSeconds;
+  options.prewarmMs = prewarmMs;
+  options.metrics = metricsOptions;
+  options.arena = arenaOptions;
+  options.arena.lock = envOptions.lockMemory;
+  options.loadTiming = loadTiming;
+  options.perf = perf;
+  options.spectrumWindow = spectrumWindow;
+  options.spectrumOutPath = spectrumOutPath;
+  options.amortizedBaseline = amortizedBaseline;
+  options.adaptive = adaptive;
+  options.checkpointPath = checkpointPath;
+  options.checkpointSeconds = checkpointSeconds;
+  options.resume = !resumePath.empty();
+  options.checkpoint = checkpoint;
+  options.patterns = patterns;
+
   if (scheduledMode) {
-    runScheduledMode(cal);
+    runScheduledMode(cal, options);
   } else {
-    runFullBenchmark(cal);
+    return runFullBenchmark(cal, options);
   }
 
   return 0;
@@ -0,0 +1,478 @@
+// Microbenchmarks for the kernels that make up the benchmark's load.
+// Each case runs its operation in batches sized to take at least
+// --min-batch-us, after a warmup; every repetition gives one per-operation
+// cost in counter ticks (cycleStart/cycleStop, net of the timer overhead) and
+// in nanoseconds (steady_clock). The median and the median absolute
+// deviation of the repetitions are reported as a table, and optionally as
+// CSV or JSON for tracking. --baseline compares against an earlier CSV and
+// exits with 2 if any case got slower than --max-regression percent.
+
+// QuantumLib.hpp first: it defines _USE_MATH_DEFINES before <cmath>
+#include "QuantumLib.hpp"
+#include "CommandLine.hpp"
+#include "PatternConfig.hpp"
+#include "RunEnvironment.hpp"
+#include "SampleStats.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ========== Harness ==========
+
+// Keep the compiler from dropping or folding work on `value`
+template <typename T> inline void keepAlive(T &value) {
+#if defined(_MSC_VER) && !defined(__clang__)
+  static volatile const void *escape;
+  escape = &value;
+  _ReadWriteBarrier();
+#else
+  asm volatile("" : : "r"(&value) : "memory");
+#endif
+}
+
+struct MicroCase {
+  std::string name;
+  std::function<void(uint64_t)> run; // Perform the operation n times
+};
+
+struct MicroOptions {
+  std::string filter;       // Substring of the case names to run
+  int repetitions = 31;
+  int warmupMs = 100;       // Per case
+  double minBatchUs = 200.0;
+  std::string csvPath;      // "-" = stdout
+  std::string jsonPath;
+  std::string baselinePath; // Earlier --csv output
+  double maxRegression = 10.0; // Percent, against the baseline median
+};
+
+struct MicroResult {
+  std::string name;
+  uint64_t batch = 0; // Operations per repetition
+  int repetitions = 0;
+  double medianCycles = 0.0;
+  double madCycles = 0.0;
+  double medianNs = 0.0;
+  double madNs = 0.0;
+  double minNs = 0.0;
+};
+
+// Median and median absolute deviation
+inline void medianAndMad(std::vector<double> v, double &median,
+                         double &mad) {
+  size_t mid = v.size() / 2;
+  std::nth_element(v.begin(), v.begin() + mid, v.end());
+  median = v[mid];
+  for (double &x : v)
+    x = std::fabs(x - median);
+  std::nth_element(v.begin(), v.begin() + mid, v.end());
+  mad = v[mid];
+}
+
+inline MicroResult runCase(const MicroCase &c, const MicroOptions &opt,
+                           uint64_t timerOverhead) {
+  using Clock = std::chrono::steady_clock;
+  auto nsSince = [](Clock::time_point t0) {
+    return std::chrono::duration<double, std::nano>(Clock::now() - t0)
+        .count();
+  };
+
+  // Grow the batch until one takes long enough that timer cost and
+  // resolution do not matter, then warm up at that size. The first call
+  // builds plans and touches buffers, so it is not used for sizing.
+  c.run(1);
+  uint64_t batch = 1;
+  for (;;) {
+    auto t0 = Clock::now();
+    c.run(batch);
+    if (nsSince(t0) >= opt.minBatchUs * 1000.0 || batch >= (1ULL << 40))
+      break;
+    batch *= 2;
+  }
+  auto warmStart = Clock::now();
+  do {
+    c.run(batch);
+  } while (nsSince(warmStart) < opt.warmupMs * 1e6);
+
+  std::vector<double> cycles(opt.repetitions), ns(opt.repetitions);
+  for (int r = 0; r < opt.repetitions; r++) {
+    auto t0 = Clock::now();
+    uint64_t c0 = cycleStart();
+    c.run(batch);
+    uint64_t c1 = cycleStop();
+    ns[r] = nsSince(t0) / static_cast<double>(batch);
+    uint64_t elapsed = c1 - c0;
+    elapsed = elapsed > timerOverhead ? elapsed - timerOverhead : 0;
+    cycles[r] = static_cast<double>(elapsed) / static_cast<double>(batch);
+  }
+
+  MicroResult res;
+  res.name = c.name;
+  res.batch = batch;
+  res.repetitions = opt.repetitions;
+  medianAndMad(cycles, res.medianCycles, res.madCycles);
+  medianAndMad(ns, res.medianNs, res.madNs);
+  res.minNs = *std::min_element(ns.begin(), ns.end());
+  return res;
+}
+
+// ========== Cases ==========
+
+inline std::vector<MicroCase> buildCases() {
+  std::vector<MicroCase> cases;
+  volatile double &sink = loadKernelSink();
+
+  cases.push_back({"timer/getCycleCount", [](uint64_t n) {
+                     uint64_t sum = 0;
+                     for (uint64_t i = 0; i < n; i++)
+                       sum += getCycleCount();
+                     keepAlive(sum);
+                   }});
+  cases.push_back({"timer/cycleStart+cycleStop", [](uint64_t n) {
+                     uint64_t sum = 0;
+                     for (uint64_t i = 0; i < n; i++) {
+                       uint64_t t0 = cycleStart();
+                       sum += cycleStop() - t0;
+                     }
+                     keepAlive(sum);
+                   }});
+
+  // Forward and inverse transforms alternate, so the data stays bounded
+  for (int n : {16, 64, 128, 256, 1024, 4096}) {
+    cases.push_back({"fft/" + std::to_string(n), [n, &sink](uint64_t count) {
+                       std::vector<FFTComplex> data(n);
+                       const FFTPlan &plan = getFFTPlan(n);
+                       for (int i = 0; i < n; i++)
+                         data[i] = FFTComplex(plan.testSignalRe()[i], 0.0);
+                       for (uint64_t i = 0; i < count; i++)
+                         fft(data.data(), n, (i & 1) != 0);
+                       sink = data[1].re;
+                     }});
+  }
+
+  // One gate per operation, applied over and over to the same qubit
+  auto gate = [&](const std::string &name, void (*apply)(Qubit &)) {
+    cases.push_back({"qubit/" + name, [apply, &sink](uint64_t n) {
+                       Qubit q;
+                       q.applyHadamard();
+                       for (uint64_t i = 0; i < n; i++) {
+                         apply(q);
+                         keepAlive(q);
+                       }
+                       sink = q.getAlpha().real;
+                     }});
+  };
+  gate("applyHadamard", [](Qubit &q) { q.applyHadamard(); });
+  gate("applyX", [](Qubit &q) { q.applyX(); });
+  gate("applyZ", [](Qubit &q) { q.applyZ(); });
+  gate("applyS", [](Qubit &q) { q.applyS(); });
+  gate("applyT", [](Qubit &q) { q.applyT(); });
+  gate("applyRY", [](Qubit &q) { q.applyRY(0.3); });
+  gate("applyMatrix", [](Qubit &q) {
+    static const double h[8] = {0.70710678118,  0.0, 0.70710678118, 0.0,
+                                0.70710678118,  0.0, -0.70710678118, 0.0};
+    q.applyMatrix(h);
+  });
+  gate("measure", [](Qubit &q) {
+    volatile int bit = q.measure();
+    (void)bit;
+  });
+
+  cases.push_back({"quantum/performQuantumLoad", [&sink](uint64_t n) {
+                     int bits = 0;
+                     for (uint64_t i = 0; i < n; i++)
+                       bits += performQuantumLoad(CircuitMode::Interpreted);
+                     sink = bits;
+                   }});
+  cases.push_back({"quantum/performQuantumLoad_fused", [&sink](uint64_t n) {
+                     int bits = 0;
+                     for (uint64_t i = 0; i < n; i++)
+                       bits += performQuantumLoad(CircuitMode::Fused);
+                     sink = bits;
+                   }});
+  cases.push_back({"quantum/register_10x1_fused", [&sink](uint64_t n) {
+                     uint64_t bits = 0;
+                     for (uint64_t i = 0; i < n; i++)
+                       bits += performQuantumRegisterLoad(10, 1,
+                                                          CircuitMode::Fused);
+                     sink = static_cast<double>(bits);
+                   }});
+
+  // The loaded phase of each built-in load, through the kernel that
+  // quantum_benchmark measures with
+  for (const LoadSpec &load : defaultPatternConfig().loads) {
+    std::string name = "load/" + load.name + "_" +
+                       std::to_string(load.fftSize) + "x" +
+                       std::to_string(load.repeats);
+    cases.push_back({name, [load](uint64_t n) {
+                       QuantumLoadSpec quantum;
+                       LoadKernelFn kernel = findLoadKernel(load, quantum);
+                       LoadKernelArgs args = makeLoadKernelArgs(load, quantum);
+                       for (uint64_t i = 0; i < n; i++)
+                         kernel(args);
+                     }});
+  }
+
+  // The analysis path, on 1M samples shaped like a loaded pattern.
+  // One operation is one pass over the whole buffer.
+  auto samples = std::make_shared<std::vector<int>>(1 << 20);
+  std::mt19937 rng(12345);
+  std::normal_distribution<double> shape(160.0, 15.0);
+  for (int &v : *samples)
+    v = static_cast<int>(shape(rng));
+  cases.push_back({"analyze/add_1M", [samples, &sink](uint64_t n) {
+                     for (uint64_t i = 0; i < n; i++) {
+                       SampleAccumulator acc;
+                       for (int v : *samples)
+                         acc.add(v);
+                       sink = acc.mean;
+                     }
+                   }});
+  cases.push_back({"analyze/computeSampleStats_1M",
+                   [samples, &sink](uint64_t n) {
+                     for (uint64_t i = 0; i < n; i++)
+                       sink = computeSampleStats(*samples, 1).mean;
+                   }});
+  cases.push_back(
+      {"analyze/exactPercentiles_1M", [samples, &sink](uint64_t n) {
+         SampleAccumulator acc = computeSampleStats(*samples, 1);
+         for (uint64_t i = 0; i < n; i++)
+           sink = exactPercentiles(*samples, acc, {50.0, 90.0, 99.0, 99.9})
+                      .back();
+       }});
+  return cases;
+}
+
+// ========== Output ==========
+
+inline void printTable(const std::vector<MicroResult> &results) {
+  std::cout << std::left << std::setw(36) << "case" << std::right
+            << std::setw(14) << "cycles/op" << std::setw(10) << "MAD"
+            << std::setw(14) << "ns/op" << std::setw(10) << "MAD"
+            << std::setw(12) << "batch" << "\n";
+  for (const auto &r : results) {
+    std::cout << std::left << std::setw(36) << r.name << std::right
+              << std::fixed << std::setprecision(2) << std::setw(14)
+              << r.medianCycles << std::setw(10) << r.madCycles
+              << std::setw(14) << r.medianNs << std::setw(10) << r.madNs
+              << std::setw(12) << r.batch << "\n";
+  }
+}
+
+inline void writeCsv(std::ostream &out,
+                     const std::vector<MicroResult> &results) {
+  out << "name,batch,repetitions,median_cycles,mad_cycles,median_ns,mad_ns,"
+         "min_ns\n";
+  out << std::setprecision(4) << std::fixed;
+  for (const auto &r : results)
+    out << r.name << "," << r.batch << "," << r.repetitions << ","
+        << r.medianCycles << "," << r.madCycles << "," << r.medianNs << ","
+        << r.madNs << "," << r.minNs << "\n";
+}
+
+inline void writeJson(std::ostream &out,
+                      const std::vector<MicroResult> &results,
+                      double counterGHz) {
+  out << std::setprecision(4) << std::fixed;
+  out << "{\n  \"timer\": \"" << cycleTimerName() << "\",\n"
+      << "  \"counter_ghz\": " << counterGHz << ",\n"
+      << "  \"simd\": \"" << simdLevelName(activeSimdLevel()) << "\",\n"
+      << "  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    const auto &r = results[i];
+    out << "    {\"name\": \"" << r.name << "\", \"batch\": " << r.batch
+        << ", \"repetitions\": " << r.repetitions
+        << ", \"median_cycles\": " << r.medianCycles
+        << ", \"mad_cycles\": " << r.madCycles
+        << ", \"median_ns\": " << r.medianNs << ", \"mad_ns\": " << r.madNs
+        << ", \"min_ns\": " << r.minNs << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+}
+
+// Write to a file, or to stdout for "-"
+template <typename Fn>
+inline bool writeOutput(const std::string &path, Fn write) {
+  if (path == "-") {
+    write(std::cout);
+    return true;
+  }
+  std::ofstream out(path);
+  if (!out)
+    return false;
+  write(out);
+  return static_cast<bool>(out);
+}
+
+// median_ns per case name from an earlier --csv output
+inline bool readBaseline(const std::string &path,
+                         std::map<std::string, double> &medianNs) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+  std::string line;
+  std::getline(in, line); // Header
+  while (std::getline(in, line)) {
+    std::vector<std::string> fields;
+    std::stringstream ss(line);
+    std::string field;
+    while (std::getline(ss, field, ','))
+      fields.push_back(field);
+    if (fields.size() >= 6)
+      medianNs[fields[0]] = std::atof(fields[5].c_str());
+  }
+  return true;
+}
+
+// ========== Main ==========
+
+int main(int argc, char *argv[]) {
+  MicroOptions opt;
+  bool list = false;
+  int core = -1;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--filter" && i + 1 < argc) {
+      opt.filter = argv[++i];
+    } else if (arg == "--list") {
+      list = true;
+    } else if (arg == "--repetitions" && i + 1 < argc) {
+      std::string error;
+      if (!parseIntArg(argv[++i], 1, 100000, opt.repetitions, error)) {
+        std::cout << "Error: --repetitions: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--warmup-ms" && i + 1 < argc) {
+      std::string error;
+      if (!parseIntArg(argv[++i], 0, 600000, opt.warmupMs, error)) {
+        std::cout << "Error: --warmup-ms: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--min-batch-us" && i + 1 < argc) {
+      std::string error;
+      if (!parseDoubleArg(argv[++i], 1.0, 1e7, opt.minBatchUs, error)) {
+        std::cout << "Error: --min-batch-us: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--csv" && i + 1 < argc) {
+      opt.csvPath = argv[++i];
+    } else if (arg == "--json" && i + 1 < argc) {
+      opt.jsonPath = argv[++i];
+    } else if (arg == "--baseline" && i + 1 < argc) {
+      opt.baselinePath = argv[++i];
+    } else if (arg == "--max-regression" && i + 1 < argc) {
+      std::string error;
+      if (!parseDoubleArg(argv[++i], 0.0, 1e6, opt.maxRegression, error)) {
+        std::cout << "Error: --max-regression: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--core" && i + 1 < argc) {
+      std::string error;
+      if (!parseCore(argv[++i], core, error)) {
+        std::cout << "Error: --core: " << error << "\n";
+        return 1;
+      }
+    } else if (arg == "--simd" && i + 1 < argc) {
+      SimdLevel level;
+      if (!parseSimdLevel(argv[++i], level) || !setSimdLevel(level)) {
+        std::cout << "Error: SIMD level '" << argv[i]
+                  << "' is unknown or not supported here\n";
+        return 1;
+      }
+    } else {
+      std::cout << "Error: unknown option " << arg << "\n";
+      return 1;
+    }
+  }
+
+  std::vector<MicroCase> cases;
+  for (auto &c : buildCases()) {
+    if (c.name.find(opt.filter) != std::string::npos)
+      cases.push_back(std::move(c));
+  }
+  if (list) {
+    for (const auto &c : cases)
+      std::cout << c.name << "\n";
+    return 0;
+  }
+
+  if (core >= 0 && !pinCurrentThreadToCore(core))
+    std::cout << "Warning: could not pin to core " << core << "\n";
+  setHighPriority();
+
+  // With the table on stdout, CSV/JSON to "-" would interleave with it
+  bool table = opt.csvPath != "-" && opt.jsonPath != "-";
+  TimerCalibration timer = calibrateTimer();
+  if (table)
+    std::cout << "=== Quantum Microbenchmarks (" << cycleTimerName()
+              << ", overhead " << timer.overhead << " ticks, SIMD "
+              << simdLevelName(activeSimdLevel()) << ", "
+              << opt.repetitions << " repetitions) ===\n\n";
+
+  std::vector<MicroResult> results;
+  double totalCycles = 0.0, totalNs = 0.0;
+  for (const auto &c : cases) {
+    results.push_back(runCase(c, opt, timer.overhead));
+    totalCycles += results.back().medianCycles;
+    totalNs += results.back().medianNs;
+  }
+  double counterGHz = totalNs > 0.0 ? totalCycles / totalNs : 0.0;
+  if (table) {
+    printTable(results);
+    std::cout << "\nCounter rate: " << std::setprecision(3) << counterGHz
+              << " GHz (ticks per ns over all cases)\n";
+  }
+
+  if (!opt.csvPath.empty() &&
+      !writeOutput(opt.csvPath,
+                   [&](std::ostream &out) { writeCsv(out, results); })) {
+    std::cout << "Error: cannot write " << opt.csvPath << "\n";
+    return 1;
+  }
+  if (!opt.jsonPath.empty() &&
+      !writeOutput(opt.jsonPath, [&](std::ostream &out) {
+        writeJson(out, results, counterGHz);
+      })) {
+    std::cout << "Error: cannot write " << opt.jsonPath << "\n";
+    return 1;
+  }
+
+  if (opt.baselinePath.empty())
+    return 0;
+  std::map<std::string, double> baseline;
+  if (!readBaseline(opt.baselinePath, baseline)) {
+    std::cout << "Error: cannot read baseline " << opt.baselinePath << "\n";
+    return 1;
+  }
+  int regressions = 0;
+  for (const auto &r : results) {
+    auto it = baseline.find(r.name);
+    if (it == baseline.end() || it->second <= 0.0)
+      continue;
+    double change = (r.medianNs / it->second - 1.0) * 100.0;
+    if (change > opt.maxRegression) {
+      std::cerr << "REGRESSION: " << r.name << " " << std::fixed
+                << std::setprecision(2) << it->second << " -> "
+                << r.medianNs << " ns/op (+"
+                << std::setprecision(1) << change << "%)\n";
+      regressions++;
+    }
+  }
+  if (regressions > 0) {
+    std::cerr << regressions << " case(s) slower than the baseline by more "
+              << "than " << opt.maxRegression << "%\n";
+    return 2;
+  }
+  return 0;
+}
@@ -0,0 +1,459 @@
+// Offline analyzer for the scheduled-mode logs (time_surface_YYYY-MM-DD.csv).
+// Every log is memory-mapped and parsed in place by a pool of threads, one
+// file at a time per thread. Rows are reduced per (series, day, hour,
+// minute), where a series is one type / FFT level / pattern. Then:
+//   - the time-of-day surface: every (series, hour, minute) cell over all
+//     days, with the spread of the daily means in that cell
+//   - cross-day statistics per series: between-day vs within-day spread
+//   - optionally the per-day means of every series
+// Paths may be files or directories (scanned for time_surface_*.csv).
+
+#include "CommandLine.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// ========== Parsing ==========
+
+// One parsed CSV row
+struct SurfaceRow {
+  int day = 0; // yyyymmdd
+  int hour = 0;
+  int minute = 0;
+  const char *series = nullptr; // "type,fft_level,pattern" in the mapping
+  size_t seriesLength = 0;
+  double avg = 0.0;
+  double stdDev = 0.0;
+  double peakPercent = 0.0;
+};
+
+// Unsigned integer of exactly `digits` characters
+inline bool parseDigits(const char *p, int digits, int &out) {
+  out = 0;
+  for (int i = 0; i < digits; i++) {
+    if (p[i] < '0' || p[i] > '9')
+      return false;
+    out = out * 10 + (p[i] - '0');
+  }
+  return true;
+}
+
+// Decimal number up to the next comma or the end of the field; the
+// mapping is not NUL-terminated, so strtod cannot be used
+inline bool parseNumber(const char *p, const char *end, double &out) {
+  bool negative = false;
+  if (p < end && (*p == '-' || *p == '+'))
+    negative = *p++ == '-';
+  double value = 0.0, scale = 1.0;
+  bool digits = false, fraction = false;
+  for (; p < end; p++) {
+    if (*p >= '0' && *p <= '9') {
+      value = value * 10.0 + (*p - '0');
+      if (fraction)
+        scale *= 10.0;
+      digits = true;
+    } else if (*p == '.' && !fraction) {
+      fraction = true;
+    } else {
+      return false;
+    }
+  }
+  out = (negative ? -value : value) / scale;
+  return digits;
+}
+
+// Split one line (without its newline) into the CSV layout
+//   timestamp,hour,minute,type,fft_level,pattern,avg,std_dev,peak_bin,
+//   peak_percent
+inline bool parseSurfaceRow(const char *line, const char *end,
+                            SurfaceRow &row) {
+  const char *field[10];
+  const char *fieldEnd[10];
+  int n = 0;
+  const char *start = line;
+  for (const char *p = line; p <= end && n < 10; p++) {
+    if (p == end || *p == ',') {
+      field[n] = start;
+      fieldEnd[n] = p;
+      n++;
+      start = p + 1;
+    }
+  }
+  if (n != 10 || fieldEnd[0] - field[0] < 10)
+    return false;
+
+  // "YYYY-MM-DD HH:MM:SS"
+  int y, m, d;
+  if (!parseDigits(field[0], 4, y) || !parseDigits(field[0] + 5, 2, m) ||
+      !parseDigits(field[0] + 8, 2, d))
+    return false;
+  row.day = y * 10000 + m * 100 + d;
+
+  double hour, minute;
+  if (!parseNumber(field[1], fieldEnd[1], hour) ||
+      !parseNumber(field[2], fieldEnd[2], minute) ||
+      !parseNumber(field[6], fieldEnd[6], row.avg) ||
+      !parseNumber(field[7], fieldEnd[7], row.stdDev) ||
+      !parseNumber(field[9], fieldEnd[9], row.peakPercent))
+    return false;
+  row.hour = static_cast<int>(hour);
+  row.minute = static_cast<int>(minute);
+  if (row.hour < 0 || row.hour > 23 || row.minute < 0 || row.minute > 59)
+    return false;
+  row.series = field[3];
+  row.seriesLength = static_cast<size_t>(fieldEnd[5] - field[3]);
+  return true;
+}
+
+// ========== Aggregation ==========
+
+// Rows of one (series, day, hour, minute) or any merge of them
+struct CellStats {
+  uint64_t rows = 0;
+  double mean = 0.0; // Of the avg column
+  double m2 = 0.0;
+  double minAvg = 0.0;
+  double maxAvg = 0.0;
+  double sumStdDev = 0.0;
+  double sumPeakPercent = 0.0;
+
+  void add(const SurfaceRow &r) {
+    rows++;
+    double delta = r.avg - mean;
+    mean += delta / static_cast<double>(rows);
+    m2 += delta * (r.avg - mean);
+    minAvg = rows == 1 ? r.avg : std::min(minAvg, r.avg);
+    maxAvg = rows == 1 ? r.avg : std::max(maxAvg, r.avg);
+    sumStdDev += r.stdDev;
+    sumPeakPercent += r.peakPercent;
+  }
+
+  void merge(const CellStats &o) {
+    if (o.rows == 0)
+      return;
+    if (rows == 0) {
+      *this = o;
+      return;
+    }
+    double n = static_cast<double>(rows + o.rows);
+    double delta = o.mean - mean;
+    mean += delta * static_cast<double>(o.rows) / n;
+    m2 += o.m2 + delta * delta * static_cast<double>(rows) *
+                     static_cast<double>(o.rows) / n;
+    rows += o.rows;
+    minAvg = std::min(minAvg, o.minAvg);
+    maxAvg = std::max(maxAvg, o.maxAvg);
+    sumStdDev += o.sumStdDev;
+    sumPeakPercent += o.sumPeakPercent;
+  }
+
+  double stdDev() const { return rows ? std::sqrt(m2 / rows) : 0.0; }
+};
+
+// (day, hour, minute) packed for one series: yyyymmdd * 10000 + hhmm
+inline uint64_t cellKey(int day, int hour, int minute) {
+  return static_cast<uint64_t>(day) * 10000 + hour * 100 + minute;
+}
+
+// Everything one worker parsed, keyed by series name then cell
+struct PartialResult {
+  std::unordered_map<std::string, std::unordered_map<uint64_t, CellStats>>
+      series;
+  uint64_t rows = 0;
+  uint64_t badRows = 0;
+  uint64_t bytes = 0;
+  std::vector<std::string> unreadable;
+};
+
+inline void parseFile(const std::string &path, PartialResult &out) {
+  MappedFile file;
+  if (!file.open(path)) {
+    out.unreadable.push_back(path);
+    return;
+  }
+  const char *p = reinterpret_cast<const char *>(file.data());
+  const char *end = p + file.size();
+  out.bytes += file.size();
+
+  // Rows of a series come in runs; keep the last lookup
+  std::string key;
+  std::unordered_map<uint64_t, CellStats> *cells = nullptr;
+  SurfaceRow row;
+  while (p < end) {
+    const char *eol = static_cast<const char *>(
+        std::memchr(p, '\n', static_cast<size_t>(end - p)));
+    const char *lineEnd = eol ? eol : end;
+    const char *trimmed = lineEnd;
+    if (trimmed > p && trimmed[-1] == '\r')
+      trimmed--;
+    if (trimmed > p && *p != 't') { // Skip blank and header lines
+      if (parseSurfaceRow(p, trimmed, row)) {
+        if (!cells || key.size() != row.seriesLength ||
+            key.compare(0, key.size(), row.series, row.seriesLength) != 0) {
+          key.assign(row.series, row.seriesLength);
+          cells = &out.series[key];
+        }
+        (*cells)[cellKey(row.day, row.hour, row.minute)].add(row);
+        out.rows++;
+      } else {
+        out.badRows++;
+      }
+    }
+    p = lineEnd + 1;
+  }
+}
+
+// Files named on the command line, and time_surface_*.csv inside any
+// directories, sorted
+inline std::vector<std::string> collectLogs(
+    const std::vector<std::string> &paths) {
+  namespace fs = std::filesystem;
+  std::vector<std::string> files;
+  for (const auto &path : paths) {
+    std::error_code ec;
+    if (fs::is_directory(path, ec)) {
+      for (const auto &entry : fs::directory_iterator(path, ec)) {
+        std::string name = entry.path().filename().string();
+        if (entry.is_regular_file(ec) &&
+            name.compare(0, 13, "time_surface_") == 0 && name.size() > 17 &&
+            name.compare(name.size() - 4, 4, ".csv") == 0)
+          files.push_back(entry.path().string());
+      }
+    } else {
+      files.push_back(path);
+    }
+  }
+  std::sort(files.begin(), files.end());
+  return files;
+}
+
+// Parse every file across `threads` workers and merge their results
+inline PartialResult parseLogs(const std::vector<std::string> &files,
+                               unsigned threads) {
+  std::vector<PartialResult> partial(threads);
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < threads; t++) {
+    workers.emplace_back([&, t] {
+      for (size_t f = next.fetch_add(1); f < files.size();
+           f = next.fetch_add(1))
+        parseFile(files[f], partial[t]);
+    });
+  }
+  for (auto &w : workers)
+    w.join();
+
+  PartialResult total;
+  for (auto &p : partial) {
+    for (auto &s : p.series) {
+      auto &cells = total.series[s.first];
+      for (const auto &c : s.second)
+        cells[c.first].merge(c.second);
+    }
+    total.rows += p.rows;
+    total.badRows += p.badRows;
+    total.bytes += p.bytes;
+    total.unreadable.insert(total.unreadable.end(), p.unreadable.begin(),
+                            p.unreadable.end());
+  }
+  return total;
+}
+
+// ========== Reports ==========
+
+// One (series, hour, minute) cell over all days
+struct SurfaceCell {
+  CellStats rows;       // Every row
+  CellStats dailyMeans; // One entry per day: the day's mean avg
+};
+
+// Spread of a set of values, fed through CellStats
+inline void addValue(CellStats &s, double value) {
+  SurfaceRow r;
+  r.avg = value;
+  s.add(r);
+}
+
+inline std::string formatDay(int day) {
+  char buf[16];
+  std::snprintf(buf, sizeof(buf), "%04d-%02d-%02d", day / 10000,
+                day / 100 % 100, day % 100);
+  return buf;
+}
+
+inline bool writeSurface(
+    const std::string &path,
+    const std::map<std::string, std::map<int, SurfaceCell>> &surface) {
+  std::FILE *f = std::fopen(path.c_str(), "w");
+  if (!f)
+    return false;
+  std::fprintf(f, "type,fft_level,pattern,hour,minute,days,rows,mean_avg,"
+                  "sd_avg,between_day_sd,min_avg,max_avg,mean_std_dev,"
+                  "mean_peak_percent\n");
+  for (const auto &s : surface) {
+    for (const auto &c : s.second) {
+      const CellStats &r = c.second.rows;
+      std::fprintf(f, "%s,%d,%d,%llu,%llu,%.3f,%.3f,%.3f,%.2f,%.2f,%.3f,"
+                      "%.3f\n",
+                   s.first.c_str(), c.first / 100, c.first % 100,
+                   static_cast<unsigned long long>(c.second.dailyMeans.rows),
+                   static_cast<unsigned long long>(r.rows), r.mean,
+                   r.stdDev(), c.second.dailyMeans.stdDev(), r.minAvg,
+                   r.maxAvg, r.sumStdDev / r.rows, r.sumPeakPercent / r.rows);
+    }
+  }
+  return std::fclose(f) == 0;
+}
+
+inline bool writeDaily(
+    const std::string &path,
+    const std::map<std::string, std::map<int, CellStats>> &daily) {
+  std::FILE *f = std::fopen(path.c_str(), "w");
+  if (!f)
+    return false;
+  std::fprintf(f, "type,fft_level,pattern,date,rows,mean_avg,sd_avg,"
+                  "mean_std_dev,mean_peak_percent\n");
+  for (const auto &s : daily) {
+    for (const auto &d : s.second) {
+      const CellStats &r = d.second;
+      std::fprintf(f, "%s,%s,%llu,%.3f,%.3f,%.3f,%.3f\n", s.first.c_str(),
+                   formatDay(d.first).c_str(),
+                   static_cast<unsigned long long>(r.rows), r.mean,
+                   r.stdDev(), r.sumStdDev / r.rows,
+                   r.sumPeakPercent / r.rows);
+    }
+  }
+  return std::fclose(f) == 0;
+}
+
+// ========== Main ==========
+
+int main(int argc, char *argv[]) {
+  std::vector<std::string> paths;
+  std::string surfacePath, dailyPath;
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--surface" && i + 1 < argc) {
+      surfacePath = argv[++i];
+    } else if (arg == "--daily" && i + 1 < argc) {
+      dailyPath = argv[++i];
+    } else if (arg == "--threads" && i + 1 < argc) {
+      int n = 0;
+      std::string error;
+      if (!parseIntArg(argv[++i], 1, 1024, n, error)) {
+        std::cout << "Error: --threads: " << error << "\n";
+        return 1;
+      }
+      threads = static_cast<unsigned>(n);
+    } else if (arg.compare(0, 2, "--") == 0) {
+      std::cout << "Error: unknown option " << arg << "\n";
+      return 1;
+    } else {
+      paths.push_back(arg);
+    }
+  }
+  if (paths.empty())
+    paths.push_back(".");
+
+  std::vector<std::string> files = collectLogs(paths);
+  if (files.empty()) {
+    std::cout << "Error: no time_surface_*.csv logs found\n";
+    return 1;
+  }
+  threads = static_cast<unsigned>(
+      std::min<size_t>(threads, files.size()));
+
+  auto t0 = std::chrono::steady_clock::now();
+  PartialResult parsed = parseLogs(files, threads);
+  double parseSeconds = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - t0)
+                            .count();
+
+  std::cout << "=== Time Surface Analysis ===\n";
+  std::cout << "Parsed " << parsed.rows << " rows from " << files.size()
+            << " file(s), " << std::fixed << std::setprecision(1)
+            << parsed.bytes / 1048576.0 << " MiB, in " << std::setprecision(2)
+            << parseSeconds << " s on " << threads << " thread(s)\n";
+  if (parsed.badRows > 0)
+    std::cout << "Warning: " << parsed.badRows << " malformed row(s) skipped\n";
+  for (const auto &path : parsed.unreadable)
+    std::cout << "Warning: cannot read " << path << "\n";
+
+  // Reduce the (day, hour, minute) cells of every series two ways
+  std::map<std::string, std::map<int, SurfaceCell>> surface; // hhmm
+  std::map<std::string, std::map<int, CellStats>> daily;     // yyyymmdd
+  for (const auto &s : parsed.series) {
+    auto &cells = surface[s.first];
+    auto &days = daily[s.first];
+    for (const auto &c : s.second) {
+      int day = static_cast<int>(c.first / 10000);
+      int hhmm = static_cast<int>(c.first % 10000);
+      cells[hhmm].rows.merge(c.second);
+      addValue(cells[hhmm].dailyMeans, c.second.mean);
+      days[day].merge(c.second);
+    }
+  }
+
+  // Cross-day statistics per series
+  std::cout << "\n" << std::left << std::setw(36) << "series" << std::right
+            << std::setw(6) << "days" << std::setw(10) << "rows"
+            << std::setw(10) << "mean" << std::setw(12) << "between-day"
+            << std::setw(12) << "within-day" << "  highest / lowest cell\n";
+  for (const auto &s : daily) {
+    CellStats all, dailyMeans;
+    double withinM2 = 0.0;
+    for (const auto &d : s.second) {
+      all.merge(d.second);
+      addValue(dailyMeans, d.second.mean);
+      withinM2 += d.second.m2;
+    }
+    const auto &cells = surface[s.first];
+    auto high = cells.begin(), low = cells.begin();
+    for (auto it = cells.begin(); it != cells.end(); ++it) {
+      if (it->second.rows.mean > high->second.rows.mean)
+        high = it;
+      if (it->second.rows.mean < low->second.rows.mean)
+        low = it;
+    }
+    char cellBuf[64];
+    std::snprintf(cellBuf, sizeof(cellBuf), "%02d:%02d %.2f / %02d:%02d %.2f",
+                  high->first / 100, high->first % 100,
+                  high->second.rows.mean, low->first / 100, low->first % 100,
+                  low->second.rows.mean);
+    std::cout << std::left << std::setw(36) << s.first << std::right
+              << std::setw(6) << s.second.size() << std::setw(10) << all.rows
+              << std::setw(10) << std::setprecision(2) << all.mean
+              << std::setw(12) << dailyMeans.stdDev() << std::setw(12)
+              << std::sqrt(withinM2 / std::max<uint64_t>(all.rows, 1))
+              << "  " << cellBuf << "\n";
+  }
+
+  if (!surfacePath.empty()) {
+    if (!writeSurface(surfacePath, surface)) {
+      std::cout << "Error: cannot write " << surfacePath << "\n";
+      return 1;
+    }
+    std::cout << "\nTime-of-day surface written to " << surfacePath << "\n";
+  }
+  if (!dailyPath.empty()) {
+    if (!writeDaily(dailyPath, daily)) {
+      std::cout << "Error: cannot write " << dailyPath << "\n";
+      return 1;
+    }
+    std::cout << "Daily means written to " << dailyPath << "\n";
+  }
+  return 0;
+}